@@ -0,0 +1,384 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "admission.h"
+
+/*
+ * Get the priority class of session, within the classes
+ */
+static int admission_class(session_t* session)
+{
+  if(session->priority < 0) return 0;
+
+  if(session->priority >= ADMISSION_CLASSES) return ADMISSION_CLASSES - 1;
+
+  return session->priority;
+}
+
+/*
+ * Add a rule giving the clients of a network a priority class
+ *
+ * PARAMS
+ * - const char* rule | ADDRESS[/BITS]=CLASS, like 10.0.0.0/8=2
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Invalid rule
+ * - 2 | Too many rules
+ */
+int admission_rule_add(admission_t* admission, const char* rule)
+{
+  if(admission->rule_count >= ADMISSION_RULES) return 2;
+
+  const char* equals = strchr(rule, '=');
+
+  if(!equals || equals == rule || (size_t) (equals - rule) >= INET_ADDRSTRLEN + 3) return 1;
+
+  char address[INET_ADDRSTRLEN + 3];
+
+  memcpy(address, rule, equals - rule);
+
+  address[equals - rule] = '\0';
+
+  int bits = 32;
+
+  char* slash = strchr(address, '/');
+
+  if(slash)
+  {
+    *slash = '\0';
+
+    char* end;
+
+    bits = strtol(slash + 1, &end, 10);
+
+    if(end == slash + 1 || *end != '\0' || bits < 0 || bits > 32) return 1;
+  }
+
+  char* end;
+
+  long priority = strtol(equals + 1, &end, 10);
+
+  if(end == equals + 1 || *end != '\0' || priority < 0 || priority >= ADMISSION_CLASSES) return 1;
+
+  struct in_addr network;
+
+  if(inet_pton(AF_INET, address, &network) != 1) return 1;
+
+  uint32_t mask = (bits > 0) ? (uint32_t) 0xffffffff << (32 - bits) : 0;
+
+  admission->rules[admission->rule_count++] = (admission_rule_t)
+  {
+    .network  = ntohl(network.s_addr) & mask,
+    .mask     = mask,
+    .priority = priority
+  };
+
+  return 0;
+}
+
+/*
+ * Get the priority class of the client connected to socket,
+ * from the most specific rule matching its address
+ *
+ * RETURN (int priority)
+ * - The class of the client, 0 if no rule matches
+ */
+int admission_priority(admission_t* admission, int sockfd)
+{
+  if(admission->rule_count == 0) return 0;
+
+  struct sockaddr_in address;
+
+  socklen_t length = sizeof(address);
+
+  if(getpeername(sockfd, (struct sockaddr*) &address, &length) == -1 || address.sin_family != AF_INET) return 0;
+
+  uint32_t host = ntohl(address.sin_addr.s_addr);
+
+  admission_rule_t* best = NULL;
+
+  for(size_t index = 0; index < admission->rule_count; index++)
+  {
+    admission_rule_t* rule = &admission->rules[index];
+
+    // The masks are contiguous, so a larger mask is a longer prefix
+    if((host & rule->mask) == rule->network && (!best || rule->mask > best->mask)) best = rule;
+  }
+
+  return best ? best->priority : 0;
+}
+
+/*
+ * Check if session is bound by the depth and the deadline
+ *
+ * The workers of a batch are the positions of a client that has
+ * already been let in, so they wait as long as it takes
+ */
+static bool admission_bound(session_t* session)
+{
+  return !(session->carrier && session->carrier->batch);
+}
+
+/*
+ * Check if no more sessions are let in
+ */
+bool admission_full(admission_t* admission)
+{
+  return admission->depth > 0 && admission->count >= admission->depth;
+}
+
+/*
+ * Let session wait in its priority class, in order of when it was queued
+ *
+ * A session that changes class keeps its place in time,
+ * so it is inserted before the sessions that came after it
+ */
+void admission_push(admission_t* admission, session_t* session)
+{
+  int class = admission_class(session);
+
+  session_t** pointer = &admission->heads[class];
+
+  // Most sessions are the latest, and go right to the end
+  if(admission->tails[class] && admission->tails[class]->queued <= session->queued)
+  {
+    pointer = &admission->tails[class]->next;
+  }
+
+  while(*pointer && (*pointer)->queued <= session->queued) pointer = &(*pointer)->next;
+
+  session->next = *pointer;
+
+  *pointer = session;
+
+  if(!session->next) admission->tails[class] = session;
+
+  session->position = 0;
+
+  admission->count++;
+
+  admission->changed = true;
+}
+
+/*
+ * Take the session that has waited the longest in the highest class
+ *
+ * RETURN (session_t* session)
+ * - NULL | No session is waiting
+ */
+session_t* admission_pop(admission_t* admission)
+{
+  for(int class = ADMISSION_CLASSES - 1; class >= 0; class--)
+  {
+    session_t* session = admission->heads[class];
+
+    if(!session) continue;
+
+    admission->heads[class] = session->next;
+
+    if(!session->next) admission->tails[class] = NULL;
+
+    session->next = NULL;
+
+    admission->count--;
+
+    admission->changed = true;
+
+    return session;
+  }
+
+  return NULL;
+}
+
+/*
+ * Remove session from the list of class, if it is waiting there
+ *
+ * RETURN (bool removed)
+ */
+static bool admission_class_remove(admission_t* admission, int class, session_t* session)
+{
+  session_t* previous = NULL;
+
+  session_t** pointer = &admission->heads[class];
+
+  while(*pointer && *pointer != session)
+  {
+    previous = *pointer;
+
+    pointer = &(*pointer)->next;
+  }
+
+  if(!*pointer) return false;
+
+  *pointer = session->next;
+
+  if(admission->tails[class] == session) admission->tails[class] = previous;
+
+  session->next = NULL;
+
+  admission->count--;
+
+  admission->changed = true;
+
+  return true;
+}
+
+/*
+ * Remove session from the waiting sessions, if it is waiting
+ *
+ * A session that has just changed its priority is still waiting
+ * in its old class, so the other classes are searched as well
+ *
+ * RETURN (bool removed)
+ */
+bool admission_remove(admission_t* admission, session_t* session)
+{
+  int class = admission_class(session);
+
+  if(admission_class_remove(admission, class, session)) return true;
+
+  for(int other = 0; other < ADMISSION_CLASSES; other++)
+  {
+    if(other != class && admission_class_remove(admission, other, session)) return true;
+  }
+
+  return false;
+}
+
+/*
+ * Get the session of class that has waited the longest, of those bound by the deadline
+ */
+static session_t* admission_oldest(admission_t* admission, int class)
+{
+  session_t* session = admission->heads[class];
+
+  while(session && !admission_bound(session)) session = session->next;
+
+  return session;
+}
+
+/*
+ * Take a session that has waited past the deadline
+ *
+ * RETURN (session_t* session)
+ * - NULL | No session has waited past the deadline
+ */
+session_t* admission_expired(admission_t* admission, uint64_t now)
+{
+  if(admission->deadline == 0) return NULL;
+
+  for(int class = 0; class < ADMISSION_CLASSES; class++)
+  {
+    session_t* session = admission_oldest(admission, class);
+
+    if(session && now - session->queued >= admission->deadline)
+    {
+      admission_remove(admission, session);
+
+      return session;
+    }
+  }
+
+  return NULL;
+}
+
+/*
+ * Get the time until the next session waits past the deadline
+ *
+ * RETURN (int timeout)
+ * - >=0 | Milliseconds, rounded up
+ * -  -1 | No session can wait past the deadline
+ */
+int admission_timeout(admission_t* admission, uint64_t now)
+{
+  if(admission->deadline == 0) return -1;
+
+  uint64_t earliest = UINT64_MAX;
+
+  for(int class = 0; class < ADMISSION_CLASSES; class++)
+  {
+    session_t* session = admission_oldest(admission, class);
+
+    if(session && session->queued + admission->deadline < earliest)
+    {
+      earliest = session->queued + admission->deadline;
+    }
+  }
+
+  if(earliest == UINT64_MAX) return -1;
+
+  if(earliest <= now) return 0;
+
+  return (earliest - now + 999999) / 1000000;
+}
+
+/*
+ * Send the waiting sessions whose position has changed their new position,
+ * counted from 1 for the session that gets the next free engine
+ *
+ * The sessions are gathered first, because a client that fails
+ * to be written to is closed, which removes it from the queue
+ */
+void admission_notify(admission_t* admission)
+{
+  if(!admission->changed) return;
+
+  admission->changed = false;
+
+  if(admission->count > admission->notices_size)
+  {
+    size_t size = (admission->notices_size > 0) ? admission->notices_size : 64;
+
+    while(size < admission->count) size *= 2;
+
+    session_t** notices = realloc(admission->notices, sizeof(session_t*) * size);
+
+    if(!notices) return;
+
+    admission->notices      = notices;
+    admission->notices_size = size;
+  }
+
+  size_t count = 0;
+  size_t position = 0;
+
+  for(int class = ADMISSION_CLASSES - 1; class >= 0; class--)
+  {
+    for(session_t* session = admission->heads[class]; session; session = session->next)
+    {
+      if(++position == session->position) continue;
+
+      session->position = position;
+
+      admission->notices[count++] = session;
+    }
+  }
+
+  for(size_t index = 0; index < count; index++)
+  {
+    session_t* session = admission->notices[index];
+
+    if(session->closed) continue;
+
+    char line[64];
+
+    int length = sprintf(line, "info string queue position %ld\n", (long) session->position);
+
+    session_notify(session, line, length);
+  }
+}
+
+/*
+ * Free the gathered sessions, after every session has been closed
+ */
+void admission_free(admission_t* admission)
+{
+  free(admission->notices);
+
+  admission->notices      = NULL;
+  admission->notices_size = 0;
+}
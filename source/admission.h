@@ -0,0 +1,80 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include "debug.h"
+#include "session.h"
+#include "timing.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#define ADMISSION_CLASSES 4  // Priority classes, from 0 (default) to the highest
+#define ADMISSION_RULES   64 // Most networks with a priority class of their own
+
+/*
+ * Priority class of the clients connecting from a network
+ */
+typedef struct
+{
+  uint32_t network; // Host byte order
+  uint32_t mask;
+  int      priority;
+} admission_rule_t;
+
+/*
+ * Sessions waiting for an engine
+ *
+ * Every priority class is a list in order of arrival, and a free
+ * engine goes to the session that has waited the longest in the
+ * highest class. With a depth, no more sessions than that are let in,
+ * and with a deadline, sessions that have waited longer are let go
+ *
+ * The class of a client is given by the most specific rule
+ * matching its address, and is 0 without one
+ */
+typedef struct
+{
+  session_t*  heads[ADMISSION_CLASSES];
+  session_t*  tails[ADMISSION_CLASSES];
+  size_t      count;
+  size_t      depth;          // Most waiting sessions (0 for no limit)
+  uint64_t    deadline;       // Longest wait in nanoseconds (0 for no limit)
+  bool        changed;        // The positions might have changed since they were sent
+  session_t** notices;        // Sessions to send their new positions
+  size_t      notices_size;
+  admission_rule_t rules[ADMISSION_RULES];
+  size_t      rule_count;
+} admission_t;
+
+extern int        admission_rule_add(admission_t* admission, const char* rule);
+
+extern int        admission_priority(admission_t* admission, int sockfd);
+
+extern bool       admission_full(admission_t* admission);
+
+extern void       admission_push(admission_t* admission, session_t* session);
+
+extern session_t* admission_pop(admission_t* admission);
+
+extern bool       admission_remove(admission_t* admission, session_t* session);
+
+extern session_t* admission_expired(admission_t* admission, uint64_t now);
+
+extern int        admission_timeout(admission_t* admission, uint64_t now);
+
+extern void       admission_notify(admission_t* admission);
+
+extern void       admission_free(admission_t* admission);
+
+#endif // ADMISSION_H
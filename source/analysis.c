@@ -0,0 +1,269 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "analysis.h"
+
+/*
+ * Copy the words of a command, separated by single spaces
+ *
+ * The destination needs room for length + 1 bytes
+ *
+ * RETURN (size_t length)
+ */
+static size_t analysis_normalize(char* dest, const char* src, size_t length)
+{
+  size_t dest_length = 0;
+
+  bool space = false;
+
+  for(size_t index = 0; index < length; index++)
+  {
+    if(isspace((unsigned char) src[index]))
+    {
+      space = (dest_length > 0);
+
+      continue;
+    }
+
+    if(space) dest[dest_length++] = ' ';
+
+    space = false;
+
+    dest[dest_length++] = src[index];
+  }
+
+  dest[dest_length] = '\0';
+
+  return dest_length;
+}
+
+/*
+ * Remember the position of the client
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate position
+ */
+int analysis_position(analysis_t* analysis, const char* line, size_t length)
+{
+  char* position = realloc(analysis->position, length + 1);
+
+  if(!position) return 1;
+
+  analysis_normalize(position, line, length);
+
+  analysis->position = position;
+
+  return 0;
+}
+
+/*
+ * Check that the search limits of a go command give repeatable results
+ *
+ * Searches limited by the clock of the game, or without limit, are not cached
+ */
+static bool analysis_limited(const char* line)
+{
+  const char* limits[] = { "depth", "nodes", "mate", "movetime", NULL };
+
+  bool limited = false;
+
+  const char* word = line + 2;
+
+  while(*word)
+  {
+    while(isspace((unsigned char) *word)) word++;
+
+    if(!*word) break;
+
+    size_t word_length = strcspn(word, " \t\r\n");
+
+    int index;
+
+    for(index = 0; limits[index]; index++)
+    {
+      if(strlen(limits[index]) == word_length && strncmp(word, limits[index], word_length) == 0) break;
+    }
+
+    if(!limits[index]) return false;
+
+    word += word_length;
+
+    while(isspace((unsigned char) *word)) word++;
+
+    if(!isdigit((unsigned char) *word)) return false;
+
+    word += strspn(word, "0123456789");
+
+    limited = true;
+  }
+
+  return limited;
+}
+
+/*
+ * Create the cache key of a go command
+ *
+ * The key is the position, the search limits and
+ * the options that don't have their default values
+ *
+ * RETURN (char* key)
+ * - NULL | The search is not cacheable, or failed to allocate key
+ */
+char* analysis_key(analysis_t* analysis, const char* line, size_t length, uci_t* uci, size_t* key_length)
+{
+  if(!analysis->position || !analysis_limited(line)) return NULL;
+
+  size_t position_length = strlen(analysis->position);
+
+  size_t size = position_length + length + 3;
+
+  for(size_t index = 0; index < uci->count; index++)
+  {
+    uci_option_t* option = &uci->options[index];
+
+    if(option->value) size += strlen(option->name) + strlen(option->value) + 2;
+  }
+
+  char* key = malloc(size);
+
+  if(!key) return NULL;
+
+  memcpy(key, analysis->position, position_length);
+
+  *key_length = position_length;
+
+  key[(*key_length)++] = '\n';
+
+  *key_length += analysis_normalize(key + *key_length, line, length);
+
+  key[(*key_length)++] = '\n';
+
+  for(size_t index = 0; index < uci->count; index++)
+  {
+    uci_option_t* option = &uci->options[index];
+
+    if(!option->value || strcmp(option->value, option->fallback) == 0) continue;
+
+    *key_length += sprintf(key + *key_length, "%s=%s\n", option->name, option->value);
+  }
+
+  return key;
+}
+
+/*
+ * Start following a search, cached with key unless key is NULL
+ *
+ * The analysis takes ownership of the key
+ */
+void analysis_start(analysis_t* analysis, char* key, size_t key_length)
+{
+  free(analysis->key);
+
+  analysis->key        = key;
+  analysis->key_length = key_length;
+
+  analysis->result_length = 0;
+
+  analysis->searching = true;
+  analysis->stopped   = false;
+}
+
+/*
+ * Append a line to the result
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate result
+ */
+static int analysis_append(analysis_t* analysis, const char* line, size_t length)
+{
+  if(analysis->result_length + length > analysis->result_size)
+  {
+    size_t size = (analysis->result_size > 0) ? analysis->result_size : 256;
+
+    while(size < analysis->result_length + length) size *= 2;
+
+    char* result = realloc(analysis->result, size);
+
+    if(!result) return 1;
+
+    analysis->result      = result;
+    analysis->result_size = size;
+  }
+
+  memcpy(analysis->result + analysis->result_length, line, length);
+
+  analysis->result_length += length;
+
+  return 0;
+}
+
+/*
+ * Find word in line, without looking past its end
+ *
+ * The line might be followed by more lines, like in a cached result
+ *
+ * RETURN (const char* word)
+ * - NULL | The line doesn't contain the word
+ */
+const char* analysis_find(const char* line, size_t length, const char* word)
+{
+  return memmem(line, length, word, strlen(word));
+}
+
+/*
+ * Follow the engine output of the ongoing search
+ *
+ * A pv line of the first multipv starts a new result,
+ * because it starts the lines of the next depth
+ *
+ * RETURN (bool complete)
+ * - true | The search has ended with a result that can be cached
+ */
+bool analysis_output(analysis_t* analysis, const char* line, size_t length)
+{
+  if(!analysis->searching) return false;
+
+  if(strncmp(line, "bestmove", 8) == 0)
+  {
+    analysis->searching = false;
+
+    if(!analysis->key || analysis->stopped) return false;
+
+    return analysis_append(analysis, line, length) == 0;
+  }
+
+  if(!analysis->key || strncmp(line, "info ", 5) != 0) return false;
+
+  if(!analysis_find(line, length, " pv ")) return false;
+
+  const char* multipv = analysis_find(line, length, " multipv ");
+
+  if(!multipv || atoi(multipv + 9) <= 1) analysis->result_length = 0;
+
+  if(analysis_append(analysis, line, length) != 0)
+  {
+    // The result would be incomplete, so the search is not cached
+    free(analysis->key);
+
+    analysis->key = NULL;
+  }
+
+  return false;
+}
+
+/*
+ * Free the position, key and result of the analysis
+ */
+void analysis_free(analysis_t* analysis)
+{
+  free(analysis->position);
+  free(analysis->key);
+  free(analysis->result);
+
+  *analysis = (analysis_t) { 0 };
+}
@@ -0,0 +1,53 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+// memmem is a GNU extension
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "uci.h"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/*
+ * The position and search of a client, followed to cache the results
+ *
+ * The result is the last pv line of every multipv, and the bestmove line
+ */
+typedef struct
+{
+  char*  position;      // Normalized position command
+  char*  key;           // Cache key of the ongoing search (NULL if not cacheable)
+  size_t key_length;
+  char*  result;
+  size_t result_length;
+  size_t result_size;
+  bool   searching;
+  bool   stopped;       // The client stopped the search before bestmove
+} analysis_t;
+
+extern int   analysis_position(analysis_t* analysis, const char* line, size_t length);
+
+extern char* analysis_key(analysis_t* analysis, const char* line, size_t length, uci_t* uci, size_t* key_length);
+
+extern void  analysis_start(analysis_t* analysis, char* key, size_t key_length);
+
+extern bool  analysis_output(analysis_t* analysis, const char* line, size_t length);
+
+extern const char* analysis_find(const char* line, size_t length, const char* word);
+
+extern void  analysis_free(analysis_t* analysis);
+
+#endif // ANALYSIS_H
@@ -0,0 +1,597 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "batch.h"
+#include "session.h"
+
+/*
+ * Create the batch of a carrier session
+ *
+ * RETURN (batch_t* batch)
+ * - NULL | Failed to allocate batch
+ */
+batch_t* batch_create(session_t* carrier, size_t concurrency)
+{
+  batch_t* batch = malloc(sizeof(batch_t));
+
+  if(!batch) return NULL;
+
+  *batch = (batch_t) { .carrier = carrier, .concurrency = concurrency };
+
+  batch->workers = calloc(concurrency, sizeof(batch_worker_t));
+
+  batch->limits = strdup(BATCH_LIMITS);
+
+  if(!batch->workers || !batch->limits || sched_init(&batch->sched, concurrency) != 0)
+  {
+    sched_free(&batch->sched);
+
+    free(batch->workers);
+
+    free(batch->limits);
+
+    free(batch);
+
+    return NULL;
+  }
+
+  batch->limits_length = strlen(BATCH_LIMITS);
+
+  return batch;
+}
+
+/*
+ * Free the batch, after the workers have been closed
+ */
+void batch_free(batch_t* batch)
+{
+  for(size_t index = 0; index < batch->concurrency; index++)
+  {
+    analysis_free(&batch->workers[index].analysis);
+  }
+
+  free(batch->workers);
+
+  free(batch->limits);
+
+  free(batch->buffer);
+
+  sched_free(&batch->sched);
+
+  free(batch);
+}
+
+/*
+ * Append bytes to the commands of the position being queued
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate buffer
+ */
+static int batch_append(batch_t* batch, const char* data, size_t length)
+{
+  size_t needed = batch->buffer_length + length;
+
+  if(needed > batch->buffer_size)
+  {
+    size_t size = (batch->buffer_size > 0) ? batch->buffer_size : 256;
+
+    while(size < needed) size *= 2;
+
+    char* buffer = realloc(batch->buffer, size);
+
+    if(!buffer) return 1;
+
+    batch->buffer      = buffer;
+    batch->buffer_size = size;
+  }
+
+  memcpy(batch->buffer + batch->buffer_length, data, length);
+
+  batch->buffer_length = needed;
+
+  return 0;
+}
+
+/*
+ * Append the position command of a line from the client
+ *
+ * A FEN keeps its move counters, while an EPD only has four fields,
+ * followed by operations that are not part of the position
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate buffer
+ */
+static int batch_position(batch_t* batch, const char* line, size_t length)
+{
+  if(strncmp(line, "position ", 9) == 0) return batch_append(batch, line, length);
+
+  if(strncmp(line, "startpos", 8) == 0)
+  {
+    return batch_append(batch, "position ", 9) || batch_append(batch, line, length);
+  }
+
+  if(batch_append(batch, "position fen", 12) != 0) return 1;
+
+  const char* end = line + length;
+
+  for(int field = 0; field < 6 && line < end; field++)
+  {
+    while(line < end && isspace((unsigned char) *line)) line++;
+
+    const char* word = line;
+
+    while(line < end && !isspace((unsigned char) *line)) line++;
+
+    if(line == word) break;
+
+    // The fifth field of an EPD is an operation, not a move counter
+    if(field >= 4 && !isdigit((unsigned char) *word)) break;
+
+    if(batch_append(batch, " ", 1) != 0 || batch_append(batch, word, line - word) != 0) return 1;
+  }
+
+  return 0;
+}
+
+/*
+ * Queue a position, to be searched with the current limits
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate or schedule position
+ */
+static int batch_enqueue(batch_t* batch, const char* line, size_t length)
+{
+  batch->buffer_length = 0;
+
+  if(batch_position(batch, line, length) != 0) return 1;
+
+  size_t position_length = batch->buffer_length;
+
+  batch_job_t* job = malloc(sizeof(batch_job_t) + position_length + batch->limits_length + 2);
+
+  if(!job) return 1;
+
+  job->index           = batch->queued;
+  job->position_length = position_length;
+  job->go_length       = batch->limits_length;
+
+  memcpy(job->commands, batch->buffer, position_length);
+
+  job->commands[position_length] = '\0';
+
+  memcpy(job->commands + position_length + 1, batch->limits, batch->limits_length + 1);
+
+  if(sched_push(&batch->sched, job) != 0)
+  {
+    free(job);
+
+    return 1;
+  }
+
+  if(batch->queued++ == 0) batch->start = timing_now();
+
+  return 0;
+}
+
+/*
+ * Set the search limits of the positions queued after this
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate limits
+ */
+static int batch_limits(batch_t* batch, const char* line, size_t length)
+{
+  char* limits = malloc(length + 1);
+
+  if(!limits) return 1;
+
+  memcpy(limits, line, length);
+
+  limits[length] = '\0';
+
+  free(batch->limits);
+
+  batch->limits        = limits;
+  batch->limits_length = length;
+
+  return 0;
+}
+
+/*
+ * Get the number of nodes of the last search result lines
+ */
+static uint64_t batch_nodes(const char* result, size_t length)
+{
+  uint64_t nodes = 0;
+
+  const char* end = result + length;
+
+  while(result < end)
+  {
+    const char* newline = memchr(result, '\n', end - result);
+
+    size_t line_length = newline ? (size_t) (newline + 1 - result) : (size_t) (end - result);
+
+    const char* word = analysis_find(result, line_length, " nodes ");
+
+    if(word)
+    {
+      uint64_t line_nodes = strtoull(word + 7, NULL, 10);
+
+      if(line_nodes > nodes) nodes = line_nodes;
+    }
+
+    result += line_length;
+  }
+
+  return nodes;
+}
+
+/*
+ * Send the result of a position to the client, prefixed with its input index
+ */
+static void batch_send(batch_t* batch, batch_worker_t* worker, const char* result, size_t length)
+{
+  conn_t* conn = &batch->carrier->conn;
+
+  char tag[24];
+
+  size_t tag_length = sprintf(tag, "%ld ", (long) worker->index);
+
+  const char* end = result + length;
+
+  while(result < end)
+  {
+    const char* newline = memchr(result, '\n', end - result);
+
+    size_t line_length = newline ? (size_t) (newline + 1 - result) : (size_t) (end - result);
+
+    conn_write(conn, tag, tag_length);
+
+    conn_write(conn, result, line_length);
+
+    if(!newline) conn_write(conn, "\n", 1);
+
+    result += line_length;
+  }
+}
+
+/*
+ * Send the summary, once every position the client ended has been analyzed
+ *
+ * The summary is followed by a line for every worker, with the time it
+ * has been busy, and idle, during the makespan of the batch.
+ * The counters start over, for the next positions of the client
+ */
+static void batch_summarize(batch_t* batch)
+{
+  if(!batch->ended || batch->finished < batch->queued || batch->carrier->closed) return;
+
+  uint64_t makespan = (batch->queued > 0) ? timing_now() - batch->start : 0;
+
+  double seconds = (double) makespan / 1e9;
+
+  double positions_rate = (seconds > 0) ? batch->finished / seconds : 0;
+  double nodes_rate     = (seconds > 0) ? batch->nodes    / seconds : 0;
+
+  conn_t* conn = &batch->carrier->conn;
+
+  char line[256];
+
+  int length = snprintf(line, sizeof(line),
+    "summary positions %ld nodes %llu time %lld pps %.2f nps %.0f\n",
+    (long) batch->finished, (unsigned long long) batch->nodes,
+    (long long) (makespan / 1000000), positions_rate, nodes_rate);
+
+  conn_write(conn, line, length);
+
+  for(size_t index = 0; index < batch->concurrency; index++)
+  {
+    sched_worker_t* worker = &batch->sched.workers[index];
+
+    uint64_t idle = (makespan > worker->busy) ? makespan - worker->busy : 0;
+
+    length = snprintf(line, sizeof(line),
+      "worker %ld positions %ld stolen %ld busy %lld idle %lld\n",
+      (long) index + 1, (long) worker->done, (long) worker->stolen,
+      (long long) (worker->busy / 1000000), (long long) (idle / 1000000));
+
+    conn_write(conn, line, length);
+
+    if(batch->carrier->debug)
+    {
+      info_print("Batch worker (%ld): %ld positions, %ld stolen, %f ms idle", (long) index + 1,
+        (long) worker->done, (long) worker->stolen, (double) idle / 1e6);
+    }
+  }
+
+  if(batch->carrier->debug)
+  {
+    info_print("Analyzed batch of %ld positions in %f s", (long) batch->finished, seconds);
+  }
+
+  sched_reset(&batch->sched);
+
+  batch->queued   = 0;
+  batch->finished = 0;
+  batch->nodes    = 0;
+  batch->ended    = false;
+}
+
+/*
+ * Give the next scheduled positions to an idle worker
+ *
+ * Cached results make the worker idle again at once, so it continues
+ * with the next position. A worker without a position is closed,
+ * to give its engine to the next client
+ */
+static void batch_feed(batch_t* batch, batch_worker_t* worker)
+{
+  size_t slot = worker - batch->workers;
+
+  batch_job_t* job;
+
+  worker->feeding = true;
+
+  while(!worker->busy && worker->session && (job = sched_take(&batch->sched, slot)))
+  {
+    session_t* session = worker->session;
+
+    char* position = job->commands;
+    char* go       = job->commands + job->position_length + 1;
+
+    worker->index = job->index;
+    worker->busy  = true;
+
+    analysis_start(&worker->analysis, strdup(position), job->position_length);
+
+    if(!session->engine)
+    {
+      if(session_queue(session, position, job->position_length) != 0 ||
+         session_queue(session, go, job->go_length) != 0)
+      {
+        if(session->debug) error_print("Failed to queue batch position");
+      }
+
+      free(job);
+
+      continue;
+    }
+
+    engine_t* engine = session->engine;
+
+    sched_start(&batch->sched, slot, timing_now());
+
+    if(session_command(session, position, job->position_length) != 0 ||
+       session_command(session, go, job->go_length) != 0)
+    {
+      free(job);
+
+      break;
+    }
+
+    // The commands reference the job, so they have to be written before it is freed
+    conn_flush(&engine->conn);
+
+    free(job);
+  }
+
+  worker->feeding = false;
+
+  if(!worker->busy && worker->session) session_close(worker->session);
+}
+
+/*
+ * Open workers for the scheduled positions, up to the concurrency
+ *
+ * The workers that are open take the positions of the closed ones
+ */
+static void batch_dispatch(batch_t* batch)
+{
+  session_t* carrier = batch->carrier;
+
+  for(size_t index = 0; index < batch->concurrency; index++)
+  {
+    if(batch->sched.pending == 0 || carrier->closed) break;
+
+    batch_worker_t* worker = &batch->workers[index];
+
+    if(worker->session) continue;
+
+    session_t* session = session_create_logical(carrier, index + 1);
+
+    if(!session)
+    {
+      if(carrier->debug) error_print("Failed to open batch worker");
+
+      break;
+    }
+
+    worker->session = session;
+
+    // The first position is queued before the worker can get an engine
+    batch_feed(batch, worker);
+
+    if(carrier->open) carrier->open(session);
+  }
+}
+
+/*
+ * Handle the lines of the client, after it has sent batch
+ */
+void batch_input(batch_t* batch)
+{
+  session_t* carrier = batch->carrier;
+
+  char* line;
+  ssize_t length;
+
+  while((length = reader_take(&carrier->conn.reader, &line)) > 0)
+  {
+    while(length > 0 && isspace((unsigned char) line[length - 1])) length--;
+
+    if(length == 0) continue;
+
+    line[length] = '\0';
+
+    if(uci_command(line, "end"))
+    {
+      batch->ended = true;
+    }
+    else if(strncmp(line, "go", 2) == 0 && (length == 2 || line[2] == ' '))
+    {
+      if(batch_limits(batch, line, length) != 0)
+      {
+        if(carrier->debug) error_print("Failed to set batch limits");
+      }
+    }
+    else if(batch_enqueue(batch, line, length) != 0)
+    {
+      if(carrier->debug) error_print("Failed to queue batch position");
+    }
+  }
+
+  batch_dispatch(batch);
+
+  batch_summarize(batch);
+
+  session_flush(carrier);
+}
+
+/*
+ * Follow the output of a worker, and send the result of its position
+ * when it has answered bestmove
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ */
+int batch_output(batch_t* batch, session_t* session, const char* data, size_t length)
+{
+  batch_worker_t* worker = &batch->workers[session->id - 1];
+
+  if(!worker->busy) return 0;
+
+  const char* end = data + length;
+
+  while(data < end)
+  {
+    const char* newline = memchr(data, '\n', end - data);
+
+    size_t line_length = newline ? (size_t) (newline + 1 - data) : (size_t) (end - data);
+
+    bool complete = analysis_output(&worker->analysis, data, line_length);
+
+    if(strncmp(data, "bestmove", 8) == 0)
+    {
+      analysis_t* analysis = &worker->analysis;
+
+      // Without the last pv lines, at least the bestmove is sent
+      if(complete) batch_send(batch, worker, analysis->result, analysis->result_length);
+
+      else batch_send(batch, worker, data, line_length);
+
+      if(complete) batch->nodes += batch_nodes(analysis->result, analysis->result_length);
+
+      sched_finish(&batch->sched, worker - batch->workers, timing_now());
+
+      batch->finished++;
+
+      worker->busy = false;
+
+      break;
+    }
+
+    data += line_length;
+  }
+
+  if(worker->busy) return 0;
+
+  if(!worker->feeding) batch_feed(batch, worker);
+
+  batch_summarize(batch);
+
+  // The worker might have been closed, so its engine doesn't flush the result
+  conn_flush(&batch->carrier->conn);
+
+  return 0;
+}
+
+/*
+ * A worker has got an engine, and starts on the position queued for it
+ */
+void batch_attach(batch_t* batch, session_t* session)
+{
+  batch_worker_t* worker = &batch->workers[session->id - 1];
+
+  if(worker->busy) sched_start(&batch->sched, session->id - 1, timing_now());
+}
+
+/*
+ * Remove a closed worker
+ *
+ * If the worker was closed before it had analyzed its position,
+ * because its engine stopped, the position is given up
+ */
+void batch_remove(batch_t* batch, session_t* session)
+{
+  batch_worker_t* worker = &batch->workers[session->id - 1];
+
+  worker->session = NULL;
+
+  if(!worker->busy) return;
+
+  worker->busy = false;
+
+  if(batch->carrier->closed) return;
+
+  const char* failure = "info string analysis failed\n";
+
+  batch_send(batch, worker, failure, strlen(failure));
+
+  sched_finish(&batch->sched, worker - batch->workers, timing_now());
+
+  batch->finished++;
+
+  // Another worker might still get an engine for the positions left
+  batch_dispatch(batch);
+
+  batch_summarize(batch);
+
+  conn_flush(&batch->carrier->conn);
+}
+
+/*
+ * Close every worker, before the carrier is closed
+ */
+void batch_close(batch_t* batch)
+{
+  for(size_t index = 0; index < batch->concurrency; index++)
+  {
+    session_t* session = batch->workers[index].session;
+
+    if(session) session_close(session);
+  }
+}
+
+/*
+ * The carrier has caught up, so every worker can continue
+ */
+void batch_drain(batch_t* batch)
+{
+  for(size_t index = 0; index < batch->concurrency; index++)
+  {
+    session_t* session = batch->workers[index].session;
+
+    if(session) session_resume(session);
+
+    // The carrier might have failed, and closed every worker
+    if(batch->carrier->closed) return;
+  }
+}
@@ -0,0 +1,96 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "debug.h"
+#include "timing.h"
+#include "analysis.h"
+#include "sched.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define BATCH_LIMITS "go depth 10" // Search limits until the client sends its own
+
+/*
+ * Position of a batch, with the go command it is searched with
+ */
+typedef struct
+{
+  size_t index;           // Input index of the position
+  size_t position_length;
+  size_t go_length;
+  char   commands[];      // Position and go commands, null terminated
+} batch_job_t;
+
+/*
+ * Logical session analyzing one position after another for a batch
+ */
+typedef struct
+{
+  struct session_t* session; // NULL if the worker is closed
+  size_t            index;   // Input index of the position being analyzed
+  bool              busy;
+  bool              feeding; // Positions are being given to the worker
+  analysis_t        analysis;
+} batch_worker_t;
+
+/*
+ * Batch of positions, analyzed with shared search limits
+ *
+ * After the client has sent batch as its first line, every line it sends
+ * is either a go command, setting the limits of the positions after it,
+ * a position, as a FEN, an EPD or a position command, or end, which asks
+ * for a summary when every position has been analyzed.
+ *
+ * The positions are spread over up to concurrency workers, each being a
+ * logical session with an engine of its own, by a work stealing scheduler.
+ * The result of every position is its last pv lines and bestmove,
+ * prefixed with the input index. The summary is followed by the time
+ * every worker has been busy and idle during the makespan of the batch
+ */
+typedef struct
+{
+  struct session_t* carrier;
+  batch_worker_t*   workers;
+  size_t            concurrency;
+  char*             limits;
+  size_t            limits_length;
+  sched_t           sched;        // Positions waiting for the workers
+  char*             buffer;       // Commands of the position being queued
+  size_t            buffer_length;
+  size_t            buffer_size;
+  size_t            queued;       // Number of positions queued since the summary
+  size_t            finished;     // Number of analyzed positions since the summary
+  uint64_t          nodes;
+  uint64_t          start;
+  bool              ended;        // The client has sent end
+} batch_t;
+
+extern batch_t* batch_create(struct session_t* carrier, size_t concurrency);
+
+extern void     batch_free(batch_t* batch);
+
+
+extern void     batch_input(batch_t* batch);
+
+extern int      batch_output(batch_t* batch, struct session_t* session, const char* data, size_t length);
+
+extern void     batch_attach(batch_t* batch, struct session_t* session);
+
+extern void     batch_remove(batch_t* batch, struct session_t* session);
+
+extern void     batch_close(batch_t* batch);
+
+extern void     batch_drain(batch_t* batch);
+
+#endif // BATCH_H
@@ -0,0 +1,299 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "board.h"
+
+/*
+ * Skip the spaces before the next word
+ */
+static const char* board_skip(const char* string)
+{
+  while(*string == ' ' || *string == '\t') string++;
+
+  return string;
+}
+
+/*
+ * Parse a square, like e4
+ *
+ * RETURN (int square)
+ * - >=0 | Index of the square
+ * -  -1 | Not a square
+ */
+static int board_square(const char* string)
+{
+  if(string[0] < 'a' || string[0] > 'h' || string[1] < '1' || string[1] > '8') return -1;
+
+  return 8 * (string[1] - '1') + (string[0] - 'a');
+}
+
+/*
+ * Set up board from the fields of a FEN
+ *
+ * The move counters are optional, and not kept
+ *
+ * PARAMS
+ * - const char** end | Set to the end of the FEN
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Invalid FEN
+ */
+int board_fen(board_t* board, const char* fen, const char** end)
+{
+  *board = (board_t) { .enpassant = -1 };
+
+  int row  = 7;
+  int file = 0;
+
+  for(fen = board_skip(fen); *fen && *fen != ' '; fen++)
+  {
+    if(*fen == '/')
+    {
+      if(file != 8 || --row < 0) return 1;
+
+      file = 0;
+    }
+    else if(*fen >= '1' && *fen <= '8')
+    {
+      file += *fen - '0';
+    }
+    else if(strchr("pnbrqkPNBRQK", *fen) && file < 8)
+    {
+      board->squares[8 * row + file++] = *fen;
+    }
+    else return 1;
+
+    if(file > 8) return 1;
+  }
+
+  if(row != 0 || file != 8) return 1;
+
+  fen = board_skip(fen);
+
+  if(*fen != 'w' && *fen != 'b') return 1;
+
+  board->white = (*fen++ == 'w');
+
+  for(fen = board_skip(fen); *fen && *fen != ' '; fen++)
+  {
+    if(*fen == 'K') board->castling |= BOARD_WHITE_SHORT;
+
+    else if(*fen == 'Q') board->castling |= BOARD_WHITE_LONG;
+
+    else if(*fen == 'k') board->castling |= BOARD_BLACK_SHORT;
+
+    else if(*fen == 'q') board->castling |= BOARD_BLACK_LONG;
+
+    else if(*fen != '-') return 1;
+  }
+
+  fen = board_skip(fen);
+
+  if(*fen == '-') fen++;
+
+  else if((board->enpassant = board_square(fen)) != -1) fen += 2;
+
+  else return 1;
+
+  // The halfmove clock and the fullmove number
+  for(int index = 0; index < 2; index++)
+  {
+    const char* field = board_skip(fen);
+
+    if(!isdigit((unsigned char) *field)) break;
+
+    while(isdigit((unsigned char) *field)) field++;
+
+    fen = field;
+  }
+
+  board->valid = true;
+
+  *end = fen;
+
+  return 0;
+}
+
+/*
+ * Take castling rights away, when a king or a rook leaves its square,
+ * or a rook is captured on it
+ */
+static void board_castling_update(board_t* board, int square)
+{
+  switch(square)
+  {
+    case  4: board->castling &= ~(BOARD_WHITE_SHORT | BOARD_WHITE_LONG); break;
+    case  0: board->castling &= ~BOARD_WHITE_LONG;  break;
+    case  7: board->castling &= ~BOARD_WHITE_SHORT; break;
+    case 60: board->castling &= ~(BOARD_BLACK_SHORT | BOARD_BLACK_LONG); break;
+    case 56: board->castling &= ~BOARD_BLACK_LONG;  break;
+    case 63: board->castling &= ~BOARD_BLACK_SHORT; break;
+  }
+}
+
+/*
+ * Apply a move in long algebraic notation, like e2e4 or e7e8q
+ *
+ * Castling is given as the king moving two squares
+ *
+ * PARAMS
+ * - const char** end | Set to the end of the move
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Invalid move, or no piece on the square it moves from
+ */
+int board_move(board_t* board, const char* move, const char** end)
+{
+  int from = board_square(move);
+  int to   = board_square(move + 2);
+
+  if(from == -1 || to == -1 || !board->squares[from]) return 1;
+
+  move += 4;
+
+  char piece = board->squares[from];
+
+  char type = tolower((unsigned char) piece);
+
+  if(type == 'p' && to == board->enpassant && from % 8 != to % 8 && !board->squares[to])
+  {
+    // The captured pawn is beside the pawn, not on the passed square
+    board->squares[(from / 8) * 8 + to % 8] = 0;
+  }
+
+  if(type == 'k' && (to - from == 2 || from - to == 2))
+  {
+    int rook_from = (to > from) ? from + 3 : from - 4;
+    int rook_to   = (to > from) ? from + 1 : from - 1;
+
+    board->squares[rook_to]   = board->squares[rook_from];
+    board->squares[rook_from] = 0;
+  }
+
+  if(*move && strchr("nbrq", *move))
+  {
+    piece = board->white ? toupper((unsigned char) *move) : *move;
+
+    move++;
+  }
+
+  board->squares[to]   = piece;
+  board->squares[from] = 0;
+
+  board_castling_update(board, from);
+
+  board_castling_update(board, to);
+
+  board->enpassant = (type == 'p' && (to - from == 16 || from - to == 16)) ? (from + to) / 2 : -1;
+
+  board->white = !board->white;
+
+  *end = move;
+
+  return 0;
+}
+
+/*
+ * Follow a position command, from startpos or a FEN and its moves
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | The position can't be followed
+ */
+int board_position(board_t* board, const char* line, size_t length)
+{
+  board->valid = false;
+
+  if(strncmp(line, "position ", 9) != 0) return 1;
+
+  const char* string = board_skip(line + 9);
+
+  if(strncmp(string, "startpos", 8) == 0)
+  {
+    const char* end;
+
+    board_fen(board, BOARD_START, &end);
+
+    string += 8;
+  }
+  else if(strncmp(string, "fen ", 4) == 0)
+  {
+    if(board_fen(board, string + 4, &string) != 0) return 1;
+  }
+  else return 1;
+
+  board->valid = false;
+
+  string = board_skip(string);
+
+  if(strncmp(string, "moves", 5) == 0)
+  {
+    string = board_skip(string + 5);
+
+    while(*string && !isspace((unsigned char) *string))
+    {
+      if(board_move(board, string, &string) != 0) return 1;
+
+      string = board_skip(string);
+    }
+  }
+
+  // Anything but a newline after the moves is not understood
+  if(*string && *string != '\n' && *string != '\r') return 1;
+
+  board->valid = true;
+
+  return 0;
+}
+
+/*
+ * Get the Polyglot key of board
+ *
+ * The en passant file is only part of the key
+ * if a pawn of the side to move can capture en passant
+ */
+uint64_t board_key(const board_t* board)
+{
+  uint64_t key = 0;
+
+  for(int square = 0; square < 64; square++)
+  {
+    char piece = board->squares[square];
+
+    if(!piece) continue;
+
+    // Black pawn, white pawn, black knight, and so on
+    int kind = 2 * (strchr("pnbrqk", tolower((unsigned char) piece)) - "pnbrqk") + (isupper((unsigned char) piece) ? 1 : 0);
+
+    key ^= zobrist_random[ZOBRIST_PIECE + 64 * kind + square];
+  }
+
+  if(board->castling & BOARD_WHITE_SHORT) key ^= zobrist_random[ZOBRIST_CASTLE + 0];
+  if(board->castling & BOARD_WHITE_LONG)  key ^= zobrist_random[ZOBRIST_CASTLE + 1];
+  if(board->castling & BOARD_BLACK_SHORT) key ^= zobrist_random[ZOBRIST_CASTLE + 2];
+  if(board->castling & BOARD_BLACK_LONG)  key ^= zobrist_random[ZOBRIST_CASTLE + 3];
+
+  if(board->enpassant != -1)
+  {
+    int file = board->enpassant % 8;
+
+    // The pawn that moved two squares, and the pawns that could capture it
+    int  row  = board->white ? 4 : 3;
+    char pawn = board->white ? 'P' : 'p';
+
+    if((file > 0 && board->squares[8 * row + file - 1] == pawn) ||
+       (file < 7 && board->squares[8 * row + file + 1] == pawn))
+    {
+      key ^= zobrist_random[ZOBRIST_ENPASSANT + file];
+    }
+  }
+
+  if(board->white) key ^= zobrist_random[ZOBRIST_TURN];
+
+  return key;
+}
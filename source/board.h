@@ -0,0 +1,50 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include "zobrist.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+
+#define BOARD_START "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+#define BOARD_WHITE_SHORT 1
+#define BOARD_WHITE_LONG  2
+#define BOARD_BLACK_SHORT 4
+#define BOARD_BLACK_LONG  8
+
+/*
+ * Position of a client, followed from its position commands
+ *
+ * The squares are indexed by 8 * row + file, from a1 to h8,
+ * and hold the FEN letter of their piece, or 0 when empty.
+ * Moves are applied without checking that they are legal,
+ * the engine would have been given the same moves
+ */
+typedef struct
+{
+  char squares[64];
+  bool white;       // White to move
+  int  castling;    // Castling rights that are left
+  int  enpassant;   // Square passed by a pawn that just moved two squares (-1 if none)
+  bool valid;       // The last position command could be followed
+} board_t;
+
+extern int      board_fen(board_t* board, const char* fen, const char** end);
+
+extern int      board_move(board_t* board, const char* move, const char** end);
+
+extern int      board_position(board_t* board, const char* line, size_t length);
+
+extern uint64_t board_key(const board_t* board);
+
+#endif // BOARD_H
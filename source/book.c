@@ -0,0 +1,238 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "book.h"
+
+/*
+ * Read a big endian number of size bytes
+ */
+static uint64_t book_number(const unsigned char* bytes, int size)
+{
+  uint64_t number = 0;
+
+  for(int index = 0; index < size; index++)
+  {
+    number = (number << 8) | bytes[index];
+  }
+
+  return number;
+}
+
+/*
+ * Get the key of the entry at index
+ */
+static uint64_t book_key(const book_t* book, size_t index)
+{
+  return book_number(book->entries + index * BOOK_ENTRY, 8);
+}
+
+/*
+ * Open a Polyglot book and map it into memory
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to open or stat book
+ * - 2 | The book is empty, or not a whole number of entries
+ * - 3 | Failed to map book
+ */
+int book_open(book_t* book, const char* path, book_weighting_t weighting, bool debug)
+{
+  *book = (book_t) { .fd = -1, .weighting = weighting };
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+  if(fd == -1)
+  {
+    if(debug) error_print("Failed to open book (%s): %s", path, strerror(errno));
+
+    return 1;
+  }
+
+  struct stat status;
+
+  if(fstat(fd, &status) == -1)
+  {
+    if(debug) error_print("Failed to stat book: %s", strerror(errno));
+
+    close(fd);
+
+    return 1;
+  }
+
+  if(status.st_size == 0 || status.st_size % BOOK_ENTRY != 0)
+  {
+    if(debug) error_print("Not a Polyglot book (%s)", path);
+
+    close(fd);
+
+    return 2;
+  }
+
+  void* entries = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+  if(entries == MAP_FAILED)
+  {
+    if(debug) error_print("Failed to map book: %s", strerror(errno));
+
+    close(fd);
+
+    return 3;
+  }
+
+  // A probe only touches the pages on the path of the binary search
+  madvise(entries, status.st_size, MADV_RANDOM);
+
+  book->fd      = fd;
+  book->entries = entries;
+  book->size    = status.st_size;
+  book->count   = status.st_size / BOOK_ENTRY;
+  book->seed    = time(NULL);
+
+  if(debug) info_print("Opened book with %ld entries", (long) book->count);
+
+  return 0;
+}
+
+/*
+ * Unmap and close the book
+ */
+void book_close(book_t* book)
+{
+  if(book->entries) munmap((void*) book->entries, book->size);
+
+  if(book->fd != -1) close(book->fd);
+
+  book->entries = NULL;
+  book->fd      = -1;
+}
+
+/*
+ * Find the first entry with key
+ *
+ * RETURN (size_t index)
+ * - count | No entry has the key
+ */
+static size_t book_find(const book_t* book, uint64_t key)
+{
+  size_t low  = 0;
+  size_t high = book->count;
+
+  while(low < high)
+  {
+    size_t middle = low + (high - low) / 2;
+
+    if(book_key(book, middle) < key) low = middle + 1;
+
+    else high = middle;
+  }
+
+  return (low < book->count && book_key(book, low) == key) ? low : book->count;
+}
+
+/*
+ * Choose one of the entries from first to last, by the weighting of the book
+ *
+ * RETURN (size_t index)
+ */
+static size_t book_choose(book_t* book, size_t first, size_t last)
+{
+  size_t best = first;
+
+  uint64_t total = 0;
+
+  for(size_t index = first; index < last; index++)
+  {
+    uint64_t weight = book_number(book->entries + index * BOOK_ENTRY + 10, 2);
+
+    if(weight > book_number(book->entries + best * BOOK_ENTRY + 10, 2)) best = index;
+
+    total += weight;
+  }
+
+  if(book->weighting == BOOK_BEST || total == 0) return best;
+
+  uint64_t pick = rand_r(&book->seed) % total;
+
+  for(size_t index = first; index < last; index++)
+  {
+    uint64_t weight = book_number(book->entries + index * BOOK_ENTRY + 10, 2);
+
+    if(pick < weight) return index;
+
+    pick -= weight;
+  }
+
+  return best;
+}
+
+/*
+ * Write a Polyglot move in long algebraic notation
+ *
+ * Polyglot encodes castling as the king taking its own rook,
+ * which is the king moving two squares in UCI
+ *
+ * PARAMS
+ * - char* move | Room for 6 characters
+ */
+static void book_move_write(const board_t* board, unsigned int code, char* move)
+{
+  int to   = code & 0x3f;
+  int from = (code >> 6) & 0x3f;
+
+  int promotion = (code >> 12) & 0x7;
+
+  char piece = board->squares[from];
+
+  if((piece == 'K' && from == 4) || (piece == 'k' && from == 60))
+  {
+    if(to == from + 3) to = from + 2;
+
+    else if(to == from - 4) to = from - 2;
+  }
+
+  move[0] = 'a' + from % 8;
+  move[1] = '1' + from / 8;
+  move[2] = 'a' + to % 8;
+  move[3] = '1' + to / 8;
+
+  int length = 4;
+
+  if(promotion > 0 && promotion <= 4) move[length++] = " nbrq"[promotion];
+
+  move[length] = '\0';
+}
+
+/*
+ * Look up the position of board in the book
+ *
+ * PARAMS
+ * - char* move | Room for 6 characters, set to the chosen move
+ *
+ * RETURN (bool found)
+ */
+bool book_probe(book_t* book, const board_t* board, char* move)
+{
+  size_t first = book_find(book, board_key(board));
+
+  if(first == book->count)
+  {
+    book->misses++;
+
+    return false;
+  }
+
+  size_t last = first + 1;
+
+  while(last < book->count && book_key(book, last) == book_key(book, first)) last++;
+
+  size_t index = book_choose(book, first, last);
+
+  book_move_write(board, book_number(book->entries + index * BOOK_ENTRY + 8, 2), move);
+
+  book->hits++;
+
+  return true;
+}
@@ -0,0 +1,61 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef BOOK_H
+#define BOOK_H
+
+#include "debug.h"
+#include "board.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BOOK_ENTRY 16 // Key, move, weight and learn, big endian
+
+/*
+ * How a move is chosen among the moves of a book position
+ */
+typedef enum
+{
+  BOOK_BEST,     // The move with the highest weight
+  BOOK_WEIGHTED  // A random move, in proportion to its weight
+} book_weighting_t;
+
+/*
+ * Polyglot opening book, memory mapped read only
+ *
+ * The entries are sorted by key, so the moves of a position
+ * are found by binary search, without reading the whole book
+ */
+typedef struct
+{
+  int                  fd;
+  const unsigned char* entries;
+  size_t               count;
+  size_t               size;      // Size of the mapping
+  book_weighting_t     weighting;
+  unsigned int         seed;      // State of the weighted choice
+  size_t               hits;      // Searches answered from the book
+  size_t               misses;    // Searches of positions not in the book
+} book_t;
+
+extern int  book_open(book_t* book, const char* path, book_weighting_t weighting, bool debug);
+
+extern void book_close(book_t* book);
+
+
+extern bool book_probe(book_t* book, const board_t* board, char* move);
+
+#endif // BOOK_H
@@ -0,0 +1,246 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#include "cache.h"
+
+/*
+ * Hash key with 64-bit FNV-1a
+ */
+static uint64_t cache_hash(const char* key, size_t length)
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+  for(size_t index = 0; index < length; index++)
+  {
+    hash ^= (unsigned char) key[index];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+/*
+ * Get the number of bytes an entry uses
+ */
+static size_t cache_entry_size(size_t key_length, size_t value_length)
+{
+  return sizeof(cache_entry_t) + key_length + value_length;
+}
+
+/*
+ * Create cache, with a memory budget in bytes
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate hash table
+ */
+int cache_init(cache_t* cache, size_t budget)
+{
+  *cache = (cache_t) { .budget = budget };
+
+  size_t bucket_count = 16;
+
+  while(bucket_count < budget / CACHE_BUCKET_BYTES) bucket_count *= 2;
+
+  cache->buckets = calloc(bucket_count, sizeof(cache_entry_t*));
+  cache->clock   = calloc(bucket_count, sizeof(cache_entry_t*));
+
+  if(!cache->buckets || !cache->clock)
+  {
+    cache_free(cache);
+
+    return 1;
+  }
+
+  cache->bucket_count = bucket_count;
+  cache->capacity     = bucket_count;
+
+  return 0;
+}
+
+/*
+ * Free the entries and the hash table of cache
+ */
+void cache_free(cache_t* cache)
+{
+  for(size_t index = 0; index < cache->count; index++)
+  {
+    free(cache->clock[index]->key);
+    free(cache->clock[index]->value);
+    free(cache->clock[index]);
+  }
+
+  free(cache->buckets);
+  free(cache->clock);
+
+  *cache = (cache_t) { 0 };
+}
+
+/*
+ * Remove entry from the bucket it is chained in
+ */
+static void cache_unlink(cache_t* cache, cache_entry_t* entry)
+{
+  cache_entry_t** pointer = &cache->buckets[entry->hash & (cache->bucket_count - 1)];
+
+  while(*pointer != entry) pointer = &(*pointer)->next;
+
+  *pointer = entry->next;
+}
+
+/*
+ * Evict the first unreferenced entry after the clock hand
+ *
+ * The last entry of the clock is moved into the free slot
+ */
+static void cache_evict(cache_t* cache)
+{
+  while(cache->clock[cache->hand]->referenced)
+  {
+    cache->clock[cache->hand]->referenced = false;
+
+    cache->hand = (cache->hand + 1) % cache->count;
+  }
+
+  cache_entry_t* entry = cache->clock[cache->hand];
+
+  cache_unlink(cache, entry);
+
+  cache->used -= cache_entry_size(entry->key_length, entry->value_length);
+
+  cache->clock[cache->hand] = cache->clock[--cache->count];
+
+  if(cache->hand >= cache->count) cache->hand = 0;
+
+  free(entry->key);
+  free(entry->value);
+  free(entry);
+
+  cache->evictions++;
+}
+
+/*
+ * Find the entry of key, without counting it as a use
+ */
+static cache_entry_t* cache_find(cache_t* cache, uint64_t hash, const char* key, size_t length)
+{
+  cache_entry_t* entry = cache->buckets[hash & (cache->bucket_count - 1)];
+
+  for(; entry; entry = entry->next)
+  {
+    if(entry->hash == hash && entry->key_length == length &&
+       memcmp(entry->key, key, length) == 0) return entry;
+  }
+
+  return NULL;
+}
+
+/*
+ * Look up the cached result of key
+ *
+ * The entry stays valid until the next entry is put in the cache
+ *
+ * RETURN (cache_entry_t* entry)
+ * - NULL | The result is not cached
+ */
+cache_entry_t* cache_get(cache_t* cache, const char* key, size_t length)
+{
+  cache_entry_t* entry = cache_find(cache, cache_hash(key, length), key, length);
+
+  if(!entry)
+  {
+    cache->misses++;
+
+    return NULL;
+  }
+
+  entry->referenced = true;
+
+  cache->hits++;
+
+  return entry;
+}
+
+/*
+ * Put the result of key in the cache, replacing any earlier result
+ *
+ * Entries are evicted until the new entry fits in the budget
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | The entry is larger than the budget
+ * - 2 | Failed to allocate entry
+ */
+int cache_put(cache_t* cache, const char* key, size_t key_length, const char* value, size_t value_length)
+{
+  size_t size = cache_entry_size(key_length, value_length);
+
+  if(size > cache->budget) return 1;
+
+  uint64_t hash = cache_hash(key, key_length);
+
+  cache_entry_t* entry = cache_find(cache, hash, key, key_length);
+
+  if(entry)
+  {
+    char* copy = malloc(value_length);
+
+    if(!copy) return 2;
+
+    memcpy(copy, value, value_length);
+
+    free(entry->value);
+
+    cache->used += value_length - entry->value_length;
+
+    entry->value        = copy;
+    entry->value_length = value_length;
+
+    while(cache->used > cache->budget && cache->count > 1) cache_evict(cache);
+
+    return 0;
+  }
+
+  while(cache->count > 0 && (cache->used + size > cache->budget || cache->count == cache->capacity))
+  {
+    cache_evict(cache);
+  }
+
+  entry = malloc(sizeof(cache_entry_t));
+
+  if(!entry) return 2;
+
+  *entry = (cache_entry_t) { .hash = hash, .key_length = key_length, .value_length = value_length };
+
+  entry->key   = malloc(key_length);
+  entry->value = malloc(value_length);
+
+  if(!entry->key || !entry->value)
+  {
+    free(entry->key);
+    free(entry->value);
+    free(entry);
+
+    return 2;
+  }
+
+  memcpy(entry->key,   key,   key_length);
+  memcpy(entry->value, value, value_length);
+
+  size_t bucket = hash & (cache->bucket_count - 1);
+
+  entry->next = cache->buckets[bucket];
+
+  cache->buckets[bucket] = entry;
+
+  cache->clock[cache->count++] = entry;
+
+  cache->used += size;
+
+  cache->inserts++;
+
+  return 0;
+}
@@ -0,0 +1,65 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes of budget per bucket of the hash table
+#define CACHE_BUCKET_BYTES 512
+
+/*
+ * Cached analysis result, the lines an engine answered a search with
+ */
+typedef struct cache_entry_t
+{
+  uint64_t              hash;
+  char*                 key;
+  size_t                key_length;
+  char*                 value;
+  size_t                value_length;
+  bool                  referenced; // Used since the clock hand passed
+  struct cache_entry_t* next;       // Next entry in the same bucket
+} cache_entry_t;
+
+/*
+ * Hash table of analysis results, bounded by a memory budget
+ *
+ * When the budget is full, entries are evicted by the CLOCK algorithm:
+ * the hand sweeps over the entries, giving referenced entries
+ * a second chance, and evicting the first unreferenced entry
+ */
+typedef struct
+{
+  cache_entry_t** buckets;
+  size_t          bucket_count;  // Power of two
+  cache_entry_t** clock;
+  size_t          capacity;
+  size_t          count;
+  size_t          hand;
+  size_t          budget;        // Maximum number of bytes
+  size_t          used;          // Number of bytes used by the entries
+  size_t          hits;
+  size_t          misses;
+  size_t          inserts;
+  size_t          evictions;
+} cache_t;
+
+extern int            cache_init(cache_t* cache, size_t budget);
+
+extern void           cache_free(cache_t* cache);
+
+
+extern cache_entry_t* cache_get(cache_t* cache, const char* key, size_t length);
+
+extern int            cache_put(cache_t* cache, const char* key, size_t key_length, const char* value, size_t value_length);
+
+#endif // CACHE_H
@@ -0,0 +1,481 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#include "conn.h"
+#include "uring.h"
+
+/*
+ * Make file descriptor non-blocking
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to get or set file status flags
+ */
+static int fd_nonblock(int fd)
+{
+  int flags = fcntl(fd, F_GETFL);
+
+  if(flags == -1) return -1;
+
+  return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/*
+ * Tell the event loop which events the connection waits for
+ */
+static void conn_update(conn_t* conn)
+{
+  if(uring_active())
+  {
+    uring_conn_update(conn);
+
+    return;
+  }
+
+  uint32_t in_events  = conn->reading ? EPOLLIN  : 0;
+  uint32_t out_events = conn->writing ? EPOLLOUT : 0;
+
+  if(conn->in == conn->out)
+  {
+    event_mod(&conn->in_event, in_events | out_events);
+  }
+  else
+  {
+    event_mod(&conn->in_event, in_events);
+
+    event_mod(&conn->out_event, out_events);
+  }
+}
+
+/*
+ * Call the close handler of the connection, if it is still open
+ */
+void conn_fail(conn_t* conn)
+{
+  if(conn->closed) return;
+
+  if(conn->close) conn->close(conn);
+
+  // The close handler is expected to close the connection
+  if(!conn->closed) conn_close(conn);
+}
+
+/*
+ * Write pending output, after the event loop said it can be written
+ */
+static void conn_writable(conn_t* conn)
+{
+  int status = writer_flush(&conn->writer);
+
+  if(status == -1)
+  {
+    conn_fail(conn);
+
+    return;
+  }
+
+  if(status == 1) return;
+
+  conn->writing = false;
+
+  conn_update(conn);
+
+  if(conn->drain) conn->drain(conn);
+}
+
+/*
+ * Splice available input to the target connection
+ *
+ * If the target can't take more, input is paused until it has drained
+ */
+static void conn_spliceable(conn_t* conn)
+{
+  conn_t* target = conn->target;
+
+  ssize_t size = splicer_relay(&conn->splicer, conn->in, target->out);
+
+  if(size > 0)
+  {
+    if(conn->relay) conn->relay(conn);
+
+    return;
+  }
+
+  if(size == -1 && (errno == EAGAIN || errno == EINTR))
+  {
+    conn_pause(conn);
+
+    target->writing = true;
+
+    conn_update(target);
+
+    return;
+  }
+
+  // End of file comes from the input, errors most likely from the target
+  conn_fail((size == 0) ? conn : target);
+}
+
+/*
+ * Read available input and let the input handler process it
+ */
+static void conn_readable(conn_t* conn)
+{
+  if(conn->target)
+  {
+    conn_spliceable(conn);
+
+    return;
+  }
+
+  ssize_t size = reader_fill(&conn->reader);
+
+  if(size == -1 && (errno == EAGAIN || errno == EINTR)) return;
+
+  // At end of file, the last line might be missing a newline
+  if(size > 0 || conn->reader.length > 0)
+  {
+    if(conn->input) conn->input(conn);
+  }
+
+  if(size <= 0) conn_fail(conn);
+}
+
+/*
+ * Event handler shared by the input and output file descriptors
+ */
+static void conn_event(event_t* event, uint32_t events)
+{
+  conn_t* conn = event->data;
+
+  if(conn->closed) return;
+
+  if(event->fd == conn->out && (events & (EPOLLOUT | EPOLLERR)))
+  {
+    if(conn->writing) conn_writable(conn);
+
+    // The reader of the output has gone away
+    else if(events & EPOLLERR) conn_fail(conn);
+  }
+
+  if(conn->closed) return;
+
+  if(event->fd == conn->in && (events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+  {
+    conn_readable(conn);
+  }
+}
+
+/*
+ * Open connection for reading from in and writing to out
+ *
+ * With epoll, both file descriptors are made non-blocking and added
+ * to the event loop. With io_uring, they are kept blocking, because
+ * io_uring waits for them by itself, and a read is queued
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate reader or writer
+ * - 2 | Failed to add file descriptors to event loop
+ */
+int conn_open(conn_t* conn, int in, int out, void* data)
+{
+  *conn = (conn_t) { .in = in, .out = out, .data = data, .reading = true };
+
+  conn->splicer = (splicer_t) { .pipe = { -1, -1 } };
+
+  conn->uring = (conn_uring_t) { .in_file = -1, .out_file = -1, .buffer = -1 };
+
+  int reader_status = reader_init(&conn->reader, in);
+  int writer_status = writer_init(&conn->writer, out);
+
+  if(reader_status != 0 || writer_status != 0)
+  {
+    reader_free(&conn->reader);
+
+    writer_free(&conn->writer);
+
+    return 1;
+  }
+
+  if(uring_active())
+  {
+    if(uring_conn_open(conn) != 0)
+    {
+      conn_close(conn);
+
+      return 2;
+    }
+
+    return 0;
+  }
+
+  fd_nonblock(in);
+
+  if(out != in) fd_nonblock(out);
+
+  conn->in_event  = (event_t) { .fd = in,  .handler = conn_event, .data = conn };
+  conn->out_event = (event_t) { .fd = out, .handler = conn_event, .data = conn };
+
+  if(event_add(&conn->in_event, EPOLLIN) == -1 ||
+    (out != in && event_add(&conn->out_event, 0) == -1))
+  {
+    conn_close(conn);
+
+    return 2;
+  }
+
+  return 0;
+}
+
+/*
+ * Free the buffers of a closed connection
+ */
+void conn_release(conn_t* conn)
+{
+  reader_free(&conn->reader);
+
+  writer_free(&conn->writer);
+
+  splicer_free(&conn->splicer);
+
+  free(conn->uring.flight);
+
+  conn->uring.flight      = NULL;
+  conn->uring.flight_size = 0;
+}
+
+/*
+ * Check if io_uring still has operations queued on the connection,
+ * in which case it can't be freed yet
+ */
+bool conn_busy(conn_t* conn)
+{
+  return conn->uring.queued > 0;
+}
+
+/*
+ * Wait until the output of connection has been written,
+ * and if it is closed, until its buffers have been freed
+ *
+ * With epoll, output is written right away, so there is nothing to wait for
+ */
+void conn_settle(conn_t* conn)
+{
+  if(!uring_active()) return;
+
+  while(conn_busy(conn) && (conn->closed || conn->uring.writing))
+  {
+    if(uring_wait(-1) == -1 && errno != EINTR) break;
+  }
+}
+
+/*
+ * Remove connection from the event loop and free its buffers
+ *
+ * Buffers still used by queued io_uring operations are freed
+ * when the operations complete, see conn_busy.
+ * The file descriptors are not closed, they belong to the caller
+ */
+void conn_close(conn_t* conn)
+{
+  if(conn->closed) return;
+
+  if(uring_active())
+  {
+    uring_conn_close(conn);
+  }
+  else
+  {
+    event_del(&conn->in_event);
+
+    event_del(&conn->out_event);
+  }
+
+  conn->target = NULL;
+
+  conn->closed = true;
+
+  if(!conn_busy(conn)) conn_release(conn);
+}
+
+/*
+ * Stop reading input until the connection is resumed
+ */
+void conn_pause(conn_t* conn)
+{
+  if(conn->closed || !conn->reading) return;
+
+  conn->reading = false;
+
+  conn_update(conn);
+}
+
+/*
+ * Start reading input again
+ */
+void conn_resume(conn_t* conn)
+{
+  if(conn->closed || conn->reading) return;
+
+  conn->reading = true;
+
+  conn_update(conn);
+}
+
+/*
+ * Make room for another segment in the writer
+ *
+ * With io_uring, the writer can't flush by itself when it is full,
+ * because the file descriptor is blocking and earlier output
+ * might still be in flight
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to write
+ */
+static int conn_reserve(conn_t* conn)
+{
+  if(!uring_active() || conn->writer.count < WRITER_IOV_MAX) return 0;
+
+  return (uring_conn_flush(conn) == -1) ? -1 : 0;
+}
+
+/*
+ * Queue a line, without copying it
+ *
+ * The line has to stay valid until the connection is flushed
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to queue line
+ */
+int conn_line(conn_t* conn, const char* line, size_t length)
+{
+  if(conn->closed || conn_reserve(conn) == -1) return -1;
+
+  return writer_line(&conn->writer, line, length);
+}
+
+/*
+ * Queue data, by copying it
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to queue data
+ */
+int conn_write(conn_t* conn, const char* data, size_t length)
+{
+  if(conn->closed || conn_reserve(conn) == -1) return -1;
+
+  return writer_copy(&conn->writer, data, length);
+}
+
+/*
+ * Queue a message and flush the connection
+ *
+ * RETURN (same as conn_flush)
+ */
+int conn_message(conn_t* conn, const char* message)
+{
+  if(conn_write(conn, message, strlen(message)) == -1) return -1;
+
+  return conn_flush(conn);
+}
+
+/*
+ * Write as much pending output as possible without blocking
+ *
+ * If everything can't be written, the rest is copied and
+ * written when the event loop says the connection is writable.
+ * With io_uring, the output is handed to a queued write instead
+ *
+ * RETURN (int status)
+ * -  0 | Everything has been written
+ * -  1 | Some output is still pending
+ * - -1 | Failed to write, the connection has been closed
+ */
+int conn_flush(conn_t* conn)
+{
+  if(conn->closed) return -1;
+
+  if(!writer_pending(&conn->writer)) return 0;
+
+  if(uring_active()) return uring_conn_flush(conn);
+
+  int status = writer_flush(&conn->writer);
+
+  if(status == -1)
+  {
+    conn_fail(conn);
+
+    return -1;
+  }
+
+  bool writing = (status == 1);
+
+  if(writing != conn->writing)
+  {
+    conn->writing = writing;
+
+    conn_update(conn);
+  }
+
+  return status;
+}
+
+/*
+ * Get the number of output bytes that have not been written yet
+ */
+size_t conn_pending(conn_t* conn)
+{
+  size_t pending = conn->writer.length;
+
+  if(conn->uring.writing) pending += conn->uring.flight_length - conn->uring.flight_offset;
+
+  return pending;
+}
+
+/*
+ * Splice the input of connection to the output of target,
+ * instead of reading it into the reader
+ *
+ * Input already buffered by the reader is written to target first.
+ * With target as NULL, the input is read into the reader again
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to create splice pipe, or io_uring is used
+ */
+int conn_splice(conn_t* conn, conn_t* target)
+{
+  if(conn->closed) return 1;
+
+  // A queued io_uring read can't be taken back, so input is never spliced
+  if(uring_active()) return (target != NULL) ? 1 : 0;
+
+  splicer_free(&conn->splicer);
+
+  conn->target = NULL;
+
+  if(!target) return 0;
+
+  char* data;
+  ssize_t length;
+
+  if((length = reader_rest(&conn->reader, &data)) > 0)
+  {
+    conn_write(target, data, length);
+
+    conn_flush(target);
+  }
+
+  if(splicer_init(&conn->splicer, conn->in, target->out) != 0) return 1;
+
+  conn->target = target;
+
+  return 0;
+}
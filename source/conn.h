@@ -0,0 +1,108 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#ifndef CONN_H
+#define CONN_H
+
+#include "event.h"
+#include "reader.h"
+#include "writer.h"
+#include "splice.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <errno.h>
+
+typedef struct conn_t conn_t;
+
+typedef void (*conn_handler_t)(conn_t* conn);
+
+/*
+ * State of a connection driven by io_uring instead of epoll
+ */
+typedef struct
+{
+  int     in_file;       // Index of in in the fixed file table
+  int     out_file;      // Index of out in the fixed file table
+  int     buffer;        // Index of the reader buffer in the buffer table
+  char*   registered;    // The reader buffer, as it was registered
+  char*   flight;        // Output being written
+  size_t  flight_size;
+  size_t  flight_length;
+  size_t  flight_offset;
+  bool    reading;       // A read is queued
+  bool    writing;       // A write is queued
+  int     queued;        // Number of queued operations
+  bool    retry_read;    // The read is queued once the submission queue has room
+  bool    retry_cancel;  // The operations are canceled once the submission queue has room
+  conn_t* deferred;      // Next connection waiting for the submission queue
+} conn_uring_t;
+
+/*
+ * Non-blocking connection, reading lines from one file descriptor
+ * and writing to another (or the same, in the case of a socket)
+ *
+ * The connection is driven either by epoll or, if it has been
+ * initialized, by io_uring. The handlers are called by the event loop:
+ * - input | New input has been buffered in the reader
+ * - drain | All pending output has been written
+ * - relay | Input has been spliced to the target
+ * - close | End of file, or failure to read or write
+ */
+struct conn_t
+{
+  int            in;
+  int            out;
+  reader_t       reader;
+  writer_t       writer;
+  event_t        in_event;
+  event_t        out_event;
+  bool           reading;  // Waiting for input
+  bool           writing;  // Waiting for pending output to drain
+  bool           closed;
+  conn_t*        target;   // Connection input is spliced to, if any
+  splicer_t      splicer;
+  conn_uring_t   uring;
+  conn_handler_t input;
+  conn_handler_t drain;
+  conn_handler_t relay;
+  conn_handler_t close;
+  void*          data;
+};
+
+extern int  conn_open(conn_t* conn, int in, int out, void* data);
+
+extern void conn_close(conn_t* conn);
+
+extern void conn_fail(conn_t* conn);
+
+extern void conn_release(conn_t* conn);
+
+extern bool conn_busy(conn_t* conn);
+
+extern void conn_settle(conn_t* conn);
+
+
+extern void conn_pause(conn_t* conn);
+
+extern void conn_resume(conn_t* conn);
+
+
+extern int  conn_line(conn_t* conn, const char* line, size_t length);
+
+extern int  conn_write(conn_t* conn, const char* data, size_t length);
+
+extern int  conn_message(conn_t* conn, const char* message);
+
+extern int  conn_flush(conn_t* conn);
+
+extern size_t conn_pending(conn_t* conn);
+
+
+extern int  conn_splice(conn_t* conn, conn_t* target);
+
+#endif // CONN_H
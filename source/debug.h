@@ -1,17 +1,18 @@
 /*
  * Written by Hampus Fridholm
  *
- * Last updated: 2024-09-08
+ * Last updated: 2026-10-17
  */
 
 #ifndef DEBUG_H
 #define DEBUG_H
 
+#include "log.h"
+
 #include <stdio.h>
-#include <sys/time.h>
-#include <time.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stdint.h>
 
 extern int debug_print(FILE* stream, const char* title, const char* format, ...);
 
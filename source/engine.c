@@ -0,0 +1,291 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "engine.h"
+#include "session.h"
+#include "metrics.h"
+
+/*
+ * Give the options that the previous session changed their default values
+ */
+static void engine_options_restore(engine_t* engine)
+{
+  for(size_t index = 0; index < engine->uci.count; index++)
+  {
+    uci_option_t* option = &engine->uci.options[index];
+
+    if(!option->value || strcmp(option->value, option->fallback) == 0) continue;
+
+    if(engine->debug) info_print("Restoring engine option (%s)", option->name);
+
+    conn_write(&engine->conn, "setoption name ", 15);
+    conn_write(&engine->conn, option->name, strlen(option->name));
+    conn_write(&engine->conn, " value ", 7);
+    conn_write(&engine->conn, option->fallback, strlen(option->fallback));
+    conn_write(&engine->conn, "\n", 1);
+
+    uci_option_set(option, option->fallback, strlen(option->fallback));
+  }
+}
+
+/*
+ * Set up a new game, after the engine has answered uci
+ *
+ * The options are restored before the engine is asked isready,
+ * so that it only is given to a client after it has loaded
+ * everything the new game needs
+ */
+static void engine_setup(engine_t* engine)
+{
+  if(engine->debug) info_print("Setting up new engine game");
+
+  engine->uci.known = true;
+
+  engine_options_restore(engine);
+
+  conn_message(&engine->conn, "ucinewgame\nposition startpos\nisready\n");
+
+  engine->state = ENGINE_WARMING;
+}
+
+/*
+ * The engine has answered isready, and is warm for the next client
+ */
+static void engine_warm(engine_t* engine)
+{
+  engine->ready_time = timing_now();
+
+  engine->warmup = engine->ready_time - engine->reset_time;
+
+  METRICS_ADD(metrics.resets, 1);
+
+  histogram_record(&metrics.reset, engine->warmup);
+
+  if(engine->debug) info_print("Engine is ready after %f us", TIMING_MICROS(engine->warmup));
+
+  engine->state = ENGINE_READY;
+
+  if(engine->ready) engine->ready(engine);
+}
+
+/*
+ * Engine output has been spliced to the client of the engine
+ */
+static void engine_relay(conn_t* conn)
+{
+  engine_t* engine = conn->data;
+
+  if(engine->session) session_respond(engine->session);
+}
+
+/*
+ * Count an answer to a uci or isready that was sent for a session
+ *
+ * RETURN (bool counted)
+ * - false | The line doesn't answer a command of a session
+ */
+static bool engine_answered(engine_t* engine, const char* line)
+{
+  if(engine->uci_due > 0 && strncmp(line, "uciok", 5) == 0)
+  {
+    engine->uci_due--;
+
+    return true;
+  }
+
+  if(engine->isready_due > 0 && strncmp(line, "readyok", 7) == 0)
+  {
+    engine->isready_due--;
+
+    return true;
+  }
+
+  return false;
+}
+
+/*
+ * Handle output from the engine
+ *
+ * While serving a session, the output is relayed to the client,
+ * and while being reset, the output is skipped until uciok and readyok.
+ * The first uci answer is captured, to be answered from memory.
+ * Output of the previous session is skipped, because it comes before uciok,
+ * and so are the answers to the uci and isready it sent, which the node counts
+ */
+static void engine_input(conn_t* conn)
+{
+  engine_t* engine = conn->data;
+
+  char* line;
+  ssize_t length;
+
+  while((length = reader_take(&conn->reader, &line)) > 0)
+  {
+    if(engine->state == ENGINE_BUSY)
+    {
+      engine_answered(engine, line);
+
+      session_output(engine->session, line, length);
+    }
+    else if(engine_answered(engine, line))
+    {
+      if(engine->debug) info_print("Skipped answer for the previous session");
+    }
+    else if(engine->state == ENGINE_RESET && strncmp(line, "uciok", 5) == 0)
+    {
+      engine_setup(engine);
+    }
+    else if(engine->state == ENGINE_RESET)
+    {
+      if(uci_capture(&engine->uci, line, length) != 0)
+      {
+        if(engine->debug) error_print("Failed to capture uci answer");
+      }
+    }
+    else if(engine->state == ENGINE_WARMING && strncmp(line, "readyok", 7) == 0)
+    {
+      engine_warm(engine);
+    }
+  }
+
+  if(engine->state == ENGINE_BUSY) session_flush(engine->session);
+}
+
+/*
+ * The engine has closed its output, or can't be written to
+ */
+static void engine_conn_close(conn_t* conn)
+{
+  engine_t* engine = conn->data;
+
+  if(engine->debug) info_print("Engine has stopped");
+
+  engine->state = ENGINE_STOPPED;
+
+  if(engine->session) session_close(engine->session);
+
+  conn_close(conn);
+
+  if(engine->stop) engine->stop(engine);
+}
+
+/*
+ * Open engine communicating over file descriptors
+ *
+ * PARAMS
+ * - int in  | Engine output (stdin fifo)
+ * - int out | Engine input (stdout fifo)
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to open engine connection
+ */
+int engine_open(engine_t* engine, int in, int out, bool debug)
+{
+  engine->state   = ENGINE_STOPPED;
+  engine->session = NULL;
+  engine->debug   = debug;
+  engine->uci     = (uci_t) { 0 };
+
+  engine->uci_due     = 0;
+  engine->isready_due = 0;
+
+  if(conn_open(&engine->conn, in, out, engine) != 0)
+  {
+    if(debug) error_print("Failed to open engine connection");
+
+    return 1;
+  }
+
+  engine->conn.input = engine_input;
+  engine->conn.close = engine_conn_close;
+  engine->conn.relay = engine_relay;
+
+  return 0;
+}
+
+/*
+ * Close engine connection
+ *
+ * The file descriptors are not closed
+ */
+void engine_close(engine_t* engine)
+{
+  conn_close(&engine->conn);
+
+  conn_settle(&engine->conn);
+
+  uci_free(&engine->uci);
+
+  engine->state = ENGINE_STOPPED;
+}
+
+/*
+ * Let the ready engine serve session
+ *
+ * The time the engine has been waiting for it is counted as idle
+ */
+void engine_serve(engine_t* engine, struct session_t* session)
+{
+  engine->idle += timing_now() - engine->ready_time;
+
+  engine->served++;
+
+  engine->session = session;
+  engine->state   = ENGINE_BUSY;
+}
+
+/*
+ * Get the time the engine has spent ready, waiting for a session,
+ * including the time it has been waiting since it last got ready
+ */
+uint64_t engine_idle(engine_t* engine)
+{
+  if(engine->state != ENGINE_READY) return engine->idle;
+
+  return engine->idle + (timing_now() - engine->ready_time);
+}
+
+/*
+ * Reset the chess engine for the next client, by
+ * - stopping any ongoing search and
+ * - establishing UCI communication
+ *
+ * When the engine answers, a new game is set up,
+ * and the engine is ready when it has answered isready
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to write to engine
+ */
+int engine_reset(engine_t* engine)
+{
+  if(engine->debug) info_print("Establishing engine UCI communication");
+
+  engine->state      = ENGINE_RESET;
+  engine->session    = NULL;
+  engine->reset_time = timing_now();
+
+  // The previous session might have paused or spliced the engine output
+  conn_splice(&engine->conn, NULL);
+
+  conn_resume(&engine->conn);
+
+  return (conn_message(&engine->conn, "stop\nuci\n") == -1) ? 1 : 0;
+}
+
+/*
+ * Tell the chess engine to quit, by sending it a quit message
+ */
+void engine_quit(engine_t* engine)
+{
+  if(engine->debug) info_print("Quitting engine");
+
+  conn_message(&engine->conn, "quit\n");
+
+  // Nothing is written after quit, so make sure it has been written
+  conn_settle(&engine->conn);
+}
@@ -0,0 +1,69 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "debug.h"
+#include "conn.h"
+#include "timing.h"
+#include "uci.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+typedef enum
+{
+  ENGINE_RESET,   // Waiting for the engine to answer uci
+  ENGINE_WARMING, // Waiting for the engine to answer isready
+  ENGINE_READY,   // Waiting for a session
+  ENGINE_BUSY,    // Serving a session
+  ENGINE_STOPPED  // The engine has stopped
+} engine_state_t;
+
+typedef struct engine_t engine_t;
+
+typedef void (*engine_handler_t)(engine_t* engine);
+
+/*
+ * Chess engine, communicating over a pair of file descriptors
+ *
+ * The handlers are called when:
+ * - ready | The engine has been reset and warmed up, and is ready for a session
+ * - stop  | The engine has stopped
+ */
+struct engine_t
+{
+  conn_t            conn;
+  engine_state_t    state;
+  struct session_t* session;
+  engine_handler_t  ready;
+  engine_handler_t  stop;
+  uci_t             uci;         // The uci answer and the current options
+  uint64_t          reset_time;  // When the last reset started
+  uint64_t          warmup;      // Duration of the last reset, until readyok
+  uint64_t          ready_time;  // When the engine last got ready
+  uint64_t          idle;        // Time spent ready, waiting for a session
+  size_t            served;      // Number of sessions served
+  size_t            uci_due;     // Answers to uci sent for a session, still to come
+  size_t            isready_due; // Answers to isready sent for a session, still to come
+  bool              debug;
+};
+
+extern int  engine_open(engine_t* engine, int in, int out, bool debug);
+
+extern void engine_close(engine_t* engine);
+
+
+extern void engine_serve(engine_t* engine, struct session_t* session);
+
+extern int  engine_reset(engine_t* engine);
+
+extern uint64_t engine_idle(engine_t* engine);
+
+extern void engine_quit(engine_t* engine);
+
+#endif // ENGINE_H
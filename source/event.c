@@ -0,0 +1,116 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#include "event.h"
+
+static int epfd = -1;
+
+/*
+ * Create the epoll instance of the event loop
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to create epoll instance
+ */
+int event_init(void)
+{
+  if((epfd = epoll_create1(EPOLL_CLOEXEC)) == -1) return 1;
+
+  return 0;
+}
+
+/*
+ * Close the epoll instance of the event loop
+ */
+void event_free(void)
+{
+  if(epfd != -1) close(epfd);
+
+  epfd = -1;
+}
+
+/*
+ * Start watching the file descriptor of event
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to add file descriptor
+ */
+int event_add(event_t* event, uint32_t events)
+{
+  struct epoll_event epoll_event = { .events = events, .data.ptr = event };
+
+  if(epoll_ctl(epfd, EPOLL_CTL_ADD, event->fd, &epoll_event) == -1) return -1;
+
+  event->events = events;
+  event->added  = true;
+
+  return 0;
+}
+
+/*
+ * Change the events being waited for
+ *
+ * Nothing is done if the events are the same as before
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to modify file descriptor
+ */
+int event_mod(event_t* event, uint32_t events)
+{
+  if(!event->added || event->events == events) return 0;
+
+  struct epoll_event epoll_event = { .events = events, .data.ptr = event };
+
+  if(epoll_ctl(epfd, EPOLL_CTL_MOD, event->fd, &epoll_event) == -1) return -1;
+
+  event->events = events;
+
+  return 0;
+}
+
+/*
+ * Stop watching the file descriptor of event
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to delete file descriptor
+ */
+int event_del(event_t* event)
+{
+  if(!event->added) return 0;
+
+  event->added = false;
+
+  return epoll_ctl(epfd, EPOLL_CTL_DEL, event->fd, NULL);
+}
+
+/*
+ * Wait for events and call the handlers of the ready file descriptors
+ *
+ * PARAMS
+ * - int timeout | Milliseconds to wait, -1 to wait forever
+ *
+ * RETURN (int count)
+ * - >=0 | Number of handled events
+ * -  -1 | Failed to wait, or interrupted by signal
+ */
+int event_wait(int timeout)
+{
+  struct epoll_event epoll_events[EVENT_BATCH];
+
+  int count = epoll_wait(epfd, epoll_events, EVENT_BATCH, timeout);
+
+  for(int index = 0; index < count; index++)
+  {
+    event_t* event = epoll_events[index].data.ptr;
+
+    event->handler(event, epoll_events[index].events);
+  }
+
+  return count;
+}
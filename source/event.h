@@ -0,0 +1,53 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#ifndef EVENT_H
+#define EVENT_H
+
+#include "debug.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#define EVENT_BATCH 64
+
+typedef struct event_t event_t;
+
+typedef void (*event_handler_t)(event_t* event, uint32_t events);
+
+/*
+ * A file descriptor watched by the event loop
+ *
+ * The handler is called with the ready events (EPOLLIN, EPOLLOUT, ...)
+ */
+struct event_t
+{
+  int             fd;
+  uint32_t        events;  // The events being waited for
+  bool            added;
+  event_handler_t handler;
+  void*           data;
+};
+
+extern int  event_init(void);
+
+extern void event_free(void);
+
+
+extern int  event_add(event_t* event, uint32_t events);
+
+extern int  event_mod(event_t* event, uint32_t events);
+
+extern int  event_del(event_t* event);
+
+
+extern int  event_wait(int timeout);
+
+#endif // EVENT_H
@@ -1,7 +1,7 @@
 /*
  * Written by Hampus Fridholm
  *
- * Last updated: 2024-09-08
+ * Last updated: 2026-10-16
  */
 
 #include "fifo.h"
@@ -181,60 +181,26 @@ int stdin_stdout_fifo_open(int* stdin_fifo, const char* stdin_path, int* stdout_
 }
 
 /*
- * RETURN (ssize_t size)
- * - >0 | The number of read characters
- * -  0 | End of File
- * - -1 | Failed to read buffer
- */
-ssize_t buffer_read(int fd, char* buffer, size_t size)
-{
-  if(errno != 0) return -1;
-
-  if(!buffer) return 0;
-
-  char symbol = '\0';
-  ssize_t index;
-
-  for(index = 0; index < size && symbol != '\n'; index++)
-  {
-    ssize_t status = read(fd, &symbol, 1);
-
-    if(status == -1 || errno != 0) return -1; // ERROR
-
-    buffer[index] = symbol;
-
-    if(status == 0) return 0; // End Of File
-  }
-
-  return index;
-}
-
-/*
+ * Write the whole buffer, using as few syscalls as possible
+ *
  * RETURN (ssize_t size)
  * - >0 | The number of written characters
- * -  0 | End of File? (I think)
+ * -  0 | Nothing to write
  * - -1 | Failed to write to buffer
  */
 ssize_t buffer_write(int fd, const char* buffer, size_t size)
 {
-  if(errno != 0) return -1;
-
   if(!buffer) return 0;
 
-  ssize_t index;
-  char symbol = '\0';
+  size_t index = 0;
 
-  for(index = 0; index < size && symbol != '\n'; index++)
+  while(index < size)
   {
-    symbol = buffer[index];
+    ssize_t status = write(fd, buffer + index, size - index);
 
-    ssize_t status = write(fd, &symbol, 1);
+    if(status == -1) return -1; // ERROR
 
-    if(status == -1 || errno != 0) return -1;
-
-    if(status == 0) return 0; // End Of File
-    
-    if(symbol == '\0') break;
+    index += status;
   }
 
   return index;
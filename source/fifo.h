@@ -1,7 +1,7 @@
 /*
  * Written by Hampus Fridholm
  *
- * Last updated: 2024-09-08
+ * Last updated: 2026-10-16
  */
 
 #ifndef FIFO_H
@@ -21,8 +21,6 @@ extern int stdin_stdout_fifo_open(int* stdin_fifo, const char* stdin_path, int*
 extern int fifo_close(int* fifo, bool debug);
 
 
-extern ssize_t buffer_read(int fd, char* buffer, size_t size);
-
 extern ssize_t buffer_write(int fd, const char* buffer, size_t size);
 
 extern ssize_t message_write(int fd, const char* message);
@@ -0,0 +1,189 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "frame.h"
+
+// The names of the go parameters, by their token byte
+static const char* go_params[] =
+{
+  [FRAME_GO_WTIME]       = "wtime",
+  [FRAME_GO_BTIME]       = "btime",
+  [FRAME_GO_WINC]        = "winc",
+  [FRAME_GO_BINC]        = "binc",
+  [FRAME_GO_MOVESTOGO]   = "movestogo",
+  [FRAME_GO_DEPTH]       = "depth",
+  [FRAME_GO_NODES]       = "nodes",
+  [FRAME_GO_MATE]        = "mate",
+  [FRAME_GO_MOVETIME]    = "movetime",
+  [FRAME_GO_INFINITE]    = "infinite",
+  [FRAME_GO_PONDER]      = "ponder",
+  [FRAME_GO_SEARCHMOVES] = "searchmoves"
+};
+
+#define GO_PARAM_COUNT (sizeof(go_params) / sizeof(*go_params))
+
+/*
+ * Encode the header of a frame
+ *
+ * PARAMS
+ * - char*  header | Room for FRAME_HEADER bytes
+ * - size_t length | Length of the payload following the header
+ */
+void frame_header(char* header, int type, size_t length)
+{
+  header[0] = (length >> 24) & 0xff;
+  header[1] = (length >> 16) & 0xff;
+  header[2] = (length >>  8) & 0xff;
+  header[3] =  length        & 0xff;
+  header[4] = type;
+}
+
+/*
+ * Take the next frame, without reading from the file descriptor
+ *
+ * When only a part of the frame is buffered, the reader is grown
+ * to fit all of it, so that the rest can be read at once
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | No whole frame is buffered
+ * - 2 | The frame is too long
+ * - 3 | Failed to allocate frame buffer
+ */
+int frame_take(reader_t* reader, frame_t* frame)
+{
+  unsigned char header[FRAME_HEADER];
+
+  if(reader_peek(reader, (char*) header, FRAME_HEADER) < FRAME_HEADER) return 1;
+
+  size_t length = ((size_t) header[0] << 24) | ((size_t) header[1] << 16) |
+                  ((size_t) header[2] <<  8) |  (size_t) header[3];
+
+  if(length > FRAME_MAX_LENGTH) return 2;
+
+  size_t size = FRAME_HEADER + length;
+
+  if(reader->length < size)
+  {
+    // Not being able to grow the reader now only means more reads
+    reader_reserve(reader, size);
+
+    return 1;
+  }
+
+  char* data;
+
+  if(reader_bytes(reader, size, &data) == 0) return 3;
+
+  *frame = (frame_t) { .type = header[4], .payload = data + FRAME_HEADER, .length = length };
+
+  return 0;
+}
+
+/*
+ * Decode the value of a go token
+ */
+static uint64_t go_value(const unsigned char* token)
+{
+  uint64_t value = 0;
+
+  for(int index = 1; index < FRAME_GO_TOKEN; index++)
+  {
+    value = (value << 8) | token[index];
+  }
+
+  return value;
+}
+
+/*
+ * Check that data has no line breaks, so that it is a single command
+ *
+ * A payload with a line break would pass more commands to the engine,
+ * past everything the node does with the commands of a session
+ */
+bool frame_single_line(const char* data, size_t length)
+{
+  return !memchr(data, '\n', length) && !memchr(data, '\r', length);
+}
+
+/*
+ * Write the go command of a pre-tokenized go frame
+ *
+ * The buffer is grown to fit the command, which ends with a newline
+ *
+ * RETURN (ssize_t length)
+ * - >0 | Length of the command
+ * - -1 | The tokens are invalid, or failed to grow buffer
+ */
+ssize_t frame_go(const frame_t* frame, char** buffer, size_t* size)
+{
+  // Every token is at most a parameter name and 20 digits,
+  // and the moves of searchmoves are copied as they are
+  size_t needed = 4 + (frame->length / FRAME_GO_TOKEN) * 34 + frame->length;
+
+  if(needed > *size)
+  {
+    char* new_buffer = realloc(*buffer, needed);
+
+    if(!new_buffer) return -1;
+
+    *buffer = new_buffer;
+    *size   = needed;
+  }
+
+  const unsigned char* token = (const unsigned char*) frame->payload;
+  const unsigned char* end   = token + frame->length;
+
+  char* command = *buffer;
+
+  size_t length = sprintf(command, "go");
+
+  while(token < end)
+  {
+    if(end - token < FRAME_GO_TOKEN) return -1;
+
+    int param = token[0];
+
+    if(param >= GO_PARAM_COUNT || !go_params[param]) return -1;
+
+    uint64_t value = go_value(token);
+
+    token += FRAME_GO_TOKEN;
+
+    length += sprintf(command + length, " %s", go_params[param]);
+
+    if(param == FRAME_GO_INFINITE || param == FRAME_GO_PONDER) continue;
+
+    if(param != FRAME_GO_SEARCHMOVES)
+    {
+      // The time left can be negative, when a client has lost on time
+      if(param == FRAME_GO_WTIME || param == FRAME_GO_BTIME)
+      {
+        length += sprintf(command + length, " %lld", (long long) (int64_t) value);
+      }
+      else length += sprintf(command + length, " %llu", (unsigned long long) value);
+
+      continue;
+    }
+
+    if(value > (uint64_t) (end - token)) return -1;
+
+    if(!frame_single_line((const char*) token, value)) return -1;
+
+    command[length++] = ' ';
+
+    memcpy(command + length, token, value);
+
+    length += value;
+
+    token += value;
+  }
+
+  command[length++] = '\n';
+  command[length]   = '\0';
+
+  return length;
+}
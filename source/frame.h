@@ -0,0 +1,67 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "reader.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAME_HEADER     5         // Length of the payload (4 bytes, big endian) and the type
+#define FRAME_MAX_LENGTH (READER_MAX_SIZE - FRAME_HEADER) // Longest payload, so that a frame fits in the reader
+
+#define FRAME_COMMAND 1 // UCI command from the client, without newline
+#define FRAME_GO      2 // Pre-tokenized go command from the client
+#define FRAME_OUTPUT  3 // Line of engine output to the client, without newline
+
+/*
+ * The payload of a go frame is a list of tokens, each with a parameter
+ * byte and a value of 8 bytes, big endian. The value of searchmoves is
+ * the length of the moves that follow it, and flags ignore their value
+ */
+#define FRAME_GO_WTIME       1
+#define FRAME_GO_BTIME       2
+#define FRAME_GO_WINC        3
+#define FRAME_GO_BINC        4
+#define FRAME_GO_MOVESTOGO   5
+#define FRAME_GO_DEPTH       6
+#define FRAME_GO_NODES       7
+#define FRAME_GO_MATE        8
+#define FRAME_GO_MOVETIME    9
+#define FRAME_GO_INFINITE    10
+#define FRAME_GO_PONDER      11
+#define FRAME_GO_SEARCHMOVES 12
+
+#define FRAME_GO_TOKEN 9
+
+/*
+ * Message of the binary framing mode
+ *
+ * The payload is null terminated, and stays valid
+ * until the reader has to read from the file descriptor again
+ */
+typedef struct
+{
+  int    type;
+  char*  payload;
+  size_t length;
+} frame_t;
+
+extern void    frame_header(char* header, int type, size_t length);
+
+extern int     frame_take(reader_t* reader, frame_t* frame);
+
+extern ssize_t frame_go(const frame_t* frame, char** buffer, size_t* size);
+
+extern bool    frame_single_line(const char* data, size_t length);
+
+#endif // FRAME_H
@@ -0,0 +1,309 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "listener.h"
+
+/*
+ * Create the listening sockets, sharing the port if there are several
+ *
+ * PARAMS
+ * - int backlog   | Most clients waiting to be accepted, on every socket
+ * - int acceptors | Sockets with threads of their own (0 for one socket, accepted by the event loop)
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to create server socket
+ */
+int listener_open(listener_t* listener, const char* address, int port, int backlog, int acceptors, bool debug)
+{
+  *listener = (listener_t) { .threads = (acceptors > 0), .debug = debug };
+
+  int count = (acceptors > 0) ? acceptors : 1;
+
+  if(count > LISTENER_ACCEPTORS) count = LISTENER_ACCEPTORS;
+
+  for(int index = 0; index < count; index++)
+  {
+    acceptor_t* acceptor = &listener->acceptors[index];
+
+    *acceptor = (acceptor_t) { .servfd = -1, .listener = listener, .ring = { .eventfd = -1 } };
+
+    acceptor->servfd = server_socket_create(address, port, backlog, count > 1, debug);
+
+    if(acceptor->servfd == -1)
+    {
+      listener_close(listener);
+
+      return 1;
+    }
+
+    listener->count++;
+  }
+
+  if(debug && count > 1) info_print("Listening on %d sockets sharing the port", count);
+
+  return 0;
+}
+
+/*
+ * Accept the clients that are waiting, after the event loop said the socket is readable
+ *
+ * A burst of clients is taken at once, but no more than a batch,
+ * so that the clients already being served are not held up
+ */
+static void listener_accept(event_t* event, uint32_t events)
+{
+  acceptor_t* acceptor = event->data;
+  listener_t* listener = acceptor->listener;
+
+  for(int count = 0; count < EVENT_BATCH; count++)
+  {
+    int sockfd = accept4(acceptor->servfd, NULL, NULL, SOCK_CLOEXEC);
+
+    if(sockfd == -1)
+    {
+      // A client that disconnected before being accepted is no error
+      if(listener->debug && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED)
+      {
+        error_print("Failed to accept socket: %s", strerror(errno));
+      }
+
+      return;
+    }
+
+    if(listener->debug) info_print("Accepted socket (%d)", sockfd);
+
+    acceptor->accepted++;
+
+    listener->handler(sockfd);
+  }
+}
+
+/*
+ * Hand the clients accepted by the thread of acceptor to the handler
+ */
+static void listener_handoff(event_t* event, uint32_t events)
+{
+  acceptor_t* acceptor = event->data;
+  listener_t* listener = acceptor->listener;
+
+  uint64_t value;
+
+  // The eventfd is reset before the ring is emptied, so that no client is missed
+  if(read(acceptor->ring.eventfd, &value, sizeof(value)) == -1) return;
+
+  while(true)
+  {
+    ring_line_t taken;
+
+    while(ring_pop(&acceptor->ring, &taken))
+    {
+      int sockfd;
+
+      memcpy(&sockfd, taken.line, sizeof(sockfd));
+
+      ring_done(&acceptor->ring, &taken);
+
+      if(listener->debug) info_print("Accepted socket (%d)", sockfd);
+
+      listener->handler(sockfd);
+    }
+
+    // Pairs with the fence of the thread, after it published a client
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if(__atomic_load_n(&acceptor->ring.tail, __ATOMIC_ACQUIRE) == acceptor->ring.head) break;
+  }
+}
+
+/*
+ * Accept clients as they connect, and hand them to the event loop
+ *
+ * The clients are taken out of the backlog at once, and wait for
+ * the event loop in the ring. A full ring means that the event loop
+ * is behind, and the clients are left in the backlog meanwhile
+ */
+static void* listener_routine(void* arg)
+{
+  acceptor_t* acceptor = arg;
+  listener_t* listener = acceptor->listener;
+
+  while(__atomic_load_n(&listener->running, __ATOMIC_ACQUIRE))
+  {
+    int sockfd = accept4(acceptor->servfd, NULL, NULL, SOCK_CLOEXEC);
+
+    if(sockfd == -1)
+    {
+      if(errno == EINTR || errno == ECONNABORTED) continue;
+
+      // The socket is shut down when the listener closes
+      if(!__atomic_load_n(&listener->running, __ATOMIC_ACQUIRE)) break;
+
+      if(listener->debug) error_print("Failed to accept socket: %s", strerror(errno));
+
+      // Out of file descriptors, until clients have been closed
+      usleep(10000);
+
+      continue;
+    }
+
+    while(ring_push(&acceptor->ring, (char*) &sockfd, sizeof(sockfd)) != 0)
+    {
+      if(!__atomic_load_n(&listener->running, __ATOMIC_ACQUIRE))
+      {
+        close(sockfd);
+
+        return NULL;
+      }
+
+      usleep(1000);
+    }
+
+    acceptor->accepted++;
+  }
+
+  return NULL;
+}
+
+/*
+ * Watch the ring of acceptor, and start its thread
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to create ring, or to watch it
+ * - 2 | Failed to create thread
+ */
+static int listener_thread_start(acceptor_t* acceptor)
+{
+  if(ring_init(&acceptor->ring, LISTENER_QUEUE, sizeof(int) * LISTENER_QUEUE, 2) != 0) return 1;
+
+  acceptor->event = (event_t) { .fd = acceptor->ring.eventfd, .handler = listener_handoff, .data = acceptor };
+
+  if(event_add(&acceptor->event, EPOLLIN) == -1) return 1;
+
+  // Signals are left to the event loop, which they are meant to interrupt
+  sigset_t signals, previous;
+
+  sigfillset(&signals);
+
+  pthread_sigmask(SIG_SETMASK, &signals, &previous);
+
+  int status = pthread_create(&acceptor->thread, NULL, listener_routine, acceptor);
+
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+  if(status != 0) return 2;
+
+  acceptor->started = true;
+
+  return 0;
+}
+
+/*
+ * Start accepting clients, and handing them to handler
+ *
+ * With io_uring, every socket has a multishot accept of its own,
+ * instead of a thread
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to watch server socket
+ * - 2 | Failed to start acceptor thread
+ */
+int listener_start(listener_t* listener, listener_handler_t handler)
+{
+  listener->handler = handler;
+
+  if(uring_active())
+  {
+    for(int index = 0; index < listener->count; index++)
+    {
+      if(uring_accept(listener->acceptors[index].servfd, handler) != 0) return 1;
+    }
+
+    return 0;
+  }
+
+  if(!listener->threads)
+  {
+    acceptor_t* acceptor = &listener->acceptors[0];
+
+    // A client that disconnects before being accepted should not block the node
+    fcntl(acceptor->servfd, F_SETFL, fcntl(acceptor->servfd, F_GETFL) | O_NONBLOCK);
+
+    acceptor->event = (event_t) { .fd = acceptor->servfd, .handler = listener_accept, .data = acceptor };
+
+    return (event_add(&acceptor->event, EPOLLIN) == -1) ? 1 : 0;
+  }
+
+  __atomic_store_n(&listener->running, true, __ATOMIC_RELEASE);
+
+  for(int index = 0; index < listener->count; index++)
+  {
+    int status = listener_thread_start(&listener->acceptors[index]);
+
+    if(status != 0) return status;
+  }
+
+  if(listener->debug) info_print("Accepting clients with %d threads", listener->count);
+
+  return 0;
+}
+
+/*
+ * Stop the acceptor threads, and close the listening sockets
+ *
+ * Clients that were accepted, but never handed over, are closed
+ */
+void listener_close(listener_t* listener)
+{
+  __atomic_store_n(&listener->running, false, __ATOMIC_RELEASE);
+
+  size_t accepted = 0;
+
+  for(int index = 0; index < listener->count; index++)
+  {
+    acceptor_t* acceptor = &listener->acceptors[index];
+
+    if(acceptor->started)
+    {
+      // Wakes up the thread from accept
+      shutdown(acceptor->servfd, SHUT_RDWR);
+
+      pthread_join(acceptor->thread, NULL);
+
+      acceptor->started = false;
+    }
+
+    if(acceptor->event.added) event_del(&acceptor->event);
+
+    ring_line_t taken;
+
+    while(acceptor->ring.slots && ring_pop(&acceptor->ring, &taken))
+    {
+      int sockfd;
+
+      memcpy(&sockfd, taken.line, sizeof(sockfd));
+
+      ring_done(&acceptor->ring, &taken);
+
+      close(sockfd);
+    }
+
+    ring_free(&acceptor->ring);
+
+    socket_close(&acceptor->servfd, listener->debug);
+
+    accepted += acceptor->accepted;
+  }
+
+  if(listener->debug && listener->threads && listener->count > 0 && !uring_active())
+  {
+    info_print("listener: %ld clients accepted by %d threads", (long) accepted, listener->count);
+  }
+
+  listener->count = 0;
+}
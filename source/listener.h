@@ -0,0 +1,82 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef LISTENER_H
+#define LISTENER_H
+
+// accept4 is a GNU extension
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "debug.h"
+#include "socket.h"
+#include "event.h"
+#include "uring.h"
+#include "ring.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define LISTENER_BACKLOG   1024  // Default for the most clients waiting to be accepted
+#define LISTENER_ACCEPTORS 8     // Most listening sockets sharing the port
+#define LISTENER_QUEUE     1024  // Accepted clients an acceptor thread can hand over at once
+
+typedef void (*listener_handler_t)(int sockfd);
+
+typedef struct listener_t listener_t;
+
+/*
+ * Listening socket, with the thread that accepts its clients, if any
+ *
+ * The accepted clients are handed to the event loop through the ring,
+ * whose eventfd the event loop is watching
+ */
+typedef struct
+{
+  int         servfd;
+  listener_t* listener;
+  pthread_t   thread;
+  bool        started;
+  ring_t      ring;
+  event_t     event;     // The ring with a thread, or else the listening socket
+  size_t      accepted;
+} acceptor_t;
+
+/*
+ * Listening sockets of the node
+ *
+ * One socket is accepted by the event loop itself. Several sockets
+ * share the port with SO_REUSEPORT, so that the kernel spreads the
+ * clients over them, and are accepted either by threads of their own,
+ * which take the clients at once however busy the event loop is, or
+ * by io_uring
+ */
+struct listener_t
+{
+  acceptor_t         acceptors[LISTENER_ACCEPTORS];
+  int                count;
+  bool               threads;   // Accept with threads, instead of in the event loop
+  bool               running;
+  listener_handler_t handler;
+  bool               debug;
+};
+
+extern int  listener_open(listener_t* listener, const char* address, int port, int backlog, int acceptors, bool debug);
+
+extern int  listener_start(listener_t* listener, listener_handler_t handler);
+
+extern void listener_close(listener_t* listener);
+
+#endif // LISTENER_H
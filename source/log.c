@@ -0,0 +1,649 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "log.h"
+
+#define LOG_RESERVE 64  // Room a string leaves for the arguments after it
+
+/*
+ * Fixed part of a record, followed by the arguments of its format
+ *
+ * The title and the format are string literals,
+ * so only their addresses have to be kept
+ */
+typedef struct
+{
+  uint64_t    time;    // Nanoseconds since the epoch
+  FILE*       stream;
+  const char* title;
+  const char* format;
+} log_header_t;
+
+/*
+ * Kinds of arguments, after the format specifiers that the messages use
+ */
+typedef enum
+{
+  LOG_ARG_INT,     // d
+  LOG_ARG_LONG,    // ld
+  LOG_ARG_LLONG,   // lld
+  LOG_ARG_CHAR,    // c
+  LOG_ARG_DOUBLE,  // f
+  LOG_ARG_STRING,  // s, copied with its length in front
+  LOG_ARG_NONE     // Unknown specifier, where the message ends
+} log_arg_t;
+
+/*
+ * The second that was last formatted, since most records share it
+ */
+typedef struct
+{
+  time_t second;
+  char   string[16];
+} log_clock_t;
+
+// Tools that never start the log thread print every message right away
+static log_level_t log_level = LOG_DEBUG;
+
+static ring_t*         log_rings[LOG_THREADS];
+static int             log_ring_count = 0;
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t log_thread;
+static bool      log_running    = false;
+static int       log_generation = 0;      // Started log threads, to tell stale rings
+static int       log_wakeup     = -1;     // Tells the log thread that it should stop, or look for new rings
+static size_t    log_dropped    = 0;      // Records that didn't fit in their ring
+
+// The ring of the calling thread, in the generation it was created in
+static __thread ring_t* log_ring = NULL;
+static __thread int     log_ring_generation = 0;
+
+/*
+ * Change which messages are printed, also from a signal handler
+ */
+void log_level_set(log_level_t level)
+{
+  __atomic_store_n(&log_level, level, __ATOMIC_RELAXED);
+}
+
+/*
+ * Get the level of the messages that are printed
+ */
+log_level_t log_level_get(void)
+{
+  return __atomic_load_n(&log_level, __ATOMIC_RELAXED);
+}
+
+/*
+ * Check if messages of level are printed
+ */
+bool log_enabled(log_level_t level)
+{
+  return level != LOG_OFF && level <= log_level_get();
+}
+
+/*
+ * Parse the format specifier after a percent sign
+ *
+ * PARAMS
+ * - const char** format | Set to the last character of the specifier
+ */
+static log_arg_t log_specifier(const char** format)
+{
+  const char* string = *format;
+
+  if(strncmp(string, "lld", 3) == 0)
+  {
+    *format += 2;
+
+    return LOG_ARG_LLONG;
+  }
+
+  if(strncmp(string, "ld", 2) == 0)
+  {
+    *format += 1;
+
+    return LOG_ARG_LONG;
+  }
+
+  switch(*string)
+  {
+    case 'd': return LOG_ARG_INT;
+    case 'c': return LOG_ARG_CHAR;
+    case 'f': return LOG_ARG_DOUBLE;
+    case 's': return LOG_ARG_STRING;
+    default : return LOG_ARG_NONE;
+  }
+}
+
+/*
+ * Copy the arguments of format into a record, without formatting them
+ *
+ * Strings are cut so that the arguments after them still fit
+ *
+ * RETURN (size_t length)
+ */
+static size_t log_encode(char* record, size_t size, const char* format, va_list args)
+{
+  size_t length = 0;
+
+  for(const char* string = format; *string; string++)
+  {
+    if(*string != '%') continue;
+
+    string++;
+
+    log_arg_t arg = log_specifier(&string);
+
+    if(arg == LOG_ARG_NONE) break;
+
+    if(arg == LOG_ARG_STRING)
+    {
+      const char* value = va_arg(args, const char*);
+
+      if(!value) value = "(null)";
+
+      size_t room = (size > length + sizeof(uint32_t) + LOG_RESERVE) ? size - length - sizeof(uint32_t) - LOG_RESERVE : 0;
+
+      uint32_t value_length = strnlen(value, room);
+
+      if(length + sizeof(uint32_t) > size) break;
+
+      memcpy(record + length, &value_length, sizeof(uint32_t));
+
+      memcpy(record + length + sizeof(uint32_t), value, value_length);
+
+      length += sizeof(uint32_t) + value_length;
+
+      continue;
+    }
+
+    union { int i; long l; long long ll; double f; } value;
+
+    size_t value_size;
+
+    switch(arg)
+    {
+      case LOG_ARG_LONG:   value.l  = va_arg(args, long);      value_size = sizeof(long);      break;
+      case LOG_ARG_LLONG:  value.ll = va_arg(args, long long); value_size = sizeof(long long); break;
+      case LOG_ARG_DOUBLE: value.f  = va_arg(args, double);    value_size = sizeof(double);    break;
+
+      // 'char' is promoted to 'int' when passed through '...'
+      default:             value.i  = va_arg(args, int);       value_size = sizeof(int);       break;
+    }
+
+    if(length + value_size > size) break;
+
+    memcpy(record + length, &value, value_size);
+
+    length += value_size;
+  }
+
+  return length;
+}
+
+/*
+ * Format the arguments of a record by its format
+ *
+ * The text ends at an unknown specifier,
+ * or where the arguments of a record that was cut short end
+ *
+ * RETURN (size_t length)
+ */
+static size_t log_format(char* text, size_t size, const char* format, const char* args, size_t args_length)
+{
+  size_t length = 0;
+  size_t offset = 0;
+
+  const char* string;
+
+  for(string = format; *string && length + 1 < size; string++)
+  {
+    if(*string != '%')
+    {
+      text[length++] = *string;
+
+      continue;
+    }
+
+    const char* specifier = string + 1;
+
+    log_arg_t arg = log_specifier(&specifier);
+
+    if(arg == LOG_ARG_NONE) break;
+
+    string = specifier;
+
+    union { int i; long l; long long ll; double f; } value;
+
+    int status = 0;
+
+    if(arg == LOG_ARG_STRING)
+    {
+      uint32_t value_length;
+
+      if(offset + sizeof(uint32_t) > args_length) break;
+
+      memcpy(&value_length, args + offset, sizeof(uint32_t));
+
+      offset += sizeof(uint32_t);
+
+      if(offset + value_length > args_length) break;
+
+      status = snprintf(text + length, size - length, "%.*s", (int) value_length, args + offset);
+
+      offset += value_length;
+    }
+    else if(arg == LOG_ARG_LONG && offset + sizeof(long) <= args_length)
+    {
+      memcpy(&value.l, args + offset, sizeof(long));
+
+      offset += sizeof(long);
+
+      status = snprintf(text + length, size - length, "%ld", value.l);
+    }
+    else if(arg == LOG_ARG_LLONG && offset + sizeof(long long) <= args_length)
+    {
+      memcpy(&value.ll, args + offset, sizeof(long long));
+
+      offset += sizeof(long long);
+
+      status = snprintf(text + length, size - length, "%lld", value.ll);
+    }
+    else if(arg == LOG_ARG_DOUBLE && offset + sizeof(double) <= args_length)
+    {
+      memcpy(&value.f, args + offset, sizeof(double));
+
+      offset += sizeof(double);
+
+      status = snprintf(text + length, size - length, "%f", value.f);
+    }
+    else if((arg == LOG_ARG_INT || arg == LOG_ARG_CHAR) && offset + sizeof(int) <= args_length)
+    {
+      memcpy(&value.i, args + offset, sizeof(int));
+
+      offset += sizeof(int);
+
+      status = snprintf(text + length, size - length, (arg == LOG_ARG_INT) ? "%d" : "%c", value.i);
+    }
+    else break;
+
+    if(status < 0) break;
+
+    // The argument might have been cut to fit in the text
+    length += ((size_t) status < size - length) ? (size_t) status : size - length - 1;
+  }
+
+  text[length] = '\0';
+
+  return length;
+}
+
+/*
+ * Format the time of a record, with hours, minutes, seconds and ms
+ *
+ * The date is only converted to local time when the second changes
+ */
+static void log_time(log_clock_t* clock, uint64_t time, char* buffer)
+{
+  time_t second = time / 1000000000;
+
+  if(second != clock->second)
+  {
+    struct tm timeinfo;
+
+    localtime_r(&second, &timeinfo);
+
+    strftime(clock->string, sizeof(clock->string), "%H:%M:%S", &timeinfo);
+
+    clock->second = second;
+  }
+
+  sprintf(buffer, "%s.%03d", clock->string, (int) ((time / 1000000) % 1000));
+}
+
+/*
+ * Format a record and write it to its stream
+ *
+ * RETURN (same as fprintf)
+ */
+static int log_record_write(log_clock_t* clock, const char* record, size_t length)
+{
+  log_header_t header;
+
+  memcpy(&header, record, sizeof(log_header_t));
+
+  char text[2 * LOG_RECORD];
+
+  size_t text_length = log_format(text, sizeof(text), header.format, record + sizeof(log_header_t), length - sizeof(log_header_t));
+
+  char time_string[32];
+
+  log_time(clock, header.time, time_string);
+
+  return fprintf(header.stream, "[%s] [ %s ]: %.*s\n", time_string, header.title, (int) text_length, text);
+}
+
+/*
+ * Get the ring of the calling thread, and create it the first time
+ *
+ * RETURN (ring_t* ring)
+ * - NULL | The log thread is not running, or the thread can't get a ring
+ */
+static ring_t* log_ring_get(void)
+{
+  if(!__atomic_load_n(&log_running, __ATOMIC_ACQUIRE)) return NULL;
+
+  int generation = __atomic_load_n(&log_generation, __ATOMIC_RELAXED);
+
+  if(log_ring_generation == generation) return log_ring;
+
+  log_ring            = NULL;
+  log_ring_generation = generation;
+
+  ring_t* ring = malloc(sizeof(ring_t));
+
+  if(!ring) return NULL;
+
+  if(ring_init(ring, LOG_SLOTS, LOG_CHUNK, LOG_CHUNKS) != 0)
+  {
+    free(ring);
+
+    return NULL;
+  }
+
+  pthread_mutex_lock(&log_mutex);
+
+  if(log_ring_count < LOG_THREADS) log_rings[log_ring_count++] = ring;
+
+  else
+  {
+    ring_free(ring);
+
+    free(ring);
+
+    ring = NULL;
+  }
+
+  pthread_mutex_unlock(&log_mutex);
+
+  if(!ring) return NULL;
+
+  // The log thread has to wait for the new ring too
+  uint64_t value = 1;
+
+  if(write(log_wakeup, &value, sizeof(value)) == -1) {}
+
+  log_ring = ring;
+
+  return ring;
+}
+
+/*
+ * Queue a message for the log thread, formatting only happens there
+ *
+ * Without the log thread, or a ring for the calling thread,
+ * the message is written right away.
+ * The title and the format have to be string literals
+ *
+ * RETURN (int status)
+ * -  0 | Success, or the level is not printed
+ * - -1 | The ring was full, and the message was dropped
+ */
+int log_print(log_level_t level, FILE* stream, const char* title, const char* format, va_list args)
+{
+  if(!log_enabled(level)) return 0;
+
+  ring_t* ring = log_ring_get();
+
+  // A dropped message should not cost the clock and the encoding
+  if(ring && !ring_room(ring, LOG_RECORD))
+  {
+    __atomic_add_fetch(&log_dropped, 1, __ATOMIC_RELAXED);
+
+    return -1;
+  }
+
+  struct timespec time;
+
+  clock_gettime(CLOCK_REALTIME, &time);
+
+  char record[LOG_RECORD];
+
+  log_header_t header =
+  {
+    .time   = (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec,
+    .stream = stream,
+    .title  = title,
+    .format = format
+  };
+
+  memcpy(record, &header, sizeof(log_header_t));
+
+  size_t length = sizeof(log_header_t) + log_encode(record + sizeof(log_header_t), sizeof(record) - sizeof(log_header_t), format, args);
+
+  if(!ring)
+  {
+    log_clock_t clock = { .second = -1 };
+
+    return (log_record_write(&clock, record, length) < 0) ? -1 : 0;
+  }
+
+  if(ring_push(ring, record, length) != 0)
+  {
+    __atomic_add_fetch(&log_dropped, 1, __ATOMIC_RELAXED);
+
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * Write every record in the rings
+ *
+ * RETURN (size_t count)
+ */
+static size_t log_drain(ring_t** rings, int count, log_clock_t* clock)
+{
+  size_t written = 0;
+
+  for(int index = 0; index < count; index++)
+  {
+    ring_line_t line;
+
+    while(ring_pop(rings[index], &line))
+    {
+      log_record_write(clock, line.line, line.length);
+
+      ring_done(rings[index], &line);
+
+      written++;
+    }
+  }
+
+  return written;
+}
+
+/*
+ * Check if any of the rings has records, after the producers' last wakeup
+ */
+static bool log_pending(ring_t** rings, int count)
+{
+  // Pairs with the fence of the producers, after they stored the tail
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+  for(int index = 0; index < count; index++)
+  {
+    if(__atomic_load_n(&rings[index]->tail, __ATOMIC_ACQUIRE) != rings[index]->head) return true;
+  }
+
+  return false;
+}
+
+/*
+ * Tell how many messages have been dropped since the last time
+ */
+static void log_dropped_print(log_clock_t* clock)
+{
+  size_t dropped = __atomic_exchange_n(&log_dropped, 0, __ATOMIC_RELAXED);
+
+  if(dropped == 0) return;
+
+  struct timespec time;
+
+  clock_gettime(CLOCK_REALTIME, &time);
+
+  char time_string[32];
+
+  log_time(clock, (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec, time_string);
+
+  fprintf(stderr, "[%s] [ \e[1;31mERROR\e[0m ]: %ld messages were dropped, the log fell behind\n", time_string, (long) dropped);
+}
+
+/*
+ * Format and write the records of every thread, until the log is stopped
+ *
+ * The thread sleeps on the eventfds of the rings, which
+ * the producers only write to when their ring was empty
+ */
+static void* log_routine(void* data)
+{
+  log_clock_t clock = { .second = -1 };
+
+  ring_t* rings[LOG_THREADS];
+
+  struct pollfd fds[LOG_THREADS + 1];
+
+  while(true)
+  {
+    bool running = __atomic_load_n(&log_running, __ATOMIC_ACQUIRE);
+
+    pthread_mutex_lock(&log_mutex);
+
+    int count = log_ring_count;
+
+    memcpy(rings, log_rings, sizeof(ring_t*) * count);
+
+    pthread_mutex_unlock(&log_mutex);
+
+    if(log_drain(rings, count, &clock) > 0)
+    {
+      log_dropped_print(&clock);
+
+      fflush(stdout);
+      fflush(stderr);
+
+      continue;
+    }
+
+    if(!running) break;
+
+    if(log_pending(rings, count)) continue;
+
+    fds[0] = (struct pollfd) { .fd = log_wakeup, .events = POLLIN };
+
+    for(int index = 0; index < count; index++)
+    {
+      fds[index + 1] = (struct pollfd) { .fd = rings[index]->eventfd, .events = POLLIN };
+    }
+
+    if(poll(fds, count + 1, -1) == -1) continue;
+
+    for(int index = 0; index < count + 1; index++)
+    {
+      uint64_t value;
+
+      if(fds[index].revents & POLLIN)
+      {
+        if(read(fds[index].fd, &value, sizeof(value)) == -1) {}
+      }
+    }
+  }
+
+  log_dropped_print(&clock);
+
+  fflush(stdout);
+  fflush(stderr);
+
+  return NULL;
+}
+
+/*
+ * Start the log thread, after which messages are formatted and written by it
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to create eventfd
+ * - 2 | Failed to create thread
+ */
+int log_start(void)
+{
+  log_wakeup = eventfd(0, EFD_CLOEXEC);
+
+  if(log_wakeup == -1) return 1;
+
+  __atomic_add_fetch(&log_generation, 1, __ATOMIC_RELAXED);
+
+  __atomic_store_n(&log_running, true, __ATOMIC_RELEASE);
+
+  // Signals are left to the other threads, which they are meant to interrupt
+  sigset_t signals, previous;
+
+  sigfillset(&signals);
+
+  pthread_sigmask(SIG_SETMASK, &signals, &previous);
+
+  int status = pthread_create(&log_thread, NULL, log_routine, NULL);
+
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+  if(status != 0)
+  {
+    __atomic_store_n(&log_running, false, __ATOMIC_RELEASE);
+
+    close(log_wakeup);
+
+    log_wakeup = -1;
+
+    return 2;
+  }
+
+  return 0;
+}
+
+/*
+ * Write the queued messages, and stop the log thread
+ *
+ * The other threads that log have to be stopped before,
+ * after this, messages are written right away again
+ */
+void log_stop(void)
+{
+  if(!__atomic_load_n(&log_running, __ATOMIC_ACQUIRE)) return;
+
+  __atomic_store_n(&log_running, false, __ATOMIC_RELEASE);
+
+  uint64_t value = 1;
+
+  if(write(log_wakeup, &value, sizeof(value)) == -1) {}
+
+  pthread_join(log_thread, NULL);
+
+  for(int index = 0; index < log_ring_count; index++)
+  {
+    ring_free(log_rings[index]);
+
+    free(log_rings[index]);
+  }
+
+  log_ring_count = 0;
+
+  close(log_wakeup);
+
+  log_wakeup = -1;
+}
@@ -0,0 +1,55 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include "ring.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+
+#define LOG_THREADS 16      // Most threads with a ring of their own
+#define LOG_RECORD  1024    // Largest record, longer strings are cut
+#define LOG_SLOTS   4096    // Records a ring holds
+#define LOG_CHUNK   65536   // Size of the pooled buffers of a ring
+#define LOG_CHUNKS  8
+
+/*
+ * Level of the messages that are printed, from none to every message
+ */
+typedef enum
+{
+  LOG_OFF,
+  LOG_ERROR,
+  LOG_INFO,
+  LOG_DEBUG   // Every relayed line
+} log_level_t;
+
+extern void        log_level_set(log_level_t level);
+
+extern log_level_t log_level_get(void);
+
+extern bool        log_enabled(log_level_t level);
+
+
+extern int  log_start(void);
+
+extern void log_stop(void);
+
+
+extern int  log_print(log_level_t level, FILE* stream, const char* title, const char* format, va_list args);
+
+#endif // LOG_H
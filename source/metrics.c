@@ -0,0 +1,493 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "metrics.h"
+
+metrics_t metrics;
+
+/*
+ * Client of the metrics listener, closed after one response
+ */
+typedef struct metrics_client_t metrics_client_t;
+
+struct metrics_client_t
+{
+  conn_t            conn;
+  int               sockfd;
+  bool              responded;
+  metrics_client_t* next;
+};
+
+/*
+ * Text of a response, grown as the series are printed
+ */
+typedef struct
+{
+  char*  data;
+  size_t length;
+  size_t size;
+  bool   failed;
+} metrics_text_t;
+
+static int   metrics_servfd = -1;
+static event_t metrics_event;
+
+static const char* metrics_address;
+static int         metrics_port;
+static bool        metrics_debug;
+
+static metrics_client_t* metrics_clients = NULL;
+static metrics_client_t* metrics_closed  = NULL;
+
+/*
+ * Get the bucket of a duration in microseconds
+ */
+static size_t histogram_bucket(uint64_t micros)
+{
+  if(micros < 2 * HISTOGRAM_SUB) return micros;
+
+  int msb = 63 - __builtin_clzll(micros);
+
+  size_t sub = (micros >> (msb - 3)) - HISTOGRAM_SUB;
+
+  size_t bucket = 2 * HISTOGRAM_SUB + (msb - 4) * HISTOGRAM_SUB + sub;
+
+  return (bucket < HISTOGRAM_BUCKETS) ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+/*
+ * Get the first duration in microseconds above bucket
+ */
+static uint64_t histogram_bound(size_t bucket)
+{
+  if(bucket < 2 * HISTOGRAM_SUB) return bucket + 1;
+
+  int    msb = 4 + (bucket - 2 * HISTOGRAM_SUB) / HISTOGRAM_SUB;
+  size_t sub = (bucket - 2 * HISTOGRAM_SUB) % HISTOGRAM_SUB;
+
+  return (uint64_t) (HISTOGRAM_SUB + sub + 1) << (msb - 3);
+}
+
+/*
+ * Record a duration in histogram
+ */
+void histogram_record(histogram_t* histogram, uint64_t nanos)
+{
+  uint64_t micros = nanos / 1000;
+
+  METRICS_ADD(histogram->counts[histogram_bucket(micros)], 1);
+
+  METRICS_ADD(histogram->sum, micros);
+
+  // The count is added last, so that a scrape that reads it has the bucket too
+  __atomic_fetch_add(&histogram->count, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Append formatted text to the response
+ */
+static void metrics_print(metrics_text_t* text, const char* format, ...)
+{
+  if(text->failed) return;
+
+  va_list args;
+
+  va_start(args, format);
+
+  int length = vsnprintf(text->data + text->length, text->size - text->length, format, args);
+
+  va_end(args);
+
+  if(length < 0)
+  {
+    text->failed = true;
+
+    return;
+  }
+
+  if(text->length + length < text->size)
+  {
+    text->length += length;
+
+    return;
+  }
+
+  size_t size = (text->size > 0) ? text->size : 4096;
+
+  while(size <= text->length + length) size *= 2;
+
+  char* data = realloc(text->data, size);
+
+  if(!data)
+  {
+    text->failed = true;
+
+    return;
+  }
+
+  text->data = data;
+  text->size = size;
+
+  va_start(args, format);
+
+  vsnprintf(text->data + text->length, text->size - text->length, format, args);
+
+  va_end(args);
+
+  text->length += length;
+}
+
+/*
+ * Print a counter series, with its help and type
+ */
+static void metrics_counter(metrics_text_t* text, const char* name, const char* help, uint64_t value)
+{
+  metrics_print(text, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+    name, help, name, name, (unsigned long long) value);
+}
+
+/*
+ * Print a histogram, with the cumulative count of every bucket
+ *
+ * Every bound is printed, so that the series are the same in every scrape.
+ * A record adds to its bucket before the count, so the count is read first,
+ * and the buckets are capped by it, to agree with the count and the sum
+ */
+static void metrics_histogram(metrics_text_t* text, const char* name, const char* help, histogram_t* histogram)
+{
+  metrics_print(text, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+
+  uint64_t count = __atomic_load_n(&histogram->count, __ATOMIC_ACQUIRE);
+  uint64_t sum   = __atomic_load_n(&histogram->sum,   __ATOMIC_RELAXED);
+
+  uint64_t total = 0;
+
+  for(size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+  {
+    total += __atomic_load_n(&histogram->counts[bucket], __ATOMIC_RELAXED);
+
+    if(total > count) total = count;
+
+    metrics_print(text, "%s_bucket{le=\"%g\"} %llu\n", name,
+      (double) histogram_bound(bucket) / 1e6, (unsigned long long) total);
+  }
+
+  metrics_print(text, "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %f\n%s_count %llu\n",
+    name, (unsigned long long) count, name, (double) sum / 1e6,
+    name, (unsigned long long) count);
+}
+
+/*
+ * Print the relay series of both directions
+ */
+static void metrics_relay(metrics_text_t* text)
+{
+  struct { const char* name; metrics_relay_t* relay; } directions[] =
+  {
+    { "client_to_engine", &metrics.to_engine },
+    { "engine_to_client", &metrics.to_client }
+  };
+
+  metrics_print(text, "# HELP ucinode_relay_lines_total Lines relayed\n# TYPE ucinode_relay_lines_total counter\n");
+
+  for(int index = 0; index < 2; index++)
+  {
+    metrics_print(text, "ucinode_relay_lines_total{direction=\"%s\"} %llu\n",
+      directions[index].name, (unsigned long long) directions[index].relay->lines);
+  }
+
+  metrics_print(text, "# HELP ucinode_relay_bytes_total Bytes relayed\n# TYPE ucinode_relay_bytes_total counter\n");
+
+  for(int index = 0; index < 2; index++)
+  {
+    metrics_print(text, "ucinode_relay_bytes_total{direction=\"%s\"} %llu\n",
+      directions[index].name, (unsigned long long) directions[index].relay->bytes);
+  }
+
+  metrics_print(text, "# HELP ucinode_relay_syscalls_total Reads and writes of closed sessions\n# TYPE ucinode_relay_syscalls_total counter\n");
+
+  for(int index = 0; index < 2; index++)
+  {
+    metrics_print(text, "ucinode_relay_syscalls_total{direction=\"%s\"} %llu\n",
+      directions[index].name, (unsigned long long) directions[index].relay->syscalls);
+  }
+
+  metrics_print(text, "# HELP ucinode_relay_syscalls_per_line Reads and writes per line of closed sessions\n# TYPE ucinode_relay_syscalls_per_line gauge\n");
+
+  for(int index = 0; index < 2; index++)
+  {
+    metrics_relay_t* relay = directions[index].relay;
+
+    double syscalls = (relay->closed_lines > 0) ? (double) relay->syscalls / relay->closed_lines : 0;
+
+    metrics_print(text, "ucinode_relay_syscalls_per_line{direction=\"%s\"} %f\n",
+      directions[index].name, syscalls);
+  }
+}
+
+/*
+ * Print every series in the Prometheus text format
+ */
+static void metrics_text(metrics_text_t* text)
+{
+  metrics_counter(text, "ucinode_clients_accepted_total", "Clients accepted on the UCI port", metrics.accepted);
+
+  metrics_counter(text, "ucinode_sessions_opened_total", "Sessions opened, including logical sessions", metrics.opened);
+
+  metrics_print(text, "# HELP ucinode_sessions_active Sessions that are open\n# TYPE ucinode_sessions_active gauge\nucinode_sessions_active %llu\n",
+    (unsigned long long) (metrics.opened - metrics.closed));
+
+  metrics_counter(text, "ucinode_engine_resets_total", "Engine resets that have completed", metrics.resets);
+
+  metrics_histogram(text, "ucinode_engine_reset_seconds", "Time from reset to ready", &metrics.reset);
+
+  metrics_relay(text);
+
+  metrics_histogram(text, "ucinode_go_first_info_seconds", "Time from go to the first info line", &metrics.go_info);
+
+  metrics_histogram(text, "ucinode_go_bestmove_seconds", "Time from go to bestmove", &metrics.go_bestmove);
+
+  metrics_histogram(text, "ucinode_accept_first_response_seconds", "Time from accept to the first response to the client", &metrics.response);
+
+  metrics_print(text, "# HELP ucinode_queue_waiting Sessions waiting for an engine\n# TYPE ucinode_queue_waiting gauge\nucinode_queue_waiting %llu\n",
+    (unsigned long long) metrics.waiting);
+
+  metrics_counter(text, "ucinode_queue_refused_total", "Sessions refused by a full admission queue", metrics.refused);
+
+  metrics_counter(text, "ucinode_queue_expired_total", "Sessions closed after waiting past the deadline", metrics.expired);
+
+  metrics_histogram(text, "ucinode_queue_wait_seconds", "Time from queued to getting an engine", &metrics.queue_wait);
+
+  metrics_counter(text, "ucinode_metrics_scrapes_total", "Requests to the metrics listener", metrics.scrapes);
+}
+
+/*
+ * Close client and put it on the closed list, to be freed later
+ */
+static void metrics_client_close(metrics_client_t* client)
+{
+  if(client->conn.closed) return;
+
+  conn_close(&client->conn);
+
+  socket_close(&client->sockfd, false);
+
+  for(metrics_client_t** pointer = &metrics_clients; *pointer; pointer = &(*pointer)->next)
+  {
+    if(*pointer != client) continue;
+
+    *pointer = client->next;
+
+    break;
+  }
+
+  client->next = metrics_closed;
+
+  metrics_closed = client;
+}
+
+/*
+ * Write the response, and close client once it has been written
+ */
+static void metrics_respond(metrics_client_t* client)
+{
+  client->responded = true;
+
+  METRICS_ADD(metrics.scrapes, 1);
+
+  metrics_text_t text = { 0 };
+
+  metrics_text(&text);
+
+  if(text.failed)
+  {
+    if(metrics_debug) error_print("Failed to print metrics");
+
+    free(text.data);
+
+    metrics_client_close(client);
+
+    return;
+  }
+
+  char header[128];
+
+  int length = sprintf(header, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %ld\r\n\r\n", (long) text.length);
+
+  int status = conn_write(&client->conn, header, length);
+
+  if(status == 0) status = conn_write(&client->conn, text.data, text.length);
+
+  free(text.data);
+
+  if(status != 0 || conn_flush(&client->conn) == -1)
+  {
+    metrics_client_close(client);
+
+    return;
+  }
+
+  // The drain handler closes the client, when the response has been written
+  if(conn_pending(&client->conn) > 0) client->conn.writing = true;
+
+  else metrics_client_close(client);
+}
+
+/*
+ * Read the request, and respond after its empty line
+ *
+ * Every request is answered with the metrics, whatever its path
+ */
+static void metrics_input(conn_t* conn)
+{
+  metrics_client_t* client = conn->data;
+
+  char* line;
+  ssize_t length;
+
+  while(!client->responded && (length = reader_take(&conn->reader, &line)) > 0)
+  {
+    if(line[0] == '\r' || line[0] == '\n') metrics_respond(client);
+  }
+}
+
+/*
+ * The response has been written
+ */
+static void metrics_drain(conn_t* conn)
+{
+  metrics_client_close(conn->data);
+}
+
+/*
+ * The client has disconnected
+ */
+static void metrics_conn_close(conn_t* conn)
+{
+  metrics_client_close(conn->data);
+}
+
+/*
+ * Open a connection with an accepted client
+ */
+static void metrics_client(int sockfd)
+{
+  metrics_client_t* client = malloc(sizeof(metrics_client_t));
+
+  if(!client)
+  {
+    socket_close(&sockfd, metrics_debug);
+
+    return;
+  }
+
+  *client = (metrics_client_t) { .sockfd = sockfd };
+
+  if(conn_open(&client->conn, sockfd, sockfd, client) != 0)
+  {
+    if(metrics_debug) error_print("Failed to open metrics client");
+
+    socket_close(&client->sockfd, metrics_debug);
+
+    free(client);
+
+    return;
+  }
+
+  client->conn.input = metrics_input;
+  client->conn.drain = metrics_drain;
+  client->conn.close = metrics_conn_close;
+
+  client->next = metrics_clients;
+
+  metrics_clients = client;
+}
+
+/*
+ * Accept a client, after the event loop said the metrics socket is readable
+ */
+static void metrics_accept(event_t* event, uint32_t events)
+{
+  int sockfd = socket_accept(metrics_servfd, metrics_address, metrics_port, metrics_debug);
+
+  if(sockfd == -1) return;
+
+  metrics_client(sockfd);
+}
+
+/*
+ * Start serving metrics on a port of its own, with the backend in use
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to create server socket
+ * - 2 | Failed to watch server socket
+ */
+int metrics_listen(const char* address, int port, bool debug)
+{
+  metrics_address = address;
+  metrics_port    = port;
+  metrics_debug   = debug;
+
+  metrics_servfd = server_socket_create(address, port, METRICS_BACKLOG, false, debug);
+
+  if(metrics_servfd == -1) return 1;
+
+  if(uring_active()) return (uring_accept(metrics_servfd, metrics_client) != 0) ? 2 : 0;
+
+  fcntl(metrics_servfd, F_SETFL, fcntl(metrics_servfd, F_GETFL) | O_NONBLOCK);
+
+  metrics_event = (event_t) { .fd = metrics_servfd, .handler = metrics_accept };
+
+  return (event_add(&metrics_event, EPOLLIN) == -1) ? 2 : 0;
+}
+
+/*
+ * Free the clients that were closed during the last event batch
+ *
+ * Clients that io_uring still has operations queued on are kept
+ */
+void metrics_collect(void)
+{
+  metrics_client_t** pointer = &metrics_closed;
+
+  while(*pointer)
+  {
+    metrics_client_t* client = *pointer;
+
+    if(conn_busy(&client->conn))
+    {
+      pointer = &client->next;
+
+      continue;
+    }
+
+    *pointer = client->next;
+
+    free(client);
+  }
+}
+
+/*
+ * Close the metrics socket and every client
+ */
+void metrics_close(void)
+{
+  if(metrics_servfd == -1) return;
+
+  if(!uring_active()) event_del(&metrics_event);
+
+  while(metrics_clients) metrics_client_close(metrics_clients);
+
+  for(metrics_client_t* client = metrics_closed; client; client = client->next)
+  {
+    conn_settle(&client->conn);
+  }
+
+  metrics_collect();
+
+  socket_close(&metrics_servfd, metrics_debug);
+}
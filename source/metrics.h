@@ -0,0 +1,91 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "debug.h"
+#include "socket.h"
+#include "conn.h"
+#include "event.h"
+#include "uring.h"
+#include "timing.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define METRICS_BACKLOG 16   // Scrapers waiting to be accepted
+
+#define HISTOGRAM_SUB     8                      // Buckets per power of two
+#define HISTOGRAM_BUCKETS (HISTOGRAM_SUB * 42)   // Microseconds up to 2^42
+
+// Counters are added to without locks, so that recording costs one instruction
+#define METRICS_ADD(counter, value) __atomic_fetch_add(&(counter), (value), __ATOMIC_RELAXED)
+
+/*
+ * Log-linear latency histogram, like HDR histograms
+ *
+ * Below 2 * HISTOGRAM_SUB microseconds, every microsecond has a bucket.
+ * Above, every power of two is split into HISTOGRAM_SUB buckets,
+ * so the precision is the same at every magnitude
+ */
+typedef struct
+{
+  uint64_t counts[HISTOGRAM_BUCKETS];
+  uint64_t count;
+  uint64_t sum;    // Microseconds
+} histogram_t;
+
+/*
+ * Relay counters in one direction, over every session
+ */
+typedef struct
+{
+  uint64_t lines;
+  uint64_t bytes;
+  uint64_t syscalls;      // Of closed sessions
+  uint64_t closed_lines;  // Lines of closed sessions, to relate to the syscalls
+} metrics_relay_t;
+
+/*
+ * Counters of the node, served in the Prometheus text format
+ */
+typedef struct
+{
+  uint64_t        accepted;    // Clients accepted on the UCI port
+  uint64_t        opened;      // Sessions opened, including logical sessions
+  uint64_t        closed;
+  uint64_t        resets;      // Engine resets that have completed
+  metrics_relay_t to_engine;
+  metrics_relay_t to_client;
+  histogram_t     reset;       // Engine reset duration
+  histogram_t     go_info;     // go to first info line
+  histogram_t     go_bestmove; // go to bestmove
+  histogram_t     response;    // Accept to the first response
+  uint64_t        waiting;     // Sessions waiting for an engine
+  uint64_t        refused;     // Sessions refused by a full admission queue
+  uint64_t        expired;     // Sessions that waited past the deadline
+  histogram_t     queue_wait;  // Wait for an engine
+  uint64_t        scrapes;
+} metrics_t;
+
+extern metrics_t metrics;
+
+extern void histogram_record(histogram_t* histogram, uint64_t nanos);
+
+
+extern int  metrics_listen(const char* address, int port, bool debug);
+
+extern void metrics_collect(void);
+
+extern void metrics_close(void);
+
+#endif // METRICS_H
@@ -0,0 +1,310 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "mux.h"
+#include "session.h"
+
+/*
+ * Create the logical session table of a carrier session
+ *
+ * RETURN (mux_t* mux)
+ * - NULL | Failed to allocate table
+ */
+mux_t* mux_create(session_t* carrier, size_t limit)
+{
+  mux_t* mux = malloc(sizeof(mux_t));
+
+  if(!mux) return NULL;
+
+  *mux = (mux_t) { .carrier = carrier, .bucket_count = MUX_BUCKETS, .limit = limit };
+
+  mux->buckets = calloc(MUX_BUCKETS, sizeof(session_t*));
+
+  if(!mux->buckets)
+  {
+    free(mux);
+
+    return NULL;
+  }
+
+  return mux;
+}
+
+/*
+ * Free the table, after the logical sessions have been closed
+ */
+void mux_free(mux_t* mux)
+{
+  free(mux->buckets);
+
+  free(mux);
+}
+
+/*
+ * Find the logical session with id
+ *
+ * RETURN (session_t* session)
+ * - NULL | No open session has the id
+ */
+static session_t* mux_find(mux_t* mux, unsigned long id)
+{
+  session_t* session = mux->buckets[id & (mux->bucket_count - 1)];
+
+  while(session && session->id != id) session = session->sibling;
+
+  return session;
+}
+
+/*
+ * Double the number of buckets, when the chains get long
+ */
+static void mux_grow(mux_t* mux)
+{
+  size_t bucket_count = mux->bucket_count * 2;
+
+  session_t** buckets = calloc(bucket_count, sizeof(session_t*));
+
+  // The table still works without growing, just slower
+  if(!buckets) return;
+
+  for(size_t index = 0; index < mux->bucket_count; index++)
+  {
+    session_t* session = mux->buckets[index];
+
+    while(session)
+    {
+      session_t* sibling = session->sibling;
+
+      size_t bucket = session->id & (bucket_count - 1);
+
+      session->sibling = buckets[bucket];
+
+      buckets[bucket] = session;
+
+      session = sibling;
+    }
+  }
+
+  free(mux->buckets);
+
+  mux->buckets      = buckets;
+  mux->bucket_count = bucket_count;
+}
+
+/*
+ * Open a logical session, and let the node find it an engine
+ *
+ * RETURN (session_t* session)
+ * - NULL | Failed to create session
+ */
+static session_t* mux_open(mux_t* mux, unsigned long id)
+{
+  session_t* carrier = mux->carrier;
+
+  session_t* session = session_create_logical(carrier, id);
+
+  if(!session) return NULL;
+
+  if(mux->count >= mux->bucket_count * 2) mux_grow(mux);
+
+  size_t bucket = id & (mux->bucket_count - 1);
+
+  session->sibling = mux->buckets[bucket];
+
+  mux->buckets[bucket] = session;
+
+  mux->count++;
+  mux->opened++;
+
+  if(carrier->debug) info_print("Opened session (%ld) of client (%d)", (long) id, carrier->sockfd);
+
+  if(carrier->open) carrier->open(session);
+
+  return session;
+}
+
+/*
+ * Tell the client that the line for a new session was refused,
+ * because it has too many sessions open
+ */
+static void mux_refuse(mux_t* mux, unsigned long id)
+{
+  session_t* carrier = mux->carrier;
+
+  if(mux->refused++ == 0 && carrier->debug)
+  {
+    info_print("Client has too many sessions open (%d)", carrier->sockfd);
+  }
+
+  char line[64];
+
+  int length = sprintf(line, "%lu info string too many sessions\n", id);
+
+  conn_write(&carrier->conn, line, length);
+}
+
+/*
+ * Remove a closed logical session from the table
+ */
+void mux_remove(mux_t* mux, session_t* session)
+{
+  session_t** pointer = &mux->buckets[session->id & (mux->bucket_count - 1)];
+
+  while(*pointer && *pointer != session) pointer = &(*pointer)->sibling;
+
+  if(!*pointer) return;
+
+  *pointer = session->sibling;
+
+  mux->count--;
+}
+
+/*
+ * Flush the commands relayed to the engine of a logical session
+ */
+static void mux_flush(session_t* session)
+{
+  if(session && session->engine) conn_flush(&session->engine->conn);
+}
+
+/*
+ * Demultiplex the input of the carrier to the logical sessions
+ *
+ * Consecutive lines of a session are relayed to its engine
+ * before it is flushed, and a session without an engine
+ * keeps the lines until it gets one
+ */
+void mux_input(mux_t* mux)
+{
+  session_t* carrier = mux->carrier;
+
+  session_t* last = NULL;
+
+  char* line;
+  ssize_t length;
+
+  while((length = reader_take(&carrier->conn.reader, &line)) > 0)
+  {
+    char* command;
+
+    unsigned long id = strtoul(line, &command, 10);
+
+    if(command == line || *command != ' ')
+    {
+      if(carrier->debug) error_print("Line without session id from client (%d)", carrier->sockfd);
+
+      continue;
+    }
+
+    command++;
+
+    size_t command_length = length - (command - line);
+
+    session_t* session = mux_find(mux, id);
+
+    bool quit = (strncmp(command, "quit", 4) == 0);
+
+    // A quit of a session that isn't open has nothing to close
+    if(!session && quit) continue;
+
+    if(!session && mux->count >= mux->limit)
+    {
+      mux_refuse(mux, id);
+
+      continue;
+    }
+
+    if(!session && !(session = mux_open(mux, id)))
+    {
+      if(carrier->debug) error_print("Failed to open session (%ld)", (long) id);
+
+      continue;
+    }
+
+    if(session != last) mux_flush(last);
+
+    last = session;
+
+    if(!session->engine && quit)
+    {
+      // A waiting session gives up its place, instead of taking an engine to quit
+      session_close(session);
+
+      last = NULL;
+    }
+    else if(!session->engine)
+    {
+      if(session_queue(session, command, command_length) != 0)
+      {
+        if(carrier->debug) error_print("Failed to queue command of session (%ld)", (long) id);
+
+        // The session would miss commands, so it is closed instead
+        session_close(session);
+
+        last = NULL;
+      }
+      else mux->queued += command_length + 1;
+    }
+    else session_command(session, command, command_length);
+
+    // A quit of a logical session leaves the carrier open
+    if(carrier->closed) return;
+  }
+
+  mux_flush(last);
+
+  session_flush(carrier);
+
+  // The lines already read are still handled, so the queued bytes stay bounded
+  if(mux->queued >= MUX_QUEUED)
+  {
+    if(carrier->debug) info_print("Pausing client with %ld bytes queued (%d)", (long) mux->queued, carrier->sockfd);
+
+    conn_pause(&carrier->conn);
+  }
+}
+
+/*
+ * Close every logical session, before the carrier is closed
+ */
+void mux_close(mux_t* mux)
+{
+  for(size_t index = 0; index < mux->bucket_count; index++)
+  {
+    // Closing a session removes it from the bucket
+    while(mux->buckets[index]) session_close(mux->buckets[index]);
+  }
+}
+
+/*
+ * The carrier has caught up, so every logical session can continue
+ */
+void mux_drain(mux_t* mux)
+{
+  for(size_t index = 0; index < mux->bucket_count; index++)
+  {
+    for(session_t* session = mux->buckets[index]; session; session = session->sibling)
+    {
+      session_resume(session);
+
+      // The carrier might have failed, and closed every session
+      if(mux->carrier->closed) return;
+    }
+  }
+}
+
+/*
+ * Commands a logical session had queued have been handed to its engine,
+ * or dropped, so the carrier can be read again, if it had queued too much
+ */
+void mux_unqueue(mux_t* mux, size_t length)
+{
+  mux->queued -= (length < mux->queued) ? length : mux->queued;
+
+  session_t* carrier = mux->carrier;
+
+  if(mux->queued < MUX_QUEUED && !carrier->closed) conn_resume(&carrier->conn);
+}
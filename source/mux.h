@@ -0,0 +1,62 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef MUX_H
+#define MUX_H
+
+#include "debug.h"
+#include "reader.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MUX_BUCKETS  64
+#define MUX_SESSIONS 1024 // Default for the most open logical sessions of one client
+#define MUX_QUEUED   (16 * READER_MAX_SIZE) // Queued bytes of the logical sessions, before the carrier is paused
+
+/*
+ * Logical sessions multiplexed over the connection of a carrier session
+ *
+ * After the client has sent mux as its first line, every line it sends
+ * starts with a session id, and the lines sent back start with the id
+ * of the session they belong to. A logical session is opened by the
+ * first line with its id, and closed by quit. The lines of new ids
+ * are refused while limit sessions are open
+ *
+ * The commands of the sessions waiting for an engine are queued, and
+ * once too much is queued, the carrier is not read until some of it
+ * has been handed to engines
+ */
+typedef struct
+{
+  struct session_t*  carrier;
+  struct session_t** buckets;      // Logical sessions by id, chained by sibling
+  size_t             bucket_count; // Power of two
+  size_t             count;
+  size_t             limit;        // Most open logical sessions
+  size_t             opened;       // Number of logical sessions opened
+  size_t             refused;      // Lines refused because of the limit
+  size_t             queued;       // Bytes queued by the sessions waiting for an engine
+} mux_t;
+
+extern mux_t* mux_create(struct session_t* carrier, size_t limit);
+
+extern void   mux_free(mux_t* mux);
+
+
+extern void   mux_input(mux_t* mux);
+
+extern void   mux_remove(mux_t* mux, struct session_t* session);
+
+extern void   mux_close(mux_t* mux);
+
+extern void   mux_drain(mux_t* mux);
+
+extern void   mux_unqueue(mux_t* mux, size_t length);
+
+#endif // MUX_H
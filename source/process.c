@@ -0,0 +1,114 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#include "process.h"
+
+/*
+ * Close both ends of a pipe, the ones that are open
+ */
+static void pipe_close(int pipefd[2])
+{
+  if(pipefd[0] != -1) close(pipefd[0]);
+
+  if(pipefd[1] != -1) close(pipefd[1]);
+
+  pipefd[0] = -1;
+  pipefd[1] = -1;
+}
+
+/*
+ * Start command in a child process, with the shell
+ *
+ * The stdin and stdout of the child are connected to anonymous pipes,
+ * which are not inherited by processes spawned after it
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to create pipes
+ * - 2 | Failed to fork
+ */
+int process_spawn(process_t* process, const char* command, bool debug)
+{
+  *process = (process_t) { .pid = -1, .stdin = -1, .stdout = -1 };
+
+  int stdin_pipe[2]  = { -1, -1 };
+  int stdout_pipe[2] = { -1, -1 };
+
+  if(pipe2(stdin_pipe, O_CLOEXEC) == -1 || pipe2(stdout_pipe, O_CLOEXEC) == -1)
+  {
+    if(debug) error_print("Failed to create pipes: %s", strerror(errno));
+
+    pipe_close(stdin_pipe);
+
+    pipe_close(stdout_pipe);
+
+    return 1;
+  }
+
+  if(debug) info_print("Spawning process (%s)", command);
+
+  pid_t pid = fork();
+
+  if(pid == -1)
+  {
+    if(debug) error_print("Failed to fork: %s", strerror(errno));
+
+    pipe_close(stdin_pipe);
+
+    pipe_close(stdout_pipe);
+
+    return 2;
+  }
+
+  if(pid == 0)
+  {
+    // The duplicated descriptors don't keep the close-on-exec flag
+    dup2(stdin_pipe[0],  STDIN_FILENO);
+    dup2(stdout_pipe[1], STDOUT_FILENO);
+
+    // The node ignores broken pipes, but the engine should not
+    signal(SIGPIPE, SIG_DFL);
+
+    execl("/bin/sh", "sh", "-c", command, (char*) NULL);
+
+    _exit(127);
+  }
+
+  close(stdin_pipe[0]);
+  close(stdout_pipe[1]);
+
+  *process = (process_t) { .pid = pid, .stdin = stdin_pipe[1], .stdout = stdout_pipe[0] };
+
+  if(debug) info_print("Spawned process (%d)", pid);
+
+  return 0;
+}
+
+/*
+ * Close the pipes of process, and wait for it to exit
+ *
+ * Closing the stdin pipe gives the process end of file,
+ * which makes most engines exit even without a quit command
+ */
+void process_close(process_t* process, bool debug)
+{
+  if(process->stdin  != -1) close(process->stdin);
+
+  if(process->stdout != -1) close(process->stdout);
+
+  process->stdin  = -1;
+  process->stdout = -1;
+
+  if(process->pid == -1) return;
+
+  if(debug) info_print("Waiting for process (%d)", process->pid);
+
+  while(waitpid(process->pid, NULL, 0) == -1 && errno == EINTR);
+
+  if(debug) info_print("Process exited (%d)", process->pid);
+
+  process->pid = -1;
+}
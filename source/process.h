@@ -0,0 +1,41 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#ifndef PROCESS_H
+#define PROCESS_H
+
+// pipe2 is a GNU extension
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "debug.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/*
+ * Child process, with its stdin and stdout connected to anonymous pipes
+ */
+typedef struct
+{
+  pid_t pid;
+  int   stdin;  // Write end of the pipe to the stdin of the process
+  int   stdout; // Read end of the pipe from the stdout of the process
+} process_t;
+
+extern int  process_spawn(process_t* process, const char* command, bool debug);
+
+extern void process_close(process_t* process, bool debug);
+
+#endif // PROCESS_H
@@ -0,0 +1,836 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "proxy.h"
+#include "uci.h"
+
+/*
+ * Find the client with the id of a logical session
+ *
+ * RETURN (proxy_client_t* client)
+ * - NULL | No open client has the id
+ */
+static proxy_client_t* proxy_find(proxy_t* proxy, unsigned long id)
+{
+  proxy_client_t* client = proxy->buckets[id & (PROXY_BUCKETS - 1)];
+
+  while(client && client->id != id) client = client->sibling;
+
+  return client;
+}
+
+/*
+ * Remove client from the table
+ */
+static void proxy_unlink(proxy_t* proxy, proxy_client_t* client)
+{
+  proxy_client_t** pointer = &proxy->buckets[client->id & (PROXY_BUCKETS - 1)];
+
+  while(*pointer && *pointer != client) pointer = &(*pointer)->sibling;
+
+  if(*pointer) *pointer = client->sibling;
+}
+
+/*
+ * Close client, and the logical session it has on its backend
+ *
+ * The client is freed once the current event batch has been handled
+ */
+static void client_close(proxy_client_t* client)
+{
+  if(client->closed) return;
+
+  client->closed = true;
+
+  proxy_t*    proxy    = client->proxy;
+  upstream_t* upstream = client->upstream;
+
+  // Unlinked first, because losing the backend closes its clients
+  proxy_unlink(proxy, client);
+
+  upstream->active--;
+
+  if(client->opened && upstream->connected)
+  {
+    conn_write(&upstream->conn, client->tag, client->tag_length);
+
+    conn_write(&upstream->conn, "quit\n", 5);
+
+    conn_flush(&upstream->conn);
+  }
+
+  conn_close(&client->conn);
+
+  socket_close(&client->sockfd, proxy->debug);
+
+  throttle_free(&client->throttle);
+
+  // The backend might have been paused for the client
+  if(upstream->connected) conn_resume(&upstream->conn);
+
+  client->next = proxy->closed;
+
+  proxy->closed = client;
+}
+
+/*
+ * Close the clients of a backend that has been lost, and its connection
+ *
+ * A new connection is made when the next client is routed
+ */
+static void upstream_disconnect(upstream_t* upstream)
+{
+  if(!upstream->connected) return;
+
+  proxy_t* proxy = upstream->proxy;
+
+  upstream->connected = false;
+
+  for(size_t index = 0; index < PROXY_BUCKETS; index++)
+  {
+    proxy_client_t** pointer = &proxy->buckets[index];
+
+    while(*pointer)
+    {
+      // Closing a client removes it from the bucket
+      if((*pointer)->upstream == upstream) client_close(*pointer);
+
+      else pointer = &(*pointer)->sibling;
+    }
+  }
+
+  conn_close(&upstream->conn);
+
+  socket_close(&upstream->sockfd, proxy->debug);
+}
+
+/*
+ * Remember a load report of the backend
+ */
+static void upstream_report(upstream_t* upstream, const char* line)
+{
+  unsigned long busy, waiting, engines;
+
+  if(sscanf(line + 5, "%lu %lu %lu", &busy, &waiting, &engines) != 3)
+  {
+    if(upstream->proxy->debug) error_print("Invalid load report from backend (%s:%d)", upstream->address, upstream->port);
+
+    return;
+  }
+
+  upstream->busy    = busy;
+  upstream->waiting = waiting;
+  upstream->engines = engines;
+
+  // The report includes the sessions routed before it
+  upstream->routed = 0;
+
+  upstream->reports++;
+}
+
+/*
+ * Check if the client is falling behind the backend output
+ */
+static bool client_behind(proxy_client_t* client)
+{
+  return client->conn.writing && conn_pending(&client->conn) >= THROTTLE_PENDING;
+}
+
+/*
+ * Relay a line of the backend to client, or throttle it,
+ * if the client can't keep up
+ */
+static void client_output(proxy_client_t* client, const char* line, size_t length)
+{
+  // Once lines are throttled, the rest has to wait for them
+  if(client->throttle.count > 0 || client_behind(client))
+  {
+    if(throttle_push(&client->throttle, line, length) == 2)
+    {
+      if(client->proxy->debug) error_print("Failed to queue backend output");
+    }
+
+    return;
+  }
+
+  conn_line(&client->conn, line, length);
+}
+
+/*
+ * Write the lines that were throttled for client
+ */
+static void client_release(proxy_client_t* client)
+{
+  throttle_t* throttle = &client->throttle;
+
+  for(size_t index = 0; index < throttle->count; index++)
+  {
+    throttle_line_t* line = &throttle->lines[index];
+
+    if(conn_write(&client->conn, line->line, line->length) == -1) break;
+  }
+
+  throttle_clear(throttle);
+}
+
+/*
+ * Flush the output relayed to client
+ *
+ * Only if the lines that are always delivered pile up, the backend
+ * is paused until the client has caught up, which holds up its
+ * other clients too
+ */
+static void client_flush(proxy_client_t* client)
+{
+  if(!client || client->closed) return;
+
+  conn_flush(&client->conn);
+
+  // A flush that writes everything doesn't call the drain handler,
+  // so the lines that were throttled meanwhile are released here
+  if(client->throttle.count > 0 && !client->conn.writing && !client->closed)
+  {
+    client_release(client);
+
+    conn_flush(&client->conn);
+  }
+
+  // The client might have failed
+  if(client->closed) return;
+
+  if(client->throttle.bytes > THROTTLE_BYTES) conn_pause(&client->upstream->conn);
+}
+
+/*
+ * The client has caught up, so the throttled lines are written,
+ * and the backend can continue
+ */
+static void client_drain(conn_t* conn)
+{
+  proxy_client_t* client = conn->data;
+
+  if(client->throttle.count > 0)
+  {
+    client_release(client);
+
+    conn_flush(conn);
+  }
+
+  if(!client->closed && client->upstream->connected) conn_resume(&client->upstream->conn);
+}
+
+/*
+ * The backend has refused the session of client, because the proxy
+ * has as many sessions open on it as it allows. Later clients are
+ * routed to other backends, and the client is told and closed
+ */
+static void upstream_refuse(upstream_t* upstream, proxy_client_t* client, const char* line, size_t length)
+{
+  proxy_t* proxy = upstream->proxy;
+
+  // Clients routed after the refused one might not be open on the backend either,
+  // in which case a later refusal lowers the limit
+  if(upstream->limit == 0 || upstream->active - 1 < upstream->limit)
+  {
+    upstream->limit = upstream->active - 1;
+  }
+
+  if(proxy->debug)
+  {
+    error_print("Backend (%s:%d) refused session (%ld), with %ld sessions open",
+      upstream->address, upstream->port, (long) client->id, (long) upstream->limit);
+  }
+
+  proxy->refused++;
+
+  conn_line(&client->conn, line, length);
+
+  conn_flush(&client->conn);
+
+  // With io_uring, the line is written before the close would cancel the write
+  conn_settle(&client->conn);
+
+  // The session was never opened on the backend, so it isn't sent quit
+  client->opened = false;
+
+  client_close(client);
+}
+
+/*
+ * Communication from backend to clients
+ *
+ * The lines of the logical sessions are relayed without their id,
+ * and without copying, until the client is flushed
+ */
+static void upstream_input(conn_t* conn)
+{
+  upstream_t* upstream = conn->data;
+
+  proxy_t* proxy = upstream->proxy;
+
+  proxy_client_t* last = NULL;
+
+  char* line;
+  ssize_t length;
+
+  // A client that fails can take the backend with it, freeing the reader
+  while(upstream->connected && (length = reader_take(&conn->reader, &line)) > 0)
+  {
+    if(strncmp(line, "load ", 5) == 0)
+    {
+      upstream_report(upstream, line);
+
+      continue;
+    }
+
+    char* output;
+
+    unsigned long id = strtoul(line, &output, 10);
+
+    if(output == line || *output != ' ')
+    {
+      if(proxy->debug) error_print("Line without session id from backend (%s:%d)", upstream->address, upstream->port);
+
+      continue;
+    }
+
+    output++;
+
+    proxy_client_t* client = proxy_find(proxy, id);
+
+    // The output of a client that has disconnected is dropped
+    if(!client || client->upstream != upstream) continue;
+
+    if(client != last) client_flush(last);
+
+    last = client;
+
+    // A backend refuses a session past its limit with the first line for it
+    if(!client->answered && uci_command(output, "info string too many sessions"))
+    {
+      upstream_refuse(upstream, client, output, length - (output - line));
+
+      last = NULL;
+
+      continue;
+    }
+
+    client->answered = true;
+
+    client_output(client, output, length - (output - line));
+  }
+
+  if(upstream->connected) client_flush(last);
+}
+
+/*
+ * The backend has disconnected, or can't be written to
+ */
+static void upstream_conn_close(conn_t* conn)
+{
+  upstream_t* upstream = conn->data;
+
+  if(upstream->proxy->debug) error_print("Lost backend (%s:%d)", upstream->address, upstream->port);
+
+  upstream_disconnect(upstream);
+}
+
+/*
+ * Open the connection to the backend, after the socket has connected,
+ * and ask it to multiplex sessions and report its load
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to open connection
+ * - 2 | Failed to write to backend
+ */
+static int upstream_open(upstream_t* upstream)
+{
+  bool debug = upstream->proxy->debug;
+
+  if(conn_open(&upstream->conn, upstream->sockfd, upstream->sockfd, upstream) != 0)
+  {
+    if(debug) error_print("Failed to open backend connection");
+
+    socket_close(&upstream->sockfd, debug);
+
+    return 1;
+  }
+
+  upstream->conn.input = upstream_input;
+  upstream->conn.close = upstream_conn_close;
+
+  upstream->connected = true;
+
+  // Until the first report, the backend is assumed to be idle
+  upstream->busy    = 0;
+  upstream->waiting = 0;
+  upstream->engines = 0;
+  upstream->routed  = 0;
+  upstream->limit   = 0;
+
+  if(debug) info_print("Connected to backend (%s:%d)", upstream->address, upstream->port);
+
+  return (conn_message(&upstream->conn, "mux load\n") == -1) ? 2 : 0;
+}
+
+/*
+ * The socket of the backend has become writable, so it has either connected or failed
+ */
+static void upstream_writable(event_t* event, uint32_t events)
+{
+  upstream_t* upstream = event->data;
+
+  bool debug = upstream->proxy->debug;
+
+  if(!uring_active()) event_del(&upstream->event);
+
+  upstream->connecting = false;
+
+  if(socket_connect_end(upstream->sockfd, debug) != 0)
+  {
+    socket_close(&upstream->sockfd, debug);
+
+    return;
+  }
+
+  upstream_open(upstream);
+}
+
+/*
+ * Stop waiting for the backend to connect
+ */
+static void upstream_abort(upstream_t* upstream)
+{
+  if(!upstream->connecting) return;
+
+  if(uring_active()) uring_poll_cancel(&upstream->event);
+
+  else event_del(&upstream->event);
+
+  upstream->connecting = false;
+
+  socket_close(&upstream->sockfd, upstream->proxy->debug);
+}
+
+/*
+ * Start connecting to the backend
+ *
+ * The backend can be routed to once it has connected, see upstream_writable
+ *
+ * RETURN (int status)
+ * - 0 | Success, the connection is being made
+ * - 1 | Failed to connect
+ * - 2 | Failed to wait for the connection
+ */
+static int upstream_connect(upstream_t* upstream)
+{
+  bool debug = upstream->proxy->debug;
+
+  upstream->attempt = timing_now();
+
+  upstream->sockfd = socket_connect_begin(upstream->address, upstream->port, debug);
+
+  if(upstream->sockfd == -1) return 1;
+
+  upstream->event = (event_t) { .fd = upstream->sockfd, .handler = upstream_writable, .data = upstream };
+
+  int status = uring_active() ? uring_poll(&upstream->event, EPOLLOUT) : event_add(&upstream->event, EPOLLOUT);
+
+  if(status != 0)
+  {
+    if(debug) error_print("Failed to wait for backend (%s:%d)", upstream->address, upstream->port);
+
+    socket_close(&upstream->sockfd, debug);
+
+    return 2;
+  }
+
+  upstream->connecting = true;
+
+  return 0;
+}
+
+/*
+ * Get the load of backend, as the number of sessions it has
+ * to serve, including the ones routed since its last report
+ */
+static size_t upstream_load(upstream_t* upstream)
+{
+  return upstream->busy + upstream->waiting + upstream->routed;
+}
+
+/*
+ * Check if backend a has less load per engine than backend b
+ */
+static bool upstream_less(upstream_t* a, upstream_t* b)
+{
+  size_t a_engines = (a->engines > 0) ? a->engines : 1;
+  size_t b_engines = (b->engines > 0) ? b->engines : 1;
+
+  return upstream_load(a) * b_engines < upstream_load(b) * a_engines;
+}
+
+/*
+ * Find the least loaded backend, reconnecting to lost backends
+ * that have not been tried for a while
+ *
+ * RETURN (upstream_t* upstream)
+ * - NULL | No backend is connected, with room for another session
+ */
+static upstream_t* proxy_route(proxy_t* proxy)
+{
+  uint64_t now = timing_now();
+
+  upstream_t* best = NULL;
+
+  for(size_t index = 0; index < proxy->count; index++)
+  {
+    upstream_t* upstream = &proxy->upstreams[index];
+
+    // The buffers of the lost connection might still be used by io_uring
+    if(!upstream->connected && !upstream->connecting && !conn_busy(&upstream->conn) && now - upstream->attempt >= PROXY_RETRY)
+    {
+      upstream_connect(upstream);
+    }
+
+    if(!upstream->connected) continue;
+
+    if(upstream->limit > 0 && upstream->active >= upstream->limit) continue;
+
+    if(!best || upstream_less(upstream, best)) best = upstream;
+  }
+
+  return best;
+}
+
+/*
+ * Relay a line of the client to its backend, prefixed with its id
+ *
+ * The line is not copied, until the backend is flushed
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | The backend can't be written to
+ */
+static int client_relay(proxy_client_t* client, const char* line, size_t length)
+{
+  conn_t* conn = &client->upstream->conn;
+
+  if(conn_write(conn, client->tag, client->tag_length) == -1) return 1;
+
+  if(conn_line(conn, line, length) == -1) return 1;
+
+  // A last line at end of file has no newline
+  if(line[length - 1] != '\n' && conn_write(conn, "\n", 1) == -1) return 1;
+
+  client->opened = true;
+
+  return 0;
+}
+
+/*
+ * Communication from client to backend
+ */
+static void client_input(conn_t* conn)
+{
+  proxy_client_t* client = conn->data;
+
+  upstream_t* upstream = client->upstream;
+
+  char* line;
+  ssize_t length;
+
+  while((length = reader_take(&conn->reader, &line)) > 0)
+  {
+    if(client_relay(client, line, length) != 0) return;
+
+    if(uci_command(line, "quit"))
+    {
+      // The lines are relayed from the reader, so they are written before it is freed
+      conn_flush(&upstream->conn);
+
+      // The quit has already closed the logical session
+      client->opened = false;
+
+      client_close(client);
+
+      return;
+    }
+  }
+
+  conn_flush(&upstream->conn);
+}
+
+/*
+ * The client has disconnected, or can't be written to
+ */
+static void client_conn_close(conn_t* conn)
+{
+  client_close(conn->data);
+}
+
+/*
+ * Route accepted client to the least loaded backend
+ *
+ * Without a connected backend, the client is told so and closed
+ */
+void proxy_client(proxy_t* proxy, int sockfd)
+{
+  upstream_t* upstream = proxy_route(proxy);
+
+  if(!upstream)
+  {
+    if(proxy->debug) error_print("No backend for client (%d)", sockfd);
+
+    socket_write(sockfd, "info string no backend is available\n", 36);
+
+    socket_close(&sockfd, proxy->debug);
+
+    proxy->rejected++;
+
+    return;
+  }
+
+  proxy_client_t* client = malloc(sizeof(proxy_client_t));
+
+  if(!client)
+  {
+    socket_close(&sockfd, proxy->debug);
+
+    return;
+  }
+
+  *client = (proxy_client_t) { .sockfd = sockfd, .proxy = proxy, .upstream = upstream };
+
+  if(conn_open(&client->conn, sockfd, sockfd, client) != 0)
+  {
+    if(proxy->debug) error_print("Failed to open client connection");
+
+    socket_close(&sockfd, proxy->debug);
+
+    free(client);
+
+    return;
+  }
+
+  client->conn.input = client_input;
+  client->conn.close = client_conn_close;
+  client->conn.drain = client_drain;
+
+  client->id = ++proxy->next_id;
+
+  client->tag_length = sprintf(client->tag, "%lu ", client->id);
+
+  size_t bucket = client->id & (PROXY_BUCKETS - 1);
+
+  client->sibling = proxy->buckets[bucket];
+
+  proxy->buckets[bucket] = client;
+
+  upstream->routed++;
+  upstream->sessions++;
+  upstream->active++;
+
+  proxy->clients++;
+
+  if(proxy->debug)
+  {
+    info_print("Routed client (%d) to backend (%s:%d) as session (%ld)",
+      sockfd, upstream->address, upstream->port, (long) client->id);
+  }
+}
+
+/*
+ * Free the clients that were closed during the last event batch
+ *
+ * Clients that io_uring still has operations queued on are kept
+ */
+void proxy_collect(proxy_t* proxy)
+{
+  proxy_client_t** pointer = &proxy->closed;
+
+  while(*pointer)
+  {
+    proxy_client_t* client = *pointer;
+
+    if(conn_busy(&client->conn))
+    {
+      pointer = &client->next;
+
+      continue;
+    }
+
+    *pointer = client->next;
+
+    free(client);
+  }
+}
+
+/*
+ * Close every client and backend connection
+ */
+void proxy_close(proxy_t* proxy)
+{
+  for(size_t index = 0; index < PROXY_BUCKETS; index++)
+  {
+    // Closing a client removes it from the bucket
+    while(proxy->buckets[index]) client_close(proxy->buckets[index]);
+  }
+
+  for(size_t index = 0; index < proxy->count; index++)
+  {
+    upstream_t* upstream = &proxy->upstreams[index];
+
+    upstream_abort(upstream);
+
+    upstream_disconnect(upstream);
+
+    conn_settle(&upstream->conn);
+  }
+
+  for(proxy_client_t* client = proxy->closed; client; client = client->next)
+  {
+    conn_settle(&client->conn);
+  }
+
+  proxy_collect(proxy);
+}
+
+/*
+ * Parse a backend address, either as address:port or just a port
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Invalid address or port
+ */
+static int upstream_parse(upstream_t* upstream, const char* string)
+{
+  const char* colon = strrchr(string, ':');
+
+  const char* address = colon ? string : "127.0.0.1";
+
+  size_t address_length = colon ? (size_t) (colon - string) : strlen(address);
+
+  if(address_length == 0 || address_length >= sizeof(upstream->address)) return 1;
+
+  memcpy(upstream->address, address, address_length);
+
+  upstream->address[address_length] = '\0';
+
+  upstream->port = atoi(colon ? colon + 1 : string);
+
+  return (upstream->port > 0) ? 0 : 1;
+}
+
+/*
+ * Wait for the backends to connect, so that the first clients have
+ * a backend, but no longer than a backend is waited for when retried
+ */
+static void proxy_connect_wait(proxy_t* proxy)
+{
+  uint64_t start = timing_now();
+
+  while(timing_now() - start < PROXY_RETRY)
+  {
+    bool connecting = false;
+
+    for(size_t index = 0; index < proxy->count; index++)
+    {
+      if(proxy->upstreams[index].connecting) connecting = true;
+    }
+
+    if(!connecting) break;
+
+    int status = uring_active() ? uring_wait(PROXY_RETRY / 10000000) : event_wait(PROXY_RETRY / 10000000);
+
+    if(status == -1 && errno != EINTR) break;
+  }
+}
+
+/*
+ * Initialize proxy, and connect to the backends
+ *
+ * Backends that can't be connected to yet are tried again
+ * when clients are routed
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate proxy
+ * - 2 | Invalid backend address
+ */
+int proxy_init(proxy_t* proxy, char** addresses, size_t count, bool debug)
+{
+  *proxy = (proxy_t) { .debug = debug };
+
+  proxy->upstreams = calloc(count, sizeof(upstream_t));
+  proxy->buckets   = calloc(PROXY_BUCKETS, sizeof(proxy_client_t*));
+
+  if(!proxy->upstreams || !proxy->buckets)
+  {
+    proxy_free(proxy);
+
+    return 1;
+  }
+
+  for(size_t index = 0; index < count; index++)
+  {
+    upstream_t* upstream = &proxy->upstreams[index];
+
+    upstream->proxy  = proxy;
+    upstream->sockfd = -1;
+
+    if(upstream_parse(upstream, addresses[index]) != 0)
+    {
+      if(debug) error_print("Invalid backend address: %s", addresses[index]);
+
+      proxy_free(proxy);
+
+      return 2;
+    }
+
+    proxy->count++;
+  }
+
+  for(size_t index = 0; index < proxy->count; index++)
+  {
+    upstream_connect(&proxy->upstreams[index]);
+  }
+
+  proxy_connect_wait(proxy);
+
+  return 0;
+}
+
+/*
+ * Free proxy, after it has been closed
+ */
+void proxy_free(proxy_t* proxy)
+{
+  free(proxy->upstreams);
+
+  free(proxy->buckets);
+
+  *proxy = (proxy_t) { 0 };
+}
+
+/*
+ * Print the sessions routed to every backend, and its last report
+ */
+void proxy_print(proxy_t* proxy)
+{
+  info_print("proxy: %ld clients, %ld rejected, %ld refused by backends",
+    (long) proxy->clients, (long) proxy->rejected, (long) proxy->refused);
+
+  for(size_t index = 0; index < proxy->count; index++)
+  {
+    upstream_t* upstream = &proxy->upstreams[index];
+
+    info_print("Backend (%s:%d): %ld sessions, %ld reports, %ld busy, %ld waiting, %ld engines",
+      upstream->address, upstream->port, (long) upstream->sessions, (long) upstream->reports,
+      (long) upstream->busy, (long) upstream->waiting, (long) upstream->engines);
+  }
+}
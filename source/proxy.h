@@ -0,0 +1,125 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef PROXY_H
+#define PROXY_H
+
+#include "debug.h"
+#include "socket.h"
+#include "conn.h"
+#include "event.h"
+#include "uring.h"
+#include "timing.h"
+#include "throttle.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PROXY_BUCKETS 256
+
+#define PROXY_RETRY 1000000000 // Nanoseconds between attempts to reconnect to a backend
+
+typedef struct proxy_t proxy_t;
+
+/*
+ * Persistent connection to a backend node
+ *
+ * The proxy multiplexes the sessions it routes to the backend over the
+ * connection, by sending mux load as the first line. After it, the
+ * backend publishes a load line whenever the number of busy engines,
+ * waiting sessions or engines has changed
+ *
+ * The connection is made without blocking, by waiting for the socket
+ * to become writable, so that a backend that doesn't answer can't
+ * hold up the event loop
+ *
+ * A backend refuses sessions past its limit per connection. Once it has
+ * refused one, no more clients are routed to it than it had open then
+ */
+typedef struct
+{
+  conn_t   conn;
+  int      sockfd;
+  char     address[64];
+  int      port;
+  proxy_t* proxy;
+  bool     connected;
+  bool     connecting;
+  event_t  event;    // The socket becoming writable, while connecting
+  uint64_t attempt;  // Last attempt to connect
+  size_t   busy;     // Reported number of busy engines
+  size_t   waiting;  // Reported number of sessions waiting for an engine
+  size_t   engines;  // Reported number of engines
+  size_t   routed;   // Sessions routed since the last report
+  size_t   sessions; // Sessions routed in total
+  size_t   active;   // Clients routed to it that are open
+  size_t   limit;    // Most sessions it lets the proxy open, 0 until it has refused one
+  size_t   reports;
+} upstream_t;
+
+typedef struct proxy_client_t proxy_client_t;
+
+/*
+ * Client of the proxy, relayed as a logical session of a backend
+ *
+ * If the client can't keep up, the info lines for it are throttled,
+ * like the engine output of a session
+ */
+struct proxy_client_t
+{
+  conn_t          conn;
+  int             sockfd;
+  proxy_t*        proxy;
+  upstream_t*     upstream;
+  unsigned long   id;       // Id of the logical session on the backend
+  char            tag[24];  // Prefix of the lines sent to the backend
+  size_t          tag_length;
+  bool            opened;   // A line has been sent, opening the logical session
+  bool            answered; // The backend has sent a line for the client
+  throttle_t      throttle; // Backend output waiting for the client
+  bool            closed;
+  proxy_client_t* sibling;  // Next client in the same bucket
+  proxy_client_t* next;     // Next closed client
+};
+
+/*
+ * Front proxy, routing every client to the least loaded backend
+ *
+ * The load of a backend is its busy engines and waiting sessions,
+ * including the sessions routed to it since its last report,
+ * relative to the number of engines it has
+ */
+struct proxy_t
+{
+  upstream_t*      upstreams;
+  size_t           count;
+  proxy_client_t** buckets;   // Clients by id, chained by sibling
+  unsigned long    next_id;
+  proxy_client_t*  closed;    // Clients that can be freed after the event batch
+  size_t           clients;   // Number of routed clients
+  size_t           rejected;  // Number of clients without a backend
+  size_t           refused;   // Number of clients a backend had no room for
+  bool             debug;
+};
+
+extern int  proxy_init(proxy_t* proxy, char** addresses, size_t count, bool debug);
+
+extern void proxy_free(proxy_t* proxy);
+
+
+extern void proxy_client(proxy_t* proxy, int sockfd);
+
+extern void proxy_collect(proxy_t* proxy);
+
+extern void proxy_close(proxy_t* proxy);
+
+extern void proxy_print(proxy_t* proxy);
+
+#endif // PROXY_H
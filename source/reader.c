@@ -0,0 +1,496 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "reader.h"
+
+/*
+ * Initialize reader for file descriptor, allocating the ring buffer
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate buffer
+ */
+int reader_init(reader_t* reader, int fd)
+{
+  memset(reader, 0, sizeof(reader_t));
+
+  // The extra byte makes room for terminating a line at the end
+  if(!(reader->buffer = malloc(READER_SIZE + 1))) return 1;
+
+  reader->size = READER_SIZE;
+
+  reader->fd = fd;
+
+  return 0;
+}
+
+/*
+ * Discard everything buffered and start reading from another file descriptor
+ *
+ * The allocated buffers and the counters are kept
+ */
+void reader_reset(reader_t* reader, int fd)
+{
+  reader->fd     = fd;
+  reader->head   = 0;
+  reader->length = 0;
+  reader->scan   = 0;
+  reader->mark   = NULL;
+  reader->eof    = false;
+}
+
+/*
+ * Free the buffers of reader
+ */
+void reader_free(reader_t* reader)
+{
+  free(reader->buffer);
+
+  free(reader->line);
+
+  free(reader->last);
+
+  memset(reader, 0, sizeof(reader_t));
+
+  reader->fd = -1;
+}
+
+/*
+ * Restore the byte that was overwritten to terminate the last line
+ */
+static void reader_unmark(reader_t* reader)
+{
+  if(!reader->mark) return;
+
+  *reader->mark = reader->marked;
+
+  reader->mark = NULL;
+}
+
+/*
+ * Terminate line by overwriting the byte after it
+ */
+static void reader_terminate(reader_t* reader, char* end)
+{
+  reader->mark   = end;
+  reader->marked = *end;
+
+  *end = '\0';
+}
+
+/*
+ * Find the first newline in the unread bytes
+ *
+ * Bytes that have been scanned before are not scanned again
+ *
+ * RETURN (ssize_t index)
+ * - >=0 | Index of newline, relative to head
+ * -  -1 | No newline is buffered
+ */
+static ssize_t reader_find(reader_t* reader)
+{
+  while(reader->scan < reader->length)
+  {
+    size_t start = (reader->head + reader->scan) % reader->size;
+
+    size_t count = reader->length - reader->scan;
+
+    if(count > reader->size - start) count = reader->size - start;
+
+    char* newline = memchr(reader->buffer + start, '\n', count);
+
+    if(newline) return reader->scan + (newline - (reader->buffer + start));
+
+    reader->scan += count;
+  }
+
+  return -1;
+}
+
+/*
+ * Double the capacity of the ring buffer, moving the unread bytes to the start
+ *
+ * A peer that keeps sending without its input being taken
+ * can't make the buffer grow past READER_MAX_SIZE
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate buffer, or it can't grow anymore (ENOBUFS)
+ */
+static int reader_grow(reader_t* reader)
+{
+  if(reader->size >= READER_MAX_SIZE)
+  {
+    errno = ENOBUFS;
+
+    return 1;
+  }
+
+  size_t size = reader->size * 2;
+
+  char* buffer = malloc(size + 1);
+
+  if(!buffer) return 1;
+
+  size_t first = reader->size - reader->head;
+
+  if(first > reader->length) first = reader->length;
+
+  memcpy(buffer, reader->buffer + reader->head, first);
+
+  memcpy(buffer + first, reader->buffer, reader->length - first);
+
+  free(reader->buffer);
+
+  reader->buffer = buffer;
+  reader->size   = size;
+  reader->head   = 0;
+
+  return 0;
+}
+
+/*
+ * Read as many bytes as fits in the ring buffer, using a single syscall
+ *
+ * If the ring buffer is full, it is grown first, up to READER_MAX_SIZE
+ *
+ * RETURN (ssize_t size)
+ * - >0 | The number of read bytes
+ * -  0 | End of file
+ * - -1 | Failed to read, or to grow buffer (ENOBUFS when it is too large)
+ */
+ssize_t reader_fill(reader_t* reader)
+{
+  reader_unmark(reader);
+
+  if(reader->length == reader->size)
+  {
+    if(reader_grow(reader) != 0) return -1;
+  }
+
+  size_t tail = (reader->head + reader->length) % reader->size;
+
+  struct iovec iov[2];
+  int count = 1;
+
+  if(tail < reader->head)
+  {
+    iov[0] = (struct iovec) { reader->buffer + tail, reader->head - tail };
+  }
+  else
+  {
+    iov[0] = (struct iovec) { reader->buffer + tail, reader->size - tail };
+
+    if(reader->head > 0)
+    {
+      iov[1] = (struct iovec) { reader->buffer, reader->head };
+
+      count = 2;
+    }
+  }
+
+  ssize_t size = readv(reader->fd, iov, count);
+
+  reader->reads++;
+
+  if(size == -1) return -1;
+
+  if(size == 0)
+  {
+    reader->eof = true;
+
+    return 0;
+  }
+
+  reader->length += size;
+  reader->bytes  += size;
+
+  return size;
+}
+
+/*
+ * Get the free space after the unread bytes, for reading into without readv
+ *
+ * If the ring buffer is full, it is grown first, up to READER_MAX_SIZE.
+ * Until the read is committed, lines can still be taken, but the free
+ * space is left alone
+ *
+ * RETURN (size_t size)
+ * - >0 | Number of contiguous free bytes at space
+ * -  0 | Failed to grow buffer, or it is too large
+ */
+size_t reader_space(reader_t* reader, char** space)
+{
+  reader_unmark(reader);
+
+  if(reader->length == reader->size)
+  {
+    if(reader_grow(reader) != 0) return 0;
+  }
+
+  size_t tail = (reader->head + reader->length) % reader->size;
+
+  *space = reader->buffer + tail;
+
+  reader->lent = true;
+
+  return (tail < reader->head) ? reader->head - tail : reader->size - tail;
+}
+
+/*
+ * Account for bytes read into the space given by reader_space
+ *
+ * PARAMS
+ * - ssize_t size | Number of read bytes, 0 at end of file
+ */
+void reader_commit(reader_t* reader, ssize_t size)
+{
+  reader->reads++;
+
+  reader->lent = false;
+
+  if(size == 0) reader->eof = true;
+
+  if(size <= 0) return;
+
+  reader->length += size;
+  reader->bytes  += size;
+}
+
+/*
+ * Get the length of the next line that can be taken without reading
+ *
+ * At end of file, or when the buffer can't grow anymore,
+ * the remaining bytes are handed out even without a newline
+ *
+ * RETURN (size_t length)
+ * - >0 | Length of the next line, including the newline
+ * -  0 | No line is buffered
+ */
+static size_t reader_next(reader_t* reader)
+{
+  ssize_t index = reader_find(reader);
+
+  if(index != -1) return index + 1;
+
+  if(reader->eof) return reader->length;
+
+  if(reader->length == reader->size && reader->size >= READER_MAX_SIZE)
+  {
+    return reader->length;
+  }
+
+  return 0;
+}
+
+/*
+ * Hand out the first unread bytes as a null terminated string
+ *
+ * RETURN (ssize_t length)
+ * - >0 | Number of handed out bytes
+ * -  0 | Failed to allocate line buffer
+ */
+static ssize_t reader_extract(reader_t* reader, size_t length, char** line)
+{
+  // The terminator can't be written to free space that is being read into
+  bool lent_end = (reader->lent && length == reader->length);
+
+  if(reader->head + length <= reader->size && !lent_end)
+  {
+    *line = reader->buffer + reader->head;
+  }
+  else
+  {
+    // The bytes wrap around the ring, or end at lent space, and have to be copied
+    char**  buffer = lent_end ? &reader->last      : &reader->line;
+    size_t* size   = lent_end ? &reader->last_size : &reader->line_size;
+
+    if(length + 1 > *size)
+    {
+      char* new_buffer = realloc(*buffer, length + 1);
+
+      if(!new_buffer) return 0;
+
+      *buffer = new_buffer;
+      *size   = length + 1;
+    }
+
+    size_t first = reader->size - reader->head;
+
+    if(first > length) first = length;
+
+    memcpy(*buffer, reader->buffer + reader->head, first);
+
+    memcpy(*buffer + first, reader->buffer, length - first);
+
+    *line = *buffer;
+  }
+
+  reader_terminate(reader, *line + length);
+
+  reader->head    = (reader->head + length) % reader->size;
+  reader->length -= length;
+  reader->scan    = 0;
+
+  // Start from the beginning again, to keep future reads contiguous
+  if(reader->length == 0 && !reader->lent) reader->head = 0;
+
+  return length;
+}
+
+/*
+ * Take the next buffered line, without reading from the file descriptor
+ *
+ * The line is terminated by a null byte. If it is stored contiguously
+ * in the ring buffer, the line is not copied. The line stays valid until
+ * the reader has to read from the file descriptor again
+ *
+ * RETURN (ssize_t length)
+ * - >0 | Length of the line, including the newline
+ * -  0 | No complete line is buffered
+ */
+ssize_t reader_take(reader_t* reader, char** line)
+{
+  reader_unmark(reader);
+
+  size_t length = reader_next(reader);
+
+  if(length == 0) return 0;
+
+  if(reader_extract(reader, length, line) == 0) return 0;
+
+  reader->lines++;
+
+  return length;
+}
+
+/*
+ * Take exactly length bytes, if that many are buffered
+ *
+ * The bytes are handed out like a line, see reader_take,
+ * and are used by protocols that don't end messages with newlines
+ *
+ * RETURN (ssize_t length)
+ * - >0 | Number of taken bytes
+ * -  0 | Not enough bytes are buffered, or failed to allocate line buffer
+ */
+ssize_t reader_bytes(reader_t* reader, size_t length, char** data)
+{
+  reader_unmark(reader);
+
+  if(length == 0 || length > reader->length) return 0;
+
+  if(reader_extract(reader, length, data) == 0) return 0;
+
+  reader->lines++;
+
+  return length;
+}
+
+/*
+ * Copy the first unread bytes, without taking them
+ *
+ * RETURN (size_t length)
+ * - Number of copied bytes, less than length if not that many are buffered
+ */
+size_t reader_peek(reader_t* reader, char* data, size_t length)
+{
+  reader_unmark(reader);
+
+  if(length > reader->length) length = reader->length;
+
+  size_t first = reader->size - reader->head;
+
+  if(first > length) first = length;
+
+  memcpy(data, reader->buffer + reader->head, first);
+
+  memcpy(data + first, reader->buffer, length - first);
+
+  return length;
+}
+
+/*
+ * Grow the ring buffer until size bytes fit in it
+ *
+ * The buffer can't be moved while its free space is being read into
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate buffer, size is above READER_MAX_SIZE, or the free space is lent
+ */
+int reader_reserve(reader_t* reader, size_t size)
+{
+  if(reader->size >= size) return 0;
+
+  if(size > READER_MAX_SIZE || reader->lent) return 1;
+
+  reader_unmark(reader);
+
+  while(reader->size < size)
+  {
+    if(reader_grow(reader) != 0) return 1;
+  }
+
+  return 0;
+}
+
+/*
+ * Take every buffered byte, even the ones not ending with a newline
+ *
+ * This is used when handing the file descriptor over to something
+ * else than the reader, so that no buffered bytes are lost
+ *
+ * RETURN (ssize_t length)
+ * - >0 | Number of taken bytes
+ * -  0 | Nothing is buffered
+ */
+ssize_t reader_rest(reader_t* reader, char** data)
+{
+  reader_unmark(reader);
+
+  if(reader->length == 0) return 0;
+
+  return reader_extract(reader, reader->length, data);
+}
+
+/*
+ * Read a single line, reading from the file descriptor only if needed
+ *
+ * RETURN (ssize_t length)
+ * - >0 | Length of the line, including the newline
+ * -  0 | End of file
+ * - -1 | Failed to read
+ */
+ssize_t reader_line(reader_t* reader, char** line)
+{
+  ssize_t length;
+
+  while((length = reader_take(reader, line)) == 0)
+  {
+    if(reader->eof) return 0;
+
+    if(reader_fill(reader) == -1) return -1;
+  }
+
+  return length;
+}
+
+/*
+ * Check if a line can be taken without reading from the file descriptor
+ */
+bool reader_ready(reader_t* reader)
+{
+  if(reader->length == 0) return false;
+
+  // The terminator of the last line might have overwritten a newline
+  if(reader->mark == reader->buffer + reader->head && reader->marked == '\n')
+  {
+    return true;
+  }
+
+  return reader_next(reader) > 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef READER_H
+#define READER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define READER_SIZE     4096
+#define READER_MAX_SIZE (1 << 20) // Largest buffer, before input has to be taken
+
+/*
+ * Buffered line reader for a single file descriptor
+ *
+ * The unread bytes live in a ring buffer, that is filled with
+ * as large reads as possible and scanned for newlines with memchr
+ */
+typedef struct
+{
+  int     fd;
+  char*   buffer;    // Ring buffer, with one extra byte for a terminator
+  size_t  size;      // Capacity of the ring buffer
+  size_t  head;      // Index of the first unread byte
+  size_t  length;    // Number of unread bytes
+  size_t  scan;      // Number of unread bytes without a newline
+  char*   line;      // Line buffer for lines wrapping around the ring
+  size_t  line_size;
+  char*   last;      // Line buffer for a last line ending at lent space
+  size_t  last_size;
+  char*   mark;      // Byte overwritten to terminate the last line
+  char    marked;    // The original value of the overwritten byte
+  bool    eof;
+  bool    lent;      // The free space is being read into asynchronously
+  size_t  reads;     // Number of read syscalls
+  size_t  lines;     // Number of returned lines
+  size_t  bytes;     // Number of read bytes
+} reader_t;
+
+extern int     reader_init(reader_t* reader, int fd);
+
+extern void    reader_reset(reader_t* reader, int fd);
+
+extern void    reader_free(reader_t* reader);
+
+
+extern ssize_t reader_fill(reader_t* reader);
+
+extern size_t  reader_space(reader_t* reader, char** space);
+
+extern void    reader_commit(reader_t* reader, ssize_t size);
+
+extern ssize_t reader_take(reader_t* reader, char** line);
+
+extern ssize_t reader_line(reader_t* reader, char** line);
+
+extern ssize_t reader_bytes(reader_t* reader, size_t length, char** data);
+
+extern size_t  reader_peek(reader_t* reader, char* data, size_t length);
+
+extern int     reader_reserve(reader_t* reader, size_t size);
+
+extern ssize_t reader_rest(reader_t* reader, char** data);
+
+extern bool    reader_ready(reader_t* reader);
+
+#endif // READER_H
@@ -0,0 +1,247 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "ring.h"
+
+/*
+ * Create ring with room for capacity descriptors, rounded up to
+ * a power of two, and chunk_count pooled buffers of chunk_size bytes
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate ring
+ * - 2 | Failed to create eventfd
+ */
+int ring_init(ring_t* ring, size_t capacity, size_t chunk_size, uint32_t chunk_count)
+{
+  *ring = (ring_t) { .eventfd = -1, .chunk_size = chunk_size, .chunk_count = chunk_count };
+
+  // The descriptors fill whole cache lines
+  size_t size = RING_CACHE_LINE / sizeof(ring_line_t);
+
+  while(size < capacity) size *= 2;
+
+  ring->mask = size - 1;
+
+  int slots_status  = posix_memalign((void**) &ring->slots,  RING_CACHE_LINE, sizeof(ring_line_t) * size);
+  int chunks_status = posix_memalign((void**) &ring->chunks, RING_CACHE_LINE, sizeof(ring_chunk_t) * chunk_count);
+
+  if(slots_status  != 0) ring->slots  = NULL;
+  if(chunks_status != 0) ring->chunks = NULL;
+
+  ring->memory = malloc(chunk_size * chunk_count);
+
+  if(!ring->slots || !ring->chunks || !ring->memory)
+  {
+    ring_free(ring);
+
+    return 1;
+  }
+
+  memset(ring->chunks, 0, sizeof(ring_chunk_t) * chunk_count);
+
+  // The producer owns the first chunk
+  ring->chunks[0].pending = 1;
+
+  ring->eventfd = eventfd(0, EFD_CLOEXEC);
+
+  if(ring->eventfd == -1)
+  {
+    ring_free(ring);
+
+    return 2;
+  }
+
+  return 0;
+}
+
+/*
+ * Free the descriptors, the pooled buffers and the eventfd of ring
+ */
+void ring_free(ring_t* ring)
+{
+  free(ring->slots);
+  free(ring->chunks);
+  free(ring->memory);
+
+  if(ring->eventfd != -1) close(ring->eventfd);
+
+  ring->slots   = NULL;
+  ring->chunks  = NULL;
+  ring->memory  = NULL;
+  ring->eventfd = -1;
+}
+
+/*
+ * Switch to the next chunk that the consumer is done with
+ *
+ * The chunk being filled holds an extra reference,
+ * so that it is not reused while lines are added to it
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 2 | Every chunk is still in use
+ */
+static int ring_chunk_next(ring_t* ring)
+{
+  for(uint32_t step = 1; step < ring->chunk_count; step++)
+  {
+    uint32_t chunk = (ring->chunk + step) % ring->chunk_count;
+
+    if(__atomic_load_n(&ring->chunks[chunk].pending, __ATOMIC_ACQUIRE) != 0) continue;
+
+    __atomic_store_n(&ring->chunks[chunk].pending, 1, __ATOMIC_RELAXED);
+
+    // Let go of the reference of the previous chunk
+    __atomic_sub_fetch(&ring->chunks[ring->chunk].pending, 1, __ATOMIC_RELEASE);
+
+    ring->chunk  = chunk;
+    ring->offset = 0;
+
+    return 0;
+  }
+
+  return 2;
+}
+
+/*
+ * Check if a line of length would fit, without taking the room (producer)
+ *
+ * RETURN (bool room)
+ * - false | The ring or the pooled buffers are full
+ */
+bool ring_room(ring_t* ring, size_t length)
+{
+  if(length > ring->chunk_size) return false;
+
+  if(ring->tail - ring->head_cache > ring->mask)
+  {
+    ring->head_cache = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    if(ring->tail - ring->head_cache > ring->mask) return false;
+  }
+
+  if(ring->offset + length <= ring->chunk_size) return true;
+
+  for(uint32_t step = 1; step < ring->chunk_count; step++)
+  {
+    uint32_t chunk = (ring->chunk + step) % ring->chunk_count;
+
+    if(__atomic_load_n(&ring->chunks[chunk].pending, __ATOMIC_ACQUIRE) == 0) return true;
+  }
+
+  return false;
+}
+
+/*
+ * Copy line into the pool and publish its descriptor (producer)
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | The ring is full
+ * - 2 | The pooled buffers are full, or the line is larger than a chunk
+ */
+int ring_push(ring_t* ring, const char* line, size_t length)
+{
+  if(length > ring->chunk_size) return 2;
+
+  size_t tail = ring->tail;
+
+  if(tail - ring->head_cache > ring->mask)
+  {
+    ring->head_cache = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    if(tail - ring->head_cache > ring->mask) return 1;
+  }
+
+  if(ring->offset + length > ring->chunk_size)
+  {
+    if(ring_chunk_next(ring) != 0) return 2;
+  }
+
+  char* copy = ring->memory + (size_t) ring->chunk * ring->chunk_size + ring->offset;
+
+  memcpy(copy, line, length);
+
+  ring->offset += length;
+
+  __atomic_add_fetch(&ring->chunks[ring->chunk].pending, 1, __ATOMIC_RELAXED);
+
+  ring->slots[tail & ring->mask] = (ring_line_t) { copy, length, ring->chunk };
+
+  __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+  // The consumer might have checked the tail just before it was stored
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+  // Only wake up the consumer if the ring was empty
+  if(__atomic_load_n(&ring->head, __ATOMIC_RELAXED) == tail)
+  {
+    uint64_t value = 1;
+
+    if(write(ring->eventfd, &value, sizeof(value)) == sizeof(value)) ring->wakeups++;
+  }
+
+  return 0;
+}
+
+/*
+ * Take the next descriptor (consumer)
+ *
+ * The line stays valid until it is done
+ *
+ * RETURN (bool taken)
+ * - false | The ring is empty
+ */
+bool ring_pop(ring_t* ring, ring_line_t* line)
+{
+  size_t head = ring->head;
+
+  if(head == ring->tail_cache)
+  {
+    ring->tail_cache = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if(head == ring->tail_cache) return false;
+  }
+
+  *line = ring->slots[head & ring->mask];
+
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+/*
+ * Give the buffer of a taken line back to the producer (consumer)
+ */
+void ring_done(ring_t* ring, ring_line_t* line)
+{
+  __atomic_sub_fetch(&ring->chunks[line->chunk].pending, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Wait until the ring is not empty (consumer)
+ *
+ * RETURN (int status)
+ * -  0 | The ring is not empty
+ * - -1 | Failed to read eventfd
+ */
+int ring_wait(ring_t* ring)
+{
+  while(true)
+  {
+    // Pairs with the fence of the producer, after it stored the tail
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    ring->tail_cache = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if(ring->head != ring->tail_cache) return 0;
+
+    uint64_t value;
+
+    if(read(ring->eventfd, &value, sizeof(value)) == -1 && errno != EINTR) return -1;
+  }
+}
@@ -0,0 +1,88 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/eventfd.h>
+
+#define RING_CACHE_LINE 64
+
+#define RING_ALIGNED __attribute__((aligned(RING_CACHE_LINE)))
+
+/*
+ * Descriptor of a line in a pooled buffer
+ */
+typedef struct
+{
+  const char* line;
+  uint32_t    length;
+  uint32_t    chunk;  // Index of the pooled buffer
+} ring_line_t;
+
+/*
+ * Pooled buffer, that the producer reuses when every line in it is done
+ */
+typedef struct
+{
+  uint32_t pending RING_ALIGNED; // Lines not yet done by the consumer
+} ring_chunk_t;
+
+/*
+ * Lock-free single-producer single-consumer ring of line descriptors
+ *
+ * The producer copies lines into pooled buffers and publishes their
+ * descriptors with release stores, and the consumer takes them with
+ * acquire loads. The indexes are on separate cache lines, and each side
+ * caches the index of the other side, to avoid sharing cache lines.
+ *
+ * The eventfd is only written when the ring goes from empty to non-empty,
+ * so a busy consumer is never woken up by system calls
+ */
+typedef struct
+{
+  size_t        head RING_ALIGNED;       // Next descriptor to take (consumer)
+  size_t        tail_cache;              // Last seen tail (consumer)
+
+  size_t        tail RING_ALIGNED;       // Next descriptor to publish (producer)
+  size_t        head_cache;              // Last seen head (producer)
+  uint32_t      chunk;                   // Chunk being filled (producer)
+  size_t        offset;                  // Offset in the chunk (producer)
+  size_t        wakeups;                 // Number of eventfd writes (producer)
+
+  ring_line_t*  slots RING_ALIGNED;
+  size_t        mask;
+  char*         memory;                  // Memory of the pooled buffers
+  size_t        chunk_size;
+  uint32_t      chunk_count;
+  ring_chunk_t* chunks;
+  int           eventfd;
+} ring_t;
+
+extern int  ring_init(ring_t* ring, size_t capacity, size_t chunk_size, uint32_t chunk_count);
+
+extern void ring_free(ring_t* ring);
+
+
+extern bool ring_room(ring_t* ring, size_t length);
+
+extern int  ring_push(ring_t* ring, const char* line, size_t length);
+
+extern bool ring_pop(ring_t* ring, ring_line_t* line);
+
+extern void ring_done(ring_t* ring, ring_line_t* line);
+
+extern int  ring_wait(ring_t* ring);
+
+#endif // RING_H
@@ -0,0 +1,212 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "sched.h"
+
+/*
+ * Double the capacity of deque, moving the jobs to the start
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate jobs
+ */
+static int deque_grow(deque_t* deque)
+{
+  size_t capacity = (deque->capacity > 0) ? deque->capacity * 2 : SCHED_DEQUE_SIZE;
+
+  void** jobs = malloc(capacity * sizeof(void*));
+
+  if(!jobs) return 1;
+
+  for(size_t index = 0; index < deque->count; index++)
+  {
+    jobs[index] = deque->jobs[(deque->head + index) % deque->capacity];
+  }
+
+  free(deque->jobs);
+
+  deque->jobs     = jobs;
+  deque->capacity = capacity;
+  deque->head     = 0;
+
+  return 0;
+}
+
+/*
+ * Add job to the back of deque
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to grow deque
+ */
+static int deque_push(deque_t* deque, void* job)
+{
+  if(deque->count == deque->capacity && deque_grow(deque) != 0) return 1;
+
+  deque->jobs[(deque->head + deque->count) % deque->capacity] = job;
+
+  deque->count++;
+
+  return 0;
+}
+
+/*
+ * Take the job at the front of deque, which is the oldest
+ */
+static void* deque_front(deque_t* deque)
+{
+  if(deque->count == 0) return NULL;
+
+  void* job = deque->jobs[deque->head];
+
+  deque->head = (deque->head + 1) % deque->capacity;
+
+  deque->count--;
+
+  return job;
+}
+
+/*
+ * Take the job at the back of deque, which is the newest
+ */
+static void* deque_back(deque_t* deque)
+{
+  if(deque->count == 0) return NULL;
+
+  deque->count--;
+
+  return deque->jobs[(deque->head + deque->count) % deque->capacity];
+}
+
+/*
+ * Initialize scheduler with a deque for every worker
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate workers
+ */
+int sched_init(sched_t* sched, size_t count)
+{
+  *sched = (sched_t) { .count = count };
+
+  sched->workers = calloc(count, sizeof(sched_worker_t));
+
+  if(!sched->workers)
+  {
+    sched->count = 0;
+
+    return 1;
+  }
+
+  return 0;
+}
+
+/*
+ * Free the scheduler, and the jobs that are left in it
+ */
+void sched_free(sched_t* sched)
+{
+  for(size_t index = 0; index < sched->count; index++)
+  {
+    deque_t* deque = &sched->workers[index].deque;
+
+    void* job;
+
+    while((job = deque_front(deque))) free(job);
+
+    free(deque->jobs);
+  }
+
+  free(sched->workers);
+
+  *sched = (sched_t) { 0 };
+}
+
+/*
+ * Add job to the deque of the next worker
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to grow deque
+ */
+int sched_push(sched_t* sched, void* job)
+{
+  if(deque_push(&sched->workers[sched->next].deque, job) != 0) return 1;
+
+  sched->next = (sched->next + 1) % sched->count;
+
+  sched->pending++;
+
+  return 0;
+}
+
+/*
+ * Take the next job of worker, stealing one if its own deque is empty
+ *
+ * RETURN (void* job)
+ * - NULL | Every deque is empty
+ */
+void* sched_take(sched_t* sched, size_t worker)
+{
+  sched_worker_t* self = &sched->workers[worker];
+
+  void* job = deque_front(&self->deque);
+
+  if(!job)
+  {
+    sched_worker_t* victim = NULL;
+
+    for(size_t index = 0; index < sched->count; index++)
+    {
+      sched_worker_t* other = &sched->workers[index];
+
+      if(!victim || other->deque.count > victim->deque.count) victim = other;
+    }
+
+    if(victim && (job = deque_back(&victim->deque))) self->stolen++;
+  }
+
+  if(job) sched->pending--;
+
+  return job;
+}
+
+/*
+ * The worker has started on a job
+ */
+void sched_start(sched_t* sched, size_t worker, uint64_t now)
+{
+  sched->workers[worker].since = now;
+}
+
+/*
+ * The worker has finished its job
+ */
+void sched_finish(sched_t* sched, size_t worker, uint64_t now)
+{
+  sched_worker_t* self = &sched->workers[worker];
+
+  if(self->since > 0) self->busy += now - self->since;
+
+  self->since = 0;
+
+  self->done++;
+}
+
+/*
+ * Start the counters of every worker over
+ */
+void sched_reset(sched_t* sched)
+{
+  for(size_t index = 0; index < sched->count; index++)
+  {
+    sched_worker_t* self = &sched->workers[index];
+
+    self->done   = 0;
+    self->stolen = 0;
+    self->busy   = 0;
+  }
+}
@@ -0,0 +1,73 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCHED_DEQUE_SIZE 16
+
+/*
+ * Double ended queue of jobs, in a ring that grows when full
+ */
+typedef struct
+{
+  void** jobs;
+  size_t head;
+  size_t count;
+  size_t capacity;
+} deque_t;
+
+/*
+ * Jobs of one worker, and the time it has spent on them
+ */
+typedef struct
+{
+  deque_t  deque;
+  size_t   done;   // Number of finished jobs
+  size_t   stolen; // Number of jobs taken from other workers
+  uint64_t busy;   // Nanoseconds spent on finished jobs
+  uint64_t since;  // Start of the current job (0 if the worker has none)
+} sched_worker_t;
+
+/*
+ * Work stealing scheduler
+ *
+ * Jobs are spread over the deques of the workers, round robin.
+ * A worker takes jobs from the front of its own deque, and when it is
+ * empty, steals from the back of the longest deque, so that uneven jobs
+ * don't leave workers idle while others still have a backlog
+ */
+typedef struct
+{
+  sched_worker_t* workers;
+  size_t          count;
+  size_t          next;    // Worker of the next pushed job
+  size_t          pending; // Number of jobs in every deque
+} sched_t;
+
+extern int   sched_init(sched_t* sched, size_t count);
+
+extern void  sched_free(sched_t* sched);
+
+
+extern int   sched_push(sched_t* sched, void* job);
+
+extern void* sched_take(sched_t* sched, size_t worker);
+
+
+extern void  sched_start(sched_t* sched, size_t worker, uint64_t now);
+
+extern void  sched_finish(sched_t* sched, size_t worker, uint64_t now);
+
+extern void  sched_reset(sched_t* sched);
+
+#endif // SCHED_H
@@ -0,0 +1,1243 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "session.h"
+#include "metrics.h"
+
+/*
+ * Get the connection that the output of session is written to
+ *
+ * Logical sessions write to the connection of their carrier
+ */
+static conn_t* session_conn(session_t* session)
+{
+  return session->carrier ? &session->carrier->conn : &session->conn;
+}
+
+/*
+ * Queue the prefix of a line for the client
+ *
+ * Logical sessions prefix the line with their id,
+ * and in the framing mode, the line is sent as a frame
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to queue prefix
+ */
+static int session_prefix(session_t* session, size_t length)
+{
+  conn_t* conn = session_conn(session);
+
+  if(session->framed)
+  {
+    char header[FRAME_HEADER];
+
+    frame_header(header, FRAME_OUTPUT, length);
+
+    return conn_write(conn, header, FRAME_HEADER);
+  }
+
+  return conn_write(conn, session->tag, session->tag_length);
+}
+
+/*
+ * Queue output for the client, consisting of whole lines
+ *
+ * The lines of a logical session are prefixed with its id,
+ * and in the framing mode, every line is sent as a frame without newline.
+ * Unless copy is set, the data has to stay valid until the session is flushed
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to queue output
+ */
+static int session_send(session_t* session, const char* data, size_t length, bool copy)
+{
+  conn_t* conn = session_conn(session);
+
+  // The workers of a batch only send the results of their positions
+  if(session->carrier && session->carrier->batch)
+  {
+    return batch_output(session->carrier->batch, session, data, length);
+  }
+
+  if(!session->carrier && !session->framed)
+  {
+    return copy ? conn_write(conn, data, length) : conn_line(conn, data, length);
+  }
+
+  const char* end = data + length;
+
+  while(data < end)
+  {
+    const char* newline = memchr(data, '\n', end - data);
+
+    size_t line_length = newline ? (size_t) (newline + 1 - data) : (size_t) (end - data);
+
+    size_t sent_length = (session->framed && newline) ? line_length - 1 : line_length;
+
+    if(session_prefix(session, sent_length) == -1) return -1;
+
+    int status = copy ? conn_write(conn, data, sent_length) : conn_line(conn, data, sent_length);
+
+    if(status == -1) return -1;
+
+    data += line_length;
+  }
+
+  return 0;
+}
+
+/*
+ * Answer uci and isready from memory, while the engine has nothing to say
+ *
+ * The engine has answered everything before it was given to the session,
+ * so until the client sends something else, the answers are known
+ *
+ * RETURN (bool answered)
+ */
+static bool session_answer(session_t* session, const char* line)
+{
+  engine_t* engine = session->engine;
+
+  if(!session->synced) return false;
+
+  if(uci_command(line, "isready"))
+  {
+    session_send(session, "readyok\n", 8, false);
+  }
+  else if(uci_command(line, "uci") && engine->uci.known)
+  {
+    session_send(session, engine->uci.lines, engine->uci.length, false);
+
+    session_send(session, "uciok\n", 6, false);
+  }
+  else return false;
+
+  session_respond(session);
+
+  session->answered++;
+
+  return true;
+}
+
+/*
+ * Skip setoption commands for values the engine already has
+ *
+ * The values that are sent are remembered, and restored to
+ * their defaults when the engine is reset for the next client
+ *
+ * RETURN (bool skipped)
+ */
+static bool session_option_skip(session_t* session, const char* line, size_t length)
+{
+  const char* name;
+  const char* value;
+  size_t name_length, value_length;
+
+  if(uci_setoption_parse(line, length, &name, &name_length, &value, &value_length) != 0)
+  {
+    return false;
+  }
+
+  uci_option_t* option = uci_option_find(&session->engine->uci, name, name_length);
+
+  if(!option) return false;
+
+  if(uci_option_equal(option, value, value_length))
+  {
+    session->skipped++;
+
+    return true;
+  }
+
+  if(uci_option_set(option, value, value_length) != 0)
+  {
+    if(session->debug) error_print("Failed to remember engine option");
+  }
+
+  return false;
+}
+
+/*
+ * Check if line is a go command
+ */
+static bool session_go(const char* line)
+{
+  return strncmp(line, "go", 2) == 0 && (line[2] == '\0' || isspace((unsigned char) line[2]));
+}
+
+/*
+ * Answer a search with the result from the cache or the store
+ *
+ * Results found in the store are put in the cache
+ *
+ * RETURN (bool found)
+ */
+static bool session_lookup(session_t* session, const char* key, size_t key_length)
+{
+  cache_entry_t* entry = session->cache ? cache_get(session->cache, key, key_length) : NULL;
+
+  if(entry)
+  {
+    if(session->debug) info_print("Answering search from cache");
+
+    session_send(session, entry->value, entry->value_length, true);
+
+    return true;
+  }
+
+  if(!session->store) return false;
+
+  char result[STORE_RESULT];
+
+  size_t length = store_get(session->store, key, key_length, result);
+
+  if(length == 0) return false;
+
+  if(session->debug) info_print("Answering search from store");
+
+  session_send(session, result, length, true);
+
+  if(session->cache) cache_put(session->cache, key, key_length, result, length);
+
+  return true;
+}
+
+/*
+ * Keep the result of a completed search in the cache and the store
+ */
+static void session_result(session_t* session)
+{
+  analysis_t* analysis = &session->analysis;
+
+  if(session->cache && cache_put(session->cache, analysis->key, analysis->key_length,
+    analysis->result, analysis->result_length) == 2)
+  {
+    if(session->debug) error_print("Failed to cache search result");
+  }
+
+  // Results that don't fit in a record are only cached
+  if(session->store && store_put(session->store, analysis->key, analysis->key_length,
+    analysis->result, analysis->result_length) >= 2)
+  {
+    if(session->debug) error_print("Failed to store search result");
+  }
+}
+
+/*
+ * Follow the position and searches of the client,
+ * and answer searches that have been cached
+ *
+ * RETURN (bool answered)
+ */
+static bool session_analyze(session_t* session, const char* line, size_t length)
+{
+  analysis_t* analysis = &session->analysis;
+
+  if(!session->cache && !session->store) return false;
+
+  if(strncmp(line, "position ", 9) == 0)
+  {
+    if(analysis_position(analysis, line, length) != 0)
+    {
+      if(session->debug) error_print("Failed to remember position");
+    }
+
+    return false;
+  }
+
+  if(uci_command(line, "stop"))
+  {
+    analysis->stopped = true;
+
+    return false;
+  }
+
+  if(!session_go(line)) return false;
+
+  size_t key_length = 0;
+
+  char* key = NULL;
+
+  if(!analysis->searching)
+  {
+    key = analysis_key(analysis, line, length, &session->engine->uci, &key_length);
+  }
+
+  if(key && session_lookup(session, key, key_length))
+  {
+    session_respond(session);
+
+    free(key);
+
+    return true;
+  }
+
+  analysis_start(analysis, key, key_length);
+
+  return false;
+}
+
+/*
+ * Follow the position of the client, and answer searches
+ * of book positions with a book move, without the engine
+ *
+ * Searches that only end when the client says so, or that are
+ * restricted to some moves, are left to the engine
+ *
+ * RETURN (bool answered)
+ */
+static bool session_book(session_t* session, const char* line, size_t length)
+{
+  if(!session->book) return false;
+
+  if(strncmp(line, "position ", 9) == 0)
+  {
+    // A position that can't be followed is not looked up
+    board_position(&session->board, line, length);
+
+    return false;
+  }
+
+  if(!session_go(line) || !session->board.valid) return false;
+
+  if(analysis_find(line, length, "infinite") || analysis_find(line, length, "ponder") ||
+     analysis_find(line, length, "searchmoves"))
+  {
+    return false;
+  }
+
+  char move[6];
+
+  if(!book_probe(session->book, &session->board, move)) return false;
+
+  if(session->debug) info_print("Answering search from book");
+
+  char answer[16];
+
+  int answer_length = sprintf(answer, "bestmove %s\n", move);
+
+  session_send(session, answer, answer_length, true);
+
+  session_respond(session);
+
+  return true;
+}
+
+/*
+ * Handle a command from the client, after the session has got an engine
+ *
+ * Commands with known answers are answered by the node itself,
+ * and the rest is relayed to the engine without copying,
+ * until the engine is flushed
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | The session has been closed, or the engine can't be written to
+ */
+static int session_handle(session_t* session, const char* line, size_t length)
+{
+  engine_t* engine = session->engine;
+
+  if(session->debug) debug_print(stdout, "client -> engine", "%s", line);
+
+  if(session_answer(session, line)) return 0;
+
+  if(session_option_skip(session, line, length)) return 0;
+
+  if(session_book(session, line, length)) return 0;
+
+  if(session_analyze(session, line, length)) return 0;
+
+  if(strncmp(line, "quit", 4) == 0)
+  {
+    // The commands and answers before quit might still be pending
+    conn_flush(&engine->conn);
+
+    session_flush(session);
+
+    session_close(session);
+
+    return 1;
+  }
+
+  bool uci     = uci_command(line, "uci");
+  bool isready = uci_command(line, "isready");
+
+  // The answer has to be counted, so that a reset can skip it, which spliced output can't be
+  if((uci || isready) && engine->conn.target) conn_splice(&engine->conn, NULL);
+
+  if(conn_line(&engine->conn, line, length) == -1) return 1;
+
+  // Framed commands, and a last line at end of file, have no newline
+  if(line[length - 1] != '\n' && conn_line(&engine->conn, "\n", 1) == -1) return 1;
+
+  if(uci)     engine->uci_due++;
+  if(isready) engine->isready_due++;
+
+  session->synced = false;
+
+  // The search is timed until its first info line and its bestmove
+  if(session_go(line))
+  {
+    session->go_time = timing_now();
+    session->go_info = false;
+  }
+
+  session->stdout_stats.lines++;
+  session->stdout_stats.bytes += length;
+
+  METRICS_ADD(metrics.to_engine.lines, 1);
+  METRICS_ADD(metrics.to_engine.bytes, length);
+
+  return 0;
+}
+
+/*
+ * Handle a command that has just been received from the client
+ *
+ * RETURN (same as session_handle)
+ */
+int session_command(session_t* session, const char* line, size_t length)
+{
+  if(session->trace) trace_record(session->trace, session->trace_id, TRACE_CLIENT, line, length);
+
+  return session_handle(session, line, length);
+}
+
+/*
+ * Keep a copy of a command, until the session has got an engine
+ *
+ * No more than the reader of a client holds is kept, so that a client
+ * can't use up the memory while its session is waiting
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate memory, or too much is queued
+ */
+int session_queue(session_t* session, const char* line, size_t length)
+{
+  if(session->trace) trace_record(session->trace, session->trace_id, TRACE_CLIENT, line, length);
+
+  // The commands are null terminated, like the lines of the reader
+  size_t needed = session->pending_length + length + 1;
+
+  if(needed > READER_MAX_SIZE) return 1;
+
+  if(needed > session->pending_size)
+  {
+    size_t size = (session->pending_size > 0) ? session->pending_size : 256;
+
+    while(size < needed) size *= 2;
+
+    char* pending = realloc(session->pending, size);
+
+    if(!pending) return 1;
+
+    session->pending      = pending;
+    session->pending_size = size;
+  }
+
+  memcpy(session->pending + session->pending_length, line, length);
+
+  session->pending[needed - 1] = '\0';
+
+  session->pending_length = needed;
+
+  return 0;
+}
+
+/*
+ * Drop the queued commands, once they have been handled or the session
+ * has been closed, and let the carrier of a logical session know
+ */
+static void session_unqueue(session_t* session)
+{
+  if(session->carrier && session->carrier->mux)
+  {
+    mux_unqueue(session->carrier->mux, session->pending_length);
+  }
+
+  session->pending_length = 0;
+}
+
+/*
+ * Handle the commands that were queued before the session got an engine
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | The session has been closed, or the engine can't be written to
+ */
+static int session_dequeue(session_t* session)
+{
+  size_t offset = 0;
+
+  while(offset < session->pending_length)
+  {
+    char* line = session->pending + offset;
+
+    size_t length = strlen(line);
+
+    offset += length + 1;
+
+    // The commands were recorded when they were queued
+    if(session_handle(session, line, length) != 0) return 1;
+  }
+
+  session_unqueue(session);
+
+  return 0;
+}
+
+/*
+ * Give the engine of session back, to be reset for the next client
+ */
+static void session_detach(session_t* session)
+{
+  engine_t* engine = session->engine;
+
+  if(!engine) return;
+
+  engine->session = NULL;
+
+  session->engine = NULL;
+
+  if(engine->state != ENGINE_STOPPED) engine_reset(engine);
+}
+
+/*
+ * Let the client multiplex logical sessions over its connection
+ *
+ * The carrier session itself doesn't need an engine
+ */
+static void session_multiplex(session_t* session)
+{
+  session->mux = mux_create(session, session->sessions);
+
+  if(!session->mux)
+  {
+    if(session->debug) error_print("Failed to multiplex client (%d)", session->sockfd);
+
+    session_close(session);
+
+    return;
+  }
+
+  if(session->debug) info_print("Client is multiplexing sessions (%d)", session->sockfd);
+
+  session_detach(session);
+
+  if(session->multiplex) session->multiplex(session);
+
+  // The lines after mux are already for logical sessions
+  mux_input(session->mux);
+}
+
+/*
+ * Let the client analyze a batch of positions, with logical sessions
+ *
+ * The client can ask for fewer positions at once than the node allows
+ */
+static void session_batch(session_t* session, const char* line)
+{
+  long concurrency = atol(line + 5);
+
+  if(concurrency <= 0 || (size_t) concurrency > session->concurrency)
+  {
+    concurrency = session->concurrency;
+  }
+
+  session->batch = batch_create(session, (concurrency > 0) ? concurrency : 1);
+
+  if(!session->batch)
+  {
+    if(session->debug) error_print("Failed to create batch of client (%d)", session->sockfd);
+
+    session_close(session);
+
+    return;
+  }
+
+  if(session->debug) info_print("Client is analyzing a batch (%d)", session->sockfd);
+
+  session_detach(session);
+
+  if(session->multiplex) session->multiplex(session);
+
+  // The lines after batch are already positions
+  batch_input(session->batch);
+}
+
+/*
+ * Splice the engine output to the client, instead of reading it
+ *
+ * The debug echo needs the lines, and framed output has to be framed,
+ * so splice is only used for plain text clients, when lines are not logged.
+ * If the log level is raised later, the spliced lines are not logged
+ */
+static void session_splice(session_t* session)
+{
+  if(!session->splice || log_enabled(LOG_DEBUG) || session->framed) return;
+
+  if(conn_splice(&session->engine->conn, &session->conn) != 0)
+  {
+    if(session->debug) error_print("Failed to splice engine to client");
+  }
+}
+
+/*
+ * Lower the priority class of the client, from a priority line
+ * before its first line. The class is given by the node,
+ * so a client can't raise it
+ */
+static void session_prioritize(session_t* session, const char* line)
+{
+  int priority = atoi(line + 9);
+
+  if(priority < 0) priority = 0;
+
+  if(priority < session->priority)
+  {
+    session->priority = priority;
+
+    if(session->debug) info_print("Client lowered its priority to %d (%d)", priority, session->sockfd);
+
+    if(session->prioritize) session->prioritize(session);
+  }
+  else if(session->debug && priority > session->priority)
+  {
+    info_print("Client can't raise its priority above %d (%d)", session->priority, session->sockfd);
+  }
+}
+
+/*
+ * Read the first line of the client, which tells if it multiplexes sessions,
+ * with or without load reports, analyzes a batch or uses the binary framing mode.
+ * Lines with the priority of the client may come before it
+ *
+ * Otherwise, the line is kept until the session has got an engine
+ *
+ * RETURN (int status)
+ * - 0 | The client doesn't multiplex sessions or analyze a batch
+ * - 1 | No whole line yet, the client multiplexes or analyzes a batch,
+ *       or the session has been closed
+ */
+static int session_negotiate(session_t* session)
+{
+  char* line;
+  ssize_t length;
+
+  // A client can send any number of priority lines, so they are not negotiated recursively
+  while((length = reader_take(&session->conn.reader, &line)) > 0 && strncmp(line, "priority ", 9) == 0)
+  {
+    session_prioritize(session, line);
+  }
+
+  if(length <= 0) return 1;
+
+  session->negotiated = true;
+
+  if(uci_command(line, "mux") || uci_command(line, "mux load"))
+  {
+    session->reports = uci_command(line, "mux load");
+
+    session_multiplex(session);
+
+    return 1;
+  }
+
+  if(uci_command(line, "batch") || strncmp(line, "batch ", 6) == 0)
+  {
+    session_batch(session, line);
+
+    return 1;
+  }
+
+  if(uci_command(line, "frame"))
+  {
+    if(session->debug) info_print("Client is using framing (%d)", session->sockfd);
+
+    session->framed = true;
+
+    return 0;
+  }
+
+  if(session->engine)
+  {
+    session_splice(session);
+
+    return session_command(session, line, length);
+  }
+
+  if(session_queue(session, line, length) != 0)
+  {
+    if(session->debug) error_print("Failed to queue command");
+  }
+
+  return 0;
+}
+
+/*
+ * Handle a frame from the client, after the session has got an engine
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | The session has been closed, or the engine can't be written to
+ */
+static int session_frame(session_t* session, frame_t* frame)
+{
+  if(frame->type == FRAME_COMMAND)
+  {
+    if(frame->length == 0) return 0;
+
+    if(!frame_single_line(frame->payload, frame->length))
+    {
+      if(session->debug) error_print("Command frame with a line break");
+
+      return 0;
+    }
+
+    return session_command(session, frame->payload, frame->length);
+  }
+
+  if(frame->type != FRAME_GO)
+  {
+    if(session->debug) error_print("Unknown frame type (%d)", frame->type);
+
+    return 0;
+  }
+
+  ssize_t length = frame_go(frame, &session->command, &session->command_size);
+
+  if(length == -1)
+  {
+    if(session->debug) error_print("Invalid go frame");
+
+    return 0;
+  }
+
+  engine_t* engine = session->engine;
+
+  if(session_command(session, session->command, length) != 0) return 1;
+
+  // The command buffer is reused by the next go frame, so it can't stay queued
+  conn_flush(&engine->conn);
+
+  return 0;
+}
+
+/*
+ * Communication from client to engine, in the binary framing mode
+ */
+static void session_frames(session_t* session)
+{
+  frame_t frame;
+  int status;
+
+  while((status = frame_take(&session->conn.reader, &frame)) == 0)
+  {
+    if(session_frame(session, &frame) != 0) return;
+  }
+
+  if(status >= 2)
+  {
+    if(session->debug) error_print("Failed to take frame from client (%d)", session->sockfd);
+
+    session_close(session);
+
+    return;
+  }
+
+  session_flush(session);
+
+  conn_flush(&session->engine->conn);
+}
+
+/*
+ * Communication from client to engine
+ *
+ * Until the session has an engine, the input stays in the reader,
+ * except for the first line, which tells if the client multiplexes,
+ * analyzes a batch or uses the binary framing mode
+ */
+static void session_input(conn_t* conn)
+{
+  session_t* session = conn->data;
+
+  if(session->mux)
+  {
+    mux_input(session->mux);
+
+    return;
+  }
+
+  if(session->batch)
+  {
+    batch_input(session->batch);
+
+    return;
+  }
+
+  if(!session->negotiated && session_negotiate(session) != 0) return;
+
+  engine_t* engine = session->engine;
+
+  // The input is left in the reader until the session gets an engine,
+  // and no more is read meanwhile
+  if(!engine)
+  {
+    conn_pause(conn);
+
+    return;
+  }
+
+  if(session->framed)
+  {
+    session_frames(session);
+
+    return;
+  }
+
+  char* line;
+  ssize_t length;
+
+  while((length = reader_take(&conn->reader, &line)) > 0)
+  {
+    if(session_command(session, line, length) != 0) return;
+  }
+
+  session_flush(session);
+
+  conn_flush(&engine->conn);
+}
+
+/*
+ * Hand the throttled lines to the client, in the order they were queued
+ */
+static void session_release(session_t* session)
+{
+  throttle_t* throttle = &session->throttle;
+
+  for(size_t index = 0; index < throttle->count; index++)
+  {
+    throttle_line_t* line = &throttle->lines[index];
+
+    if(session_send(session, line->line, line->length, true) == -1) break;
+
+    session->stdin_stats.lines++;
+    session->stdin_stats.bytes += line->length;
+
+    METRICS_ADD(metrics.to_client.lines, 1);
+    METRICS_ADD(metrics.to_client.bytes, line->length);
+  }
+
+  throttle_clear(throttle);
+}
+
+/*
+ * The client has caught up with the engine output
+ */
+static void session_drain(conn_t* conn)
+{
+  session_t* session = conn->data;
+
+  if(session->mux) mux_drain(session->mux);
+
+  else if(session->batch) batch_drain(session->batch);
+
+  else session_resume(session);
+}
+
+/*
+ * The client has disconnected, or can't be written to
+ */
+static void session_conn_close(conn_t* conn)
+{
+  session_close(conn->data);
+}
+
+/*
+ * Create session for accepted client socket
+ *
+ * RETURN (session_t* session)
+ * - NULL | Failed to allocate session or to open client connection
+ */
+session_t* session_create(int sockfd, bool splice, bool debug)
+{
+  session_t* session = malloc(sizeof(session_t));
+
+  if(!session) return NULL;
+
+  *session = (session_t) { .sockfd = sockfd, .splice = splice, .debug = debug };
+
+  session->accepted = timing_now();
+
+  if(conn_open(&session->conn, sockfd, sockfd, session) != 0)
+  {
+    if(debug) error_print("Failed to open client connection");
+
+    free(session);
+
+    return NULL;
+  }
+
+  session->conn.input = session_input;
+  session->conn.drain = session_drain;
+  session->conn.close = session_conn_close;
+
+  return session;
+}
+
+/*
+ * Record the lines of session in trace, from now on
+ */
+void session_trace(session_t* session, trace_t* trace)
+{
+  session->trace    = trace;
+  session->trace_id = trace_session(trace);
+
+  trace_record(trace, session->trace_id, TRACE_OPEN, "", 0);
+}
+
+/*
+ * Create a logical session, multiplexed over the connection of carrier
+ *
+ * The session shares the handlers and settings of the carrier
+ *
+ * RETURN (session_t* session)
+ * - NULL | Failed to allocate session
+ */
+session_t* session_create_logical(session_t* carrier, unsigned long id)
+{
+  session_t* session = malloc(sizeof(session_t));
+
+  if(!session) return NULL;
+
+  *session = (session_t) { .sockfd = -1, .debug = carrier->debug, .negotiated = true };
+
+  session->carrier = carrier;
+  session->id      = id;
+  session->cache   = carrier->cache;
+  session->store   = carrier->store;
+  session->book    = carrier->book;
+  session->close   = carrier->close;
+
+  session->priority = carrier->priority;
+
+  if(carrier->trace) session_trace(session, carrier->trace);
+
+  session->accepted = timing_now();
+
+  session->tag_length = sprintf(session->tag, "%lu ", id);
+
+  return session;
+}
+
+/*
+ * Free closed session
+ */
+void session_free(session_t* session)
+{
+  analysis_free(&session->analysis);
+
+  throttle_free(&session->throttle);
+
+  free(session->pending);
+
+  free(session->command);
+
+  if(session->mux) mux_free(session->mux);
+
+  if(session->batch) batch_free(session->batch);
+
+  free(session);
+}
+
+/*
+ * Let engine serve the session
+ *
+ * Input the client sent while waiting is relayed at once
+ */
+void session_attach(session_t* session, engine_t* engine)
+{
+  if(session->debug && session->carrier)
+  {
+    info_print("Attaching engine to session (%ld) of client (%d)", (long) session->id, session->carrier->sockfd);
+  }
+  else if(session->debug) info_print("Attaching engine to client (%d)", session->sockfd);
+
+  session->engine = engine;
+
+  engine_serve(engine, session);
+
+  session->synced = true;
+
+  session->engine_reads  = engine->conn.reader.reads;
+  session->engine_writes = engine->conn.writer.writes;
+
+  // Until the first line has been read, it isn't known if the output can be spliced
+  if(session->negotiated && !session->carrier) session_splice(session);
+
+  if(session->carrier && session->carrier->batch)
+  {
+    batch_attach(session->carrier->batch, session);
+  }
+
+  if(session_dequeue(session) != 0) return;
+
+  if(!session->carrier)
+  {
+    conn_resume(&session->conn);
+
+    session_input(&session->conn);
+
+    return;
+  }
+
+  session_flush(session);
+
+  conn_flush(&engine->conn);
+}
+
+/*
+ * Print the relay counters of session
+ */
+static void relay_stats_print(const char* title, relay_stats_t* stats)
+{
+  double syscalls = (stats->lines > 0) ? (double) (stats->reads + stats->writes) / stats->lines : 0;
+
+  info_print("%s: %ld lines, %ld bytes, %ld reads, %ld writes, %f syscalls per line", title,
+    (long) stats->lines, (long) stats->bytes, (long) stats->reads, (long) stats->writes, syscalls);
+}
+
+/*
+ * Collect the syscall counters of the session, before the engine is detached
+ */
+static void session_stats_collect(session_t* session)
+{
+  engine_t* engine = session->engine;
+
+  session->stdout_stats.reads  = session->conn.reader.reads;
+  session->stdin_stats.writes  = session->conn.writer.writes;
+
+  if(!engine) return;
+
+  session->stdout_stats.writes = engine->conn.writer.writes - session->engine_writes;
+  session->stdin_stats.reads   = engine->conn.reader.reads  - session->engine_reads;
+
+  if(engine->conn.target)
+  {
+    session->stdin_stats.reads += engine->conn.splicer.splices;
+    session->stdin_stats.bytes += engine->conn.splicer.bytes;
+  }
+}
+
+/*
+ * Add the syscall counters of a closed session to the metrics
+ */
+static void session_stats_publish(session_t* session)
+{
+  METRICS_ADD(metrics.to_engine.syscalls, session->stdout_stats.reads + session->stdout_stats.writes);
+  METRICS_ADD(metrics.to_engine.closed_lines, session->stdout_stats.lines);
+
+  METRICS_ADD(metrics.to_client.syscalls, session->stdin_stats.reads + session->stdin_stats.writes);
+  METRICS_ADD(metrics.to_client.closed_lines, session->stdin_stats.lines);
+}
+
+/*
+ * Close session and reset its engine for the next client
+ */
+void session_close(session_t* session)
+{
+  if(session->closed) return;
+
+  session->closed = true;
+
+  session_stats_collect(session);
+
+  session_stats_publish(session);
+
+  if(session->trace) trace_record(session->trace, session->trace_id, TRACE_CLOSE, "", 0);
+
+  if(session->debug)
+  {
+    relay_stats_print("engine -> client", &session->stdin_stats);
+
+    relay_stats_print("client -> engine", &session->stdout_stats);
+
+    if(session->response > 0)
+    {
+      info_print("accept -> first response: %f us", TIMING_MICROS(session->response));
+    }
+
+    info_print("node answers: %ld commands, %ld options skipped", session->answered, session->skipped);
+
+    info_print("throttled lines: %ld merged, %ld dropped", session->throttle.merged, session->throttle.dropped);
+  }
+
+  session_detach(session);
+
+  session_unqueue(session);
+
+  if(session->mux) mux_close(session->mux);
+
+  if(session->batch) batch_close(session->batch);
+
+  if(session->carrier && session->carrier->mux)
+  {
+    mux_remove(session->carrier->mux, session);
+  }
+  else if(session->carrier)
+  {
+    batch_remove(session->carrier->batch, session);
+  }
+  else
+  {
+    conn_close(&session->conn);
+
+    socket_close(&session->sockfd, session->debug);
+  }
+
+  if(session->close) session->close(session);
+}
+
+/*
+ * Check if the client is falling behind the engine output
+ */
+static bool session_behind(session_t* session)
+{
+  conn_t* conn = session_conn(session);
+
+  return conn->writing && conn_pending(conn) >= THROTTLE_PENDING;
+}
+
+/*
+ * Record the latency of the search in progress, at its first info line and its bestmove
+ */
+static void session_time(session_t* session, const char* line)
+{
+  if(session->go_time == 0) return;
+
+  if(!session->go_info && strncmp(line, "info", 4) == 0)
+  {
+    histogram_record(&metrics.go_info, timing_now() - session->go_time);
+
+    session->go_info = true;
+  }
+  else if(strncmp(line, "bestmove", 8) == 0)
+  {
+    histogram_record(&metrics.go_bestmove, timing_now() - session->go_time);
+
+    session->go_time = 0;
+  }
+}
+
+/*
+ * Communication from engine to client
+ *
+ * The line is queued without copying, until the session is flushed.
+ * If the client is falling behind, the line is throttled instead
+ */
+void session_output(session_t* session, const char* line, size_t length)
+{
+  if(session->debug) debug_print(stdout, "ENGINE => CLIENT", "%s\033[F", line);
+
+  session_respond(session);
+
+  session_time(session, line);
+
+  if(session->trace) trace_record(session->trace, session->trace_id, TRACE_ENGINE, line, length);
+
+  if(analysis_output(&session->analysis, line, length)) session_result(session);
+
+  // Once lines are throttled, the rest has to wait for them
+  if(session->throttle.count > 0 || session_behind(session))
+  {
+    if(throttle_push(&session->throttle, line, length) == 2)
+    {
+      if(session->debug) error_print("Failed to queue engine output");
+    }
+
+    return;
+  }
+
+  if(session_send(session, line, length, false) == -1) return;
+
+  session->stdin_stats.lines++;
+  session->stdin_stats.bytes += length;
+
+  METRICS_ADD(metrics.to_client.lines, 1);
+  METRICS_ADD(metrics.to_client.bytes, length);
+}
+
+/*
+ * Send a line from the node itself to the client, like the position
+ * of a session that is waiting for an engine
+ */
+void session_notify(session_t* session, const char* line, size_t length)
+{
+  // The workers of a batch only send the results of their positions
+  if(session->carrier && session->carrier->batch) return;
+
+  if(session_send(session, line, length, true) == 0) session_flush(session);
+}
+
+/*
+ * Measure the time from accept to the first response, if it is the first,
+ * and record it in the metrics
+ */
+void session_respond(session_t* session)
+{
+  if(session->response > 0) return;
+
+  session->response = timing_now() - session->accepted;
+
+  histogram_record(&metrics.response, session->response);
+}
+
+/*
+ * Write the engine output queued for the client
+ *
+ * If the client can't keep up, info lines are throttled. Only if the
+ * lines that are always delivered pile up, the engine output is paused
+ * until the client has caught up
+ */
+void session_flush(session_t* session)
+{
+  conn_t* conn = session_conn(session);
+
+  conn_flush(conn);
+
+  // A flush that writes everything doesn't call the drain handler,
+  // so the lines that were throttled meanwhile are released here
+  if(session->throttle.count > 0 && !conn->writing && !session->closed)
+  {
+    session_release(session);
+
+    conn_flush(conn);
+  }
+
+  if(session->throttle.bytes > THROTTLE_BYTES && session->engine)
+  {
+    conn_pause(&session->engine->conn);
+  }
+}
+
+/*
+ * Continue relaying engine output, after the client has caught up
+ */
+void session_resume(session_t* session)
+{
+  if(session->throttle.count > 0)
+  {
+    session_release(session);
+
+    session_flush(session);
+  }
+
+  if(session->engine) conn_resume(&session->engine->conn);
+}
@@ -0,0 +1,156 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "debug.h"
+#include "socket.h"
+#include "conn.h"
+#include "engine.h"
+#include "timing.h"
+#include "cache.h"
+#include "store.h"
+#include "throttle.h"
+#include "mux.h"
+#include "frame.h"
+#include "batch.h"
+#include "analysis.h"
+#include "book.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+
+/*
+ * Relay counters of a client session, in one direction
+ */
+typedef struct
+{
+  size_t lines;
+  size_t bytes;
+  size_t reads;  // Number of read syscalls
+  size_t writes; // Number of write syscalls
+} relay_stats_t;
+
+typedef struct session_t session_t;
+
+typedef void (*session_handler_t)(session_t* session);
+
+/*
+ * Client session, relaying between a client socket and an engine
+ *
+ * A logical session has no socket of its own, but is multiplexed
+ * over the connection of a carrier session, see mux_t.
+ * A client that sends frame as its first line uses the binary
+ * framing mode after it instead, see frame_t, and a client that
+ * sends batch analyzes positions with logical sessions, see batch_t
+ *
+ * A client that sends mux load instead, like a proxy, is also sent a line
+ * load <busy engines> <waiting sessions> <engines> when the load of the node changes
+ *
+ * A client is given a free engine before the clients of lower priority
+ * classes, and so are its logical sessions. The class is given by the
+ * node, from the address of the client, and the client can only lower it,
+ * by sending priority <class> before its first line. While waiting,
+ * it is sent info string queue position <n>
+ *
+ * The handlers are called when:
+ * - close      | The session has been closed
+ * - multiplex  | The client has started multiplexing logical sessions, or a batch
+ * - open       | A logical session has been opened
+ * - prioritize | The client has changed its priority class
+ *
+ * With a cache or a store, searches with repeatable limits are answered from them,
+ * and results are only stored when the engine output is not spliced.
+ * With a book, searches of book positions are answered with a book move
+ */
+struct session_t
+{
+  conn_t            conn;
+  int               sockfd;
+  engine_t*         engine;
+  bool              closed;
+  bool              splice;        // Splice engine output to the client
+  bool              debug;
+  relay_stats_t     stdin_stats;   // Engine to client
+  relay_stats_t     stdout_stats;  // Client to engine
+  size_t            engine_reads;  // Engine counters when attached
+  size_t            engine_writes;
+  uint64_t          accepted;      // When the client was accepted
+  uint64_t          response;      // Accept to first response, 0 until then
+  int               priority;      // Priority class while waiting for an engine
+  uint64_t          queued;        // When the session started waiting for an engine
+  size_t            position;      // Position in the queue last sent to the client, 0 if none
+  bool              synced;        // Nothing has been sent since the engine was ready
+  uint64_t          go_time;       // When the search in progress was started, 0 if none
+  bool              go_info;       // The search in progress has sent an info line
+  size_t            answered;      // Commands answered by the node from memory
+  size_t            skipped;       // Options the engine already had
+  cache_t*          cache;         // Analysis cache (NULL if disabled)
+  store_t*          store;         // Persistent analysis store (NULL if disabled)
+  book_t*           book;          // Opening book (NULL if disabled)
+  board_t           board;         // Position of the client, followed for the book
+  trace_t*          trace;         // Recording of the relayed lines (NULL if disabled)
+  uint32_t          trace_id;      // Id of the session in the recording
+  analysis_t        analysis;
+  throttle_t        throttle;      // Engine output waiting for a slow client
+  bool              negotiated;    // The first line has been read
+  bool              framed;        // The client uses the binary framing mode
+  char*             command;       // Command decoded from a pre-tokenized frame
+  size_t            command_size;
+  char*             pending;       // Commands received before the engine, null separated
+  size_t            pending_length;
+  size_t            pending_size;
+  mux_t*            mux;           // Logical sessions, if the client multiplexes
+  bool              reports;       // The client is sent load reports, see mux load
+  batch_t*          batch;         // Positions to analyze, if the client sent batch
+  size_t            concurrency;   // Most positions a batch analyzes at once
+  size_t            sessions;      // Most logical sessions a multiplexing client has open
+  session_t*        carrier;       // Carrier of a logical session
+  unsigned long     id;            // Id of a logical session
+  char              tag[24];       // Prefix of the output lines of a logical session
+  size_t            tag_length;
+  session_t*        sibling;       // Next logical session in the same bucket
+  session_handler_t close;
+  session_handler_t multiplex;
+  session_handler_t open;
+  session_handler_t prioritize;
+  session_t*        next;
+};
+
+extern session_t* session_create(int sockfd, bool splice, bool debug);
+
+extern session_t* session_create_logical(session_t* carrier, unsigned long id);
+
+extern void       session_free(session_t* session);
+
+
+extern void       session_attach(session_t* session, engine_t* engine);
+
+extern void       session_close(session_t* session);
+
+
+extern int        session_command(session_t* session, const char* line, size_t length);
+
+extern int        session_queue(session_t* session, const char* line, size_t length);
+
+extern void       session_trace(session_t* session, trace_t* trace);
+
+
+extern void       session_output(session_t* session, const char* line, size_t length);
+
+extern void       session_notify(session_t* session, const char* line, size_t length);
+
+extern void       session_flush(session_t* session);
+
+extern void       session_respond(session_t* session);
+
+extern void       session_resume(session_t* session);
+
+#endif // SESSION_H
@@ -1,7 +1,7 @@
 /*
  * Written by Hampus Fridholm
  *
- * Last updated: 2024-09-06
+ * Last updated: 2026-10-17
  */
 
 #include "socket.h"
@@ -108,20 +108,87 @@ static int socket_create(bool debug)
   return sockfd;
 }
 
+/*
+ * Let the address be bound again, while connections of
+ * a previous node on the same port are still closing
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to set socket option
+ */
+static int socket_reuseaddr(int sockfd, bool debug)
+{
+  int value = 1;
+
+  if(setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value)) == -1)
+  {
+    if(debug) error_print("Failed to reuse address: %s", strerror(errno));
+
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * Let several sockets bind to the same address and port,
+ * with the kernel spreading the clients over them
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to set socket option
+ */
+static int socket_reuseport(int sockfd, bool debug)
+{
+  int value = 1;
+
+  if(setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &value, sizeof(value)) == -1)
+  {
+    if(debug) error_print("Failed to reuse port: %s", strerror(errno));
+
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * Send small writes right away, instead of waiting for the
+ * acknowledgement of the previous write (Nagle's algorithm)
+ *
+ * Lines are written as soon as they are complete, so waiting
+ * only delays them, by as much as the delayed acknowledgement
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to set socket option
+ */
+int socket_nodelay(int sockfd)
+{
+  int value = 1;
+
+  return setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+}
+
 /*
  * Create a server socket, bind it and start listening for clients
  *
+ * PARAMS
+ * - int  backlog   | Most clients waiting to be accepted
+ * - bool reuseport | Share the port with other sockets
+ *
  * RETURN (int servfd)
  * - >=0 | Success
  * -  -1 | Failed to create server socket
  */
-int server_socket_create(const char* address, int port, bool debug)
+int server_socket_create(const char* address, int port, int backlog, bool reuseport, bool debug)
 {
   int servfd = socket_create(debug);
 
   if(servfd == -1) return -1;
 
-  if(socket_bind(servfd, address, port, debug) == -1 || socket_listen(servfd, 1, debug) == -1)
+  if(socket_reuseaddr(servfd, debug) == -1 || (reuseport && socket_reuseport(servfd, debug) == -1) ||
+     socket_bind(servfd, address, port, debug) == -1 || socket_listen(servfd, backlog, debug) == -1)
   {
     socket_close(&servfd, debug);
 
@@ -161,93 +228,154 @@ int socket_accept(int servfd, const char* address, int port, bool debug)
 }
 
 /*
- * close, but with pointer to file descriptor, and with debug messages
+ * Connect to a server, with debug messages
  *
- * Note: If no open socket is supplied, nothing is done
+ * RETURN (int sockfd)
+ * - >=0 | Success
+ * -  -1 | Failed to create socket or to connect
+ */
+int socket_connect(const char* address, int port, bool debug)
+{
+  int sockfd = socket_create(debug);
+
+  if(sockfd == -1) return -1;
+
+  struct sockaddr_in addr = sockaddr_create(sockfd, address, port, debug);
+
+  if(debug) info_print("Connecting socket (%s:%d)", address, port);
+
+  if(connect(sockfd, (struct sockaddr*) &addr, sizeof(addr)) == -1)
+  {
+    if(debug) error_print("Failed to connect socket (%s:%d): %s", address, port, strerror(errno));
+
+    socket_close(&sockfd, debug);
+
+    return -1;
+  }
+
+  if(debug) info_print("Connected socket (%d)", sockfd);
+
+  socket_nodelay(sockfd);
+
+  return sockfd;
+}
+
+/*
+ * Start connecting to a server, without waiting for the connection
+ *
+ * The socket becomes writable when the connection has been made,
+ * or has failed, which socket_connect_end tells
+ *
+ * RETURN (int sockfd)
+ * - >=0 | Success, the connection is being made
+ * -  -1 | Failed to create socket or to start connecting
+ */
+int socket_connect_begin(const char* address, int port, bool debug)
+{
+  int sockfd = socket_create(debug);
+
+  if(sockfd == -1) return -1;
+
+  struct sockaddr_in addr = sockaddr_create(sockfd, address, port, debug);
+
+  if(debug) info_print("Connecting socket (%s:%d)", address, port);
+
+  if(fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL) | O_NONBLOCK) == -1 ||
+    (connect(sockfd, (struct sockaddr*) &addr, sizeof(addr)) == -1 && errno != EINPROGRESS))
+  {
+    if(debug) error_print("Failed to connect socket (%s:%d): %s", address, port, strerror(errno));
+
+    socket_close(&sockfd, debug);
+
+    return -1;
+  }
+
+  return sockfd;
+}
+
+/*
+ * Finish connecting, after the socket has become writable
+ *
+ * The socket is made blocking again, like the one of socket_connect
  *
  * RETURN (int status)
- * - 0 | Success
- * - 1 | Failed to close socket
+ * -  0 | Success
+ * - -1 | Failed to connect
  */
-int socket_close(int* sockfd, bool debug)
+int socket_connect_end(int sockfd, bool debug)
 {
-  if(!sockfd || *sockfd == -1) return 0;
+  int error = 0;
 
-  if(debug) info_print("Closing socket (%d)", *sockfd);
+  socklen_t length = sizeof(error);
 
-  if(close(*sockfd) == -1)
+  if(getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &length) == -1) error = errno;
+
+  if(error != 0)
   {
-    if(debug) error_print("Failed to close socket: %s", strerror(errno));
+    if(debug) error_print("Failed to connect socket (%d): %s", sockfd, strerror(error));
 
     return -1;
   }
 
-  if(debug) info_print("Closed socket");
+  fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL) & ~O_NONBLOCK);
 
-  *sockfd = -1;
+  if(debug) info_print("Connected socket (%d)", sockfd);
+
+  socket_nodelay(sockfd);
 
   return 0;
 }
 
 /*
- * Read a single line to a buffer from a socket connection
+ * close, but with pointer to file descriptor, and with debug messages
  *
- * RETURN (ssize_t size)
- * - >0 | The number of read characters
- * -  0 | Nothing to read, end of file
- * - -1 | Failed to read from socket
+ * Note: If no open socket is supplied, nothing is done
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to close socket
  */
-ssize_t socket_read(int sockfd, char* buffer, size_t size)
+int socket_close(int* sockfd, bool debug)
 {
-  if(errno != 0) return -1;
-
-  if(!buffer) return 0;
+  if(!sockfd || *sockfd == -1) return 0;
 
-  char symbol = '\0';
-  ssize_t index;
+  if(debug) info_print("Closing socket (%d)", *sockfd);
 
-  for(index = 0; index < size && symbol != '\n'; index++)
+  if(close(*sockfd) == -1)
   {
-    ssize_t status = recv(sockfd, &symbol, 1, 0);
+    if(debug) error_print("Failed to close socket: %s", strerror(errno));
 
-    if(status == -1 || errno != 0) return -1; // ERROR
+    return -1;
+  }
 
-    buffer[index] = symbol;
+  if(debug) info_print("Closed socket");
 
-    if(status == 0) return 0; // End Of File
-  }
+  *sockfd = -1;
 
-  return index;
+  return 0;
 }
 
 /*
- * Write a single line from a buffer to a socket connection
+ * Write the whole buffer to a socket connection, using as few syscalls as possible
  *
  * RETURN (ssize_t size)
  * - >0 | The number of written characters
- * -  0 | Nothing to write to, end of file
+ * -  0 | Nothing to write
  * - -1 | Failed to write to socket
  */
 ssize_t socket_write(int sockfd, const char* buffer, size_t size)
 {
-  if(errno != 0) return -1;
-
   if(!buffer) return 0;
 
-  ssize_t index;
-  char symbol = '\0';
+  size_t index = 0;
 
-  for(index = 0; index < size && symbol != '\n'; index++)
+  while(index < size)
   {
-    symbol = buffer[index];
-
-    ssize_t status = send(sockfd, &symbol, 1, 0);
+    ssize_t status = send(sockfd, buffer + index, size - index, MSG_NOSIGNAL);
 
-    if(status == -1 || errno != 0) return -1; // ERROR
-    
-    if(status == 0) return 0; // End Of File
+    if(status == -1) return -1; // ERROR
 
-    if(symbol == '\0') break;
+    index += status;
   }
 
   return index;
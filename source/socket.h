@@ -1,7 +1,7 @@
 /*
  * Written by Hampus Fridholm
  *
- * Last updated: 2024-09-08
+ * Last updated: 2026-10-17
  */
 
 #ifndef SOCKET_H
@@ -13,22 +13,30 @@
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <string.h>
 #include <stdbool.h>
 
-extern int server_socket_create(const char* address, int port, bool debug);
+extern int server_socket_create(const char* address, int port, int backlog, bool reuseport, bool debug);
 
 extern int socket_accept(int servfd, const char* address, int port, bool debug);
 
+extern int socket_connect(const char* address, int port, bool debug);
+
+extern int socket_connect_begin(const char* address, int port, bool debug);
+
+extern int socket_connect_end(int sockfd, bool debug);
+
 
 extern int socket_close(int* sockfd, bool debug);
 
+extern int socket_nodelay(int sockfd);
 
-extern ssize_t socket_write(int sockfd, const char* buffer, size_t size);
 
-extern ssize_t socket_read(int sockfd, char* buffer, size_t size);
+extern ssize_t socket_write(int sockfd, const char* buffer, size_t size);
 
 #endif // SOCKET_H
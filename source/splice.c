@@ -0,0 +1,119 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#include "splice.h"
+
+/*
+ * Check if file descriptor is a pipe or a fifo
+ */
+static bool fd_is_pipe(int fd)
+{
+  struct stat status;
+
+  return fstat(fd, &status) == 0 && S_ISFIFO(status.st_mode);
+}
+
+/*
+ * Initialize splicer for relaying from in to out
+ *
+ * The intermediate pipe is only created if it is needed
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to create intermediate pipe
+ */
+int splicer_init(splicer_t* splicer, int in, int out)
+{
+  *splicer = (splicer_t) { .pipe = { -1, -1 } };
+
+  if(fd_is_pipe(in) || fd_is_pipe(out)) return 0;
+
+  if(pipe2(splicer->pipe, O_CLOEXEC) == -1) return 1;
+
+  // Let a single splice move as much as possible
+  fcntl(splicer->pipe[1], F_SETPIPE_SZ, SPLICE_SIZE);
+
+  return 0;
+}
+
+/*
+ * Close the intermediate pipe of splicer
+ */
+void splicer_free(splicer_t* splicer)
+{
+  if(splicer->pipe[0] != -1) close(splicer->pipe[0]);
+
+  if(splicer->pipe[1] != -1) close(splicer->pipe[1]);
+
+  splicer->pipe[0] = -1;
+  splicer->pipe[1] = -1;
+}
+
+/*
+ * Move the bytes in the intermediate pipe to out
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to splice, or out would block
+ */
+static int splicer_drain(splicer_t* splicer, int out)
+{
+  while(splicer->pending > 0)
+  {
+    ssize_t size = splice(splicer->pipe[0], NULL, out, NULL, splicer->pending, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+    splicer->splices++;
+
+    if(size == -1) return -1;
+
+    splicer->pending -= size;
+  }
+
+  return 0;
+}
+
+/*
+ * Relay the bytes that are available from in to out,
+ * without copying them to user space
+ *
+ * If out would block, the bytes stay in the intermediate pipe,
+ * and are moved first the next time
+ *
+ * RETURN (ssize_t size)
+ * - >0 | The number of relayed bytes
+ * -  0 | End of file
+ * - -1 | Failed to splice
+ */
+ssize_t splicer_relay(splicer_t* splicer, int in, int out)
+{
+  ssize_t size;
+
+  if(splicer->pipe[0] == -1)
+  {
+    size = splice(in, NULL, out, NULL, SPLICE_SIZE, SPLICE_F_MOVE);
+
+    splicer->splices++;
+  }
+  else
+  {
+    if(splicer_drain(splicer, out) == -1) return -1;
+
+    size = splice(in, NULL, splicer->pipe[1], NULL, SPLICE_SIZE, SPLICE_F_MOVE);
+
+    splicer->splices++;
+
+    if(size > 0)
+    {
+      splicer->pending = size;
+
+      if(splicer_drain(splicer, out) == -1) return -1;
+    }
+  }
+
+  if(size > 0) splicer->bytes += size;
+
+  return size;
+}
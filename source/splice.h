@@ -0,0 +1,45 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#ifndef SPLICE_H
+#define SPLICE_H
+
+// splice, pipe2 and F_SETPIPE_SZ are GNU extensions
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define SPLICE_SIZE 65536
+
+/*
+ * Zero-copy relay from one file descriptor to another
+ *
+ * splice needs a pipe at one end, so if neither file descriptor
+ * is a pipe, the bytes are moved through an intermediate pipe
+ */
+typedef struct
+{
+  int    pipe[2];  // Intermediate pipe, if neither end is a pipe
+  size_t pending;  // Number of bytes in the intermediate pipe
+  size_t splices;  // Number of splice syscalls
+  size_t bytes;    // Number of relayed bytes
+} splicer_t;
+
+extern int     splicer_init(splicer_t* splicer, int in, int out);
+
+extern void    splicer_free(splicer_t* splicer);
+
+extern ssize_t splicer_relay(splicer_t* splicer, int in, int out);
+
+#endif // SPLICE_H
@@ -0,0 +1,327 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#include "store.h"
+
+/*
+ * Hash key with 64-bit FNV-1a, from a given offset basis
+ */
+static uint64_t store_hash(const char* key, size_t length, uint64_t basis)
+{
+  uint64_t hash = basis;
+
+  for(size_t index = 0; index < length; index++)
+  {
+    hash ^= (unsigned char) key[index];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+/*
+ * Get the size of a store file with capacity records
+ *
+ * The header is padded to the size of a record
+ */
+static size_t store_file_size(size_t capacity)
+{
+  return (size_t) STORE_RECORD * (capacity + 1);
+}
+
+/*
+ * Open store file, creating it with capacity records if it is empty
+ *
+ * An existing store keeps its own capacity
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to open or create file
+ * - 2 | The file is not a compatible store
+ * - 3 | Failed to map file
+ */
+int store_open(store_t* store, const char* path, size_t capacity, bool debug)
+{
+  *store = (store_t) { .fd = -1 };
+
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+  if(fd == -1)
+  {
+    if(debug) error_print("Failed to open store (%s): %s", path, strerror(errno));
+
+    return 1;
+  }
+
+  // Only one process should create the store
+  flock(fd, LOCK_EX);
+
+  struct stat status;
+
+  if(fstat(fd, &status) == -1)
+  {
+    if(debug) error_print("Failed to stat store: %s", strerror(errno));
+
+    close(fd);
+
+    return 1;
+  }
+
+  bool create = (status.st_size == 0);
+
+  if(create)
+  {
+    size_t power = 1024;
+
+    while(power < capacity) power *= 2;
+
+    capacity = power;
+
+    if(ftruncate(fd, store_file_size(capacity)) == -1)
+    {
+      if(debug) error_print("Failed to create store: %s", strerror(errno));
+
+      close(fd);
+
+      return 1;
+    }
+  }
+  else
+  {
+    store_header_t header;
+
+    if(pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+       memcmp(header.magic, STORE_MAGIC, 8) != 0 ||
+       header.version != STORE_VERSION || header.record_size != STORE_RECORD ||
+       (header.capacity & (header.capacity - 1)) != 0 ||
+       status.st_size != store_file_size(header.capacity))
+    {
+      if(debug) error_print("Not a compatible store (%s)", path);
+
+      close(fd);
+
+      return 2;
+    }
+
+    capacity = header.capacity;
+  }
+
+  size_t size = store_file_size(capacity);
+
+  char* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  if(base == MAP_FAILED)
+  {
+    if(debug) error_print("Failed to map store: %s", strerror(errno));
+
+    close(fd);
+
+    return 3;
+  }
+
+  store->fd      = fd;
+  store->header  = (store_header_t*) base;
+  store->records = (store_record_t*) (base + STORE_RECORD);
+  store->size    = size;
+
+  if(create)
+  {
+    memcpy(store->header->magic, STORE_MAGIC, 8);
+
+    store->header->version     = STORE_VERSION;
+    store->header->record_size = STORE_RECORD;
+    store->header->capacity    = capacity;
+  }
+
+  flock(fd, LOCK_UN);
+
+  if(debug) info_print("Opened store (%s) with %ld records", path, (long) capacity);
+
+  return 0;
+}
+
+/*
+ * Unmap and close store file
+ */
+void store_close(store_t* store)
+{
+  if(store->header) munmap(store->header, store->size);
+
+  if(store->fd != -1) close(store->fd);
+
+  store->header  = NULL;
+  store->records = NULL;
+  store->fd      = -1;
+}
+
+/*
+ * Copy a record, if it is not being written
+ *
+ * RETURN (bool valid)
+ * - true | The copy is a complete record
+ */
+bool store_record_read(store_record_t* record, store_record_t* copy)
+{
+  uint32_t sequence = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+
+  if(sequence & 1) return false;
+
+  memcpy(copy, record, sizeof(store_record_t));
+
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+  if(__atomic_load_n(&record->sequence, __ATOMIC_RELAXED) != sequence) return false;
+
+  return copy->hash != 0 && copy->length > 0 && copy->length <= STORE_RESULT;
+}
+
+/*
+ * Write result to a claimed record
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 3 | The record is being written by someone else
+ */
+static int store_record_write(store_record_t* record, uint64_t check, const char* result, size_t length)
+{
+  uint32_t sequence = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+
+  if(sequence & 1) return 3;
+
+  if(!__atomic_compare_exchange_n(&record->sequence, &sequence, sequence + 1,
+    false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return 3;
+
+  record->check  = check;
+  record->length = length;
+
+  memcpy(record->result, result, length);
+
+  __atomic_store_n(&record->sequence, sequence + 2, __ATOMIC_RELEASE);
+
+  return 0;
+}
+
+/*
+ * Insert a result, claiming an empty record or replacing the record of the key
+ *
+ * A record of the key that is being written, or was left half written by
+ * a crash, is skipped, and the result goes to the next record it can have.
+ * Lookups skip the unreadable record too, so they find the new one
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 2 | No free record within the probe limit
+ */
+static int store_insert(store_t* store, uint64_t hash, uint64_t check, const char* result, size_t length)
+{
+  uint64_t mask = store->header->capacity - 1;
+
+  for(uint64_t probe = 0; probe < STORE_PROBES; probe++)
+  {
+    store_record_t* record = &store->records[(hash + probe) & mask];
+
+    uint64_t current = __atomic_load_n(&record->hash, __ATOMIC_ACQUIRE);
+
+    if(current == 0)
+    {
+      if(__atomic_compare_exchange_n(&record->hash, &current, hash,
+        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      {
+        __atomic_add_fetch(&store->header->count, 1, __ATOMIC_RELAXED);
+
+        current = hash;
+      }
+    }
+
+    if(current != hash) continue;
+
+    if(store_record_write(record, check, result, length) != 0) continue;
+
+    store->writes++;
+
+    return 0;
+  }
+
+  store->full++;
+
+  return 2;
+}
+
+/*
+ * Look up the stored result of key
+ *
+ * The result buffer needs room for STORE_RESULT bytes
+ *
+ * RETURN (size_t length)
+ * - 0 | The result is not stored
+ */
+size_t store_get(store_t* store, const char* key, size_t key_length, char* result)
+{
+  uint64_t hash  = store_hash(key, key_length, 14695981039346656037ULL) | 1;
+  uint64_t check = store_hash(key, key_length, 0x6c62272e07bb0142ULL);
+
+  uint64_t mask = store->header->capacity - 1;
+
+  for(uint64_t probe = 0; probe < STORE_PROBES; probe++)
+  {
+    store_record_t* record = &store->records[(hash + probe) & mask];
+
+    uint64_t current = __atomic_load_n(&record->hash, __ATOMIC_ACQUIRE);
+
+    // Records are never removed, so the key can't be after an empty record
+    if(current == 0) break;
+
+    if(current != hash) continue;
+
+    store_record_t copy;
+
+    // A record being written, or left half written by a crash, might hide the key
+    if(!store_record_read(record, &copy)) continue;
+
+    if(copy.check != check) continue;
+
+    memcpy(result, copy.result, copy.length);
+
+    store->hits++;
+
+    return copy.length;
+  }
+
+  store->misses++;
+
+  return 0;
+}
+
+/*
+ * Store the result of key
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | The result is too large for a record
+ * - 2 | No free record within the probe limit
+ */
+int store_put(store_t* store, const char* key, size_t key_length, const char* result, size_t length)
+{
+  if(length == 0 || length > STORE_RESULT) return 1;
+
+  // The lowest bit is set, so that the hash is never 0
+  uint64_t hash  = store_hash(key, key_length, 14695981039346656037ULL) | 1;
+  uint64_t check = store_hash(key, key_length, 0x6c62272e07bb0142ULL);
+
+  return store_insert(store, hash, check, result, length);
+}
+
+/*
+ * Insert a copied record into another store, when compacting
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 2 | No free record within the probe limit
+ */
+int store_record_insert(store_t* store, const store_record_t* record)
+{
+  return store_insert(store, record->hash, record->check, record->result, record->length);
+}
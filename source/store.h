@@ -0,0 +1,90 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#ifndef STORE_H
+#define STORE_H
+
+#include "debug.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#define STORE_MAGIC    "UCISTORE"
+#define STORE_VERSION  1
+#define STORE_RECORD   512
+#define STORE_RESULT   (STORE_RECORD - 24)
+#define STORE_PROBES   64
+#define STORE_CAPACITY 65536
+
+/*
+ * Header at the start of the store file
+ */
+typedef struct
+{
+  char     magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t capacity;    // Number of records, a power of two
+  uint64_t count;       // Number of claimed records
+} store_header_t;
+
+/*
+ * Fixed size record of a completed analysis
+ *
+ * The key is only stored as two hashes. The sequence is odd while
+ * the record is being written, so a record that was being written
+ * when a node crashed is never read, and is dropped by compaction
+ */
+typedef struct
+{
+  uint64_t hash;      // Hash of the key (0 if the record is empty)
+  uint64_t check;     // Second hash of the key
+  uint32_t sequence;
+  uint32_t length;    // Length of the result (0 until written)
+  char     result[STORE_RESULT];
+} store_record_t;
+
+/*
+ * Open addressing hash table in a shared memory mapped file
+ *
+ * Several processes can share the file. Records are claimed
+ * atomically, and read optimistically by checking the sequence
+ */
+typedef struct
+{
+  int             fd;
+  store_header_t* header;
+  store_record_t* records;
+  size_t          size;     // Size of the mapping
+  size_t          hits;
+  size_t          misses;
+  size_t          writes;
+  size_t          full;     // Results that found no free record
+} store_t;
+
+extern int    store_open(store_t* store, const char* path, size_t capacity, bool debug);
+
+extern void   store_close(store_t* store);
+
+
+extern size_t store_get(store_t* store, const char* key, size_t key_length, char* result);
+
+extern int    store_put(store_t* store, const char* key, size_t key_length, const char* result, size_t length);
+
+
+extern bool   store_record_read(store_record_t* record, store_record_t* copy);
+
+extern int    store_record_insert(store_t* store, const store_record_t* record);
+
+#endif // STORE_H
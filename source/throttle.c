@@ -0,0 +1,138 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#include "throttle.h"
+
+/*
+ * Get the slot of an engine output line
+ */
+static int throttle_slot(const char* line)
+{
+  if(strncmp(line, "info ", 5) != 0 || strncmp(line, "info string ", 12) == 0)
+  {
+    return THROTTLE_KEEP;
+  }
+
+  if(strstr(line, " currmove ")) return 0;
+
+  // A line without a pv can't stand in for one
+  if(!strstr(line, " pv ")) return THROTTLE_PROGRESS;
+
+  const char* multipv = strstr(line, " multipv ");
+
+  int slot = multipv ? atoi(multipv + 9) : 1;
+
+  return (slot > 0) ? slot : 1;
+}
+
+/*
+ * Remove the queued line at index, keeping the order of the rest
+ */
+static void throttle_remove(throttle_t* throttle, size_t index)
+{
+  throttle->bytes -= throttle->lines[index].length;
+
+  free(throttle->lines[index].line);
+
+  memmove(&throttle->lines[index], &throttle->lines[index + 1],
+    sizeof(throttle_line_t) * (throttle->count - index - 1));
+
+  throttle->count--;
+}
+
+/*
+ * Queue a copy of line, replacing the older line in its slot
+ *
+ * The older line is only looked for after the last kept line, because
+ * a bestmove ends the search, and the lines before it belong to it
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | The line was dropped, because the queue is full
+ * - 2 | Failed to allocate line
+ */
+int throttle_push(throttle_t* throttle, const char* line, size_t length)
+{
+  int slot = throttle_slot(line);
+
+  bool merged = false;
+
+  if(slot != THROTTLE_KEEP)
+  {
+    for(size_t index = throttle->count; index-- > 0;)
+    {
+      if(throttle->lines[index].slot == THROTTLE_KEEP) break;
+
+      if(throttle->lines[index].slot != slot) continue;
+
+      throttle_remove(throttle, index);
+
+      throttle->merged++;
+
+      merged = true;
+
+      break;
+    }
+
+    if(!merged && throttle->count >= THROTTLE_LINES)
+    {
+      throttle->dropped++;
+
+      return 1;
+    }
+  }
+
+  if(throttle->count == throttle->capacity)
+  {
+    size_t capacity = (throttle->capacity > 0) ? throttle->capacity * 2 : 16;
+
+    throttle_line_t* lines = realloc(throttle->lines, sizeof(throttle_line_t) * capacity);
+
+    if(!lines) return 2;
+
+    throttle->lines    = lines;
+    throttle->capacity = capacity;
+  }
+
+  char* copy = malloc(length);
+
+  if(!copy) return 2;
+
+  memcpy(copy, line, length);
+
+  throttle->lines[throttle->count++] = (throttle_line_t) { copy, length, slot };
+
+  throttle->bytes += length;
+
+  return 0;
+}
+
+/*
+ * Remove every queued line, after they have been handed to the client
+ */
+void throttle_clear(throttle_t* throttle)
+{
+  for(size_t index = 0; index < throttle->count; index++)
+  {
+    free(throttle->lines[index].line);
+  }
+
+  throttle->count = 0;
+  throttle->bytes = 0;
+}
+
+/*
+ * Free the queue of throttle
+ */
+void throttle_free(throttle_t* throttle)
+{
+  throttle_clear(throttle);
+
+  free(throttle->lines);
+
+  throttle->lines    = NULL;
+  throttle->capacity = 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#ifndef THROTTLE_H
+#define THROTTLE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THROTTLE_PENDING 65536   // Bytes waiting for the client, before lines are throttled
+#define THROTTLE_LINES   256     // Queued lines, before lines that can't be merged are dropped
+#define THROTTLE_BYTES   1048576 // Queued bytes, before the engine is paused
+
+#define THROTTLE_KEEP     -1 // Slot of lines that are always delivered
+#define THROTTLE_PROGRESS -2 // Slot of info lines without a pv, like nodes and hashfull
+
+/*
+ * Line waiting for a slow client
+ *
+ * Info lines in the same slot supersede each other
+ */
+typedef struct
+{
+  char*  line;
+  size_t length;
+  int    slot;
+} throttle_line_t;
+
+/*
+ * Bounded queue of engine output, for a client that can't keep up
+ *
+ * Newer info lines replace older ones in the same slot, which is
+ * currmove (0), the multipv number of a line with a pv, or progress
+ * for the lines without one, while bestmove, readyok and info string
+ * lines are always kept. Lines are only merged with the lines queued
+ * after the last kept line, so that a search keeps its last pv
+ */
+typedef struct
+{
+  throttle_line_t* lines;
+  size_t           count;
+  size_t           capacity;
+  size_t           bytes;
+  size_t           merged;   // Lines replaced by newer lines
+  size_t           dropped;  // Lines dropped because the queue was full
+} throttle_t;
+
+extern int  throttle_push(throttle_t* throttle, const char* line, size_t length);
+
+extern void throttle_clear(throttle_t* throttle);
+
+extern void throttle_free(throttle_t* throttle);
+
+#endif // THROTTLE_H
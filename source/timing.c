@@ -0,0 +1,21 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#include "timing.h"
+
+/*
+ * Get the time of a monotonic clock, for measuring durations
+ *
+ * RETURN (uint64_t nanos)
+ */
+uint64_t timing_now(void)
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+
+  return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
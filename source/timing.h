@@ -0,0 +1,17 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define TIMING_MICROS(nanos) ((double) (nanos) / 1000.0)
+
+extern uint64_t timing_now(void);
+
+#endif // TIMING_H
@@ -0,0 +1,175 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "../socket.h"
+#include "../reader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define CHECK_TIMEOUT 5 // Seconds to wait for a line from the node
+
+/*
+ * Client of a check, reading the lines of the node in order
+ */
+typedef struct
+{
+  int      sockfd;
+  reader_t reader;
+} check_client_t;
+
+/*
+ * Connect a client to the node, with a timeout on its reads
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to connect
+ */
+static int check_connect(check_client_t* client, const char* address, int port)
+{
+  client->sockfd = socket_connect(address, port, false);
+
+  if(client->sockfd == -1) return 1;
+
+  struct timeval timeout = { .tv_sec = CHECK_TIMEOUT };
+
+  setsockopt(client->sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  if(reader_init(&client->reader, client->sockfd) != 0)
+  {
+    socket_close(&client->sockfd, false);
+
+    return 1;
+  }
+
+  return 0;
+}
+
+/*
+ * Close the client
+ */
+static void check_close(check_client_t* client)
+{
+  reader_free(&client->reader);
+
+  socket_close(&client->sockfd, false);
+}
+
+/*
+ * Send lines to the node
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to write
+ */
+static int check_send(check_client_t* client, const char* lines)
+{
+  return (socket_write(client->sockfd, lines, strlen(lines)) == -1);
+}
+
+/*
+ * Read lines until one starts with prefix, failing at a line
+ * that starts with unwanted, when given
+ *
+ * RETURN (int status)
+ * - 0 | The line was read
+ * - 1 | An unwanted line, end of file or a timeout came first
+ */
+static int check_expect(check_client_t* client, const char* prefix, const char* unwanted)
+{
+  char* line;
+
+  while(reader_line(&client->reader, &line) > 0)
+  {
+    if(strncmp(line, prefix, strlen(prefix)) == 0) return 0;
+
+    if(unwanted && strncmp(line, unwanted, strlen(unwanted)) == 0)
+    {
+      fprintf(stderr, "unexpected line: %s", line);
+
+      return 1;
+    }
+  }
+
+  fprintf(stderr, "no line starting with: %s\n", prefix);
+
+  return 1;
+}
+
+/*
+ * A logical session that quits while waiting for an engine is closed
+ * at once, and leaves its place in the queue to the next session
+ *
+ * The node has one engine and room for one waiting session
+ *
+ * RETURN (int status)
+ * - 0 | Passed
+ * - 1 | Failed
+ */
+static int check_mux_quit_waiting(const char* address, int port)
+{
+  check_client_t client;
+
+  if(check_connect(&client, address, port) != 0) return 1;
+
+  int status = 1;
+
+  // Session 1 takes the engine, and session 2 waits for it
+  if(check_send(&client, "mux\n1 isready\n") != 0) goto close;
+
+  if(check_expect(&client, "1 readyok", NULL) != 0) goto close;
+
+  if(check_send(&client, "1 go infinite\n2 isready\n2 quit\n3 isready\n") != 0) goto close;
+
+  if(check_send(&client, "1 stop\n") != 0) goto close;
+
+  if(check_expect(&client, "1 bestmove", "3 info string queue full") != 0) goto close;
+
+  // Session 3 gets the engine next, which session 2 would have quit
+  if(check_send(&client, "1 quit\n") != 0) goto close;
+
+  if(check_expect(&client, "3 readyok", "2 readyok") != 0) goto close;
+
+  status = 0;
+
+close:
+  check_close(&client);
+
+  return status;
+}
+
+/*
+ * Check the behavior of a node, started with one engine
+ * and room for one waiting session (--engines 1 --depth 1)
+ *
+ * usage: ucicheck PORT [ADDRESS]
+ */
+int main(int argc, char* argv[])
+{
+  if(argc < 2)
+  {
+    fprintf(stderr, "usage: %s PORT [ADDRESS]\n", argv[0]);
+
+    return 1;
+  }
+
+  int   port    = atoi(argv[1]);
+  char* address = (argc > 2) ? argv[2] : "127.0.0.1";
+
+  int failures = 0;
+
+  if(check_mux_quit_waiting(address, port) != 0)
+  {
+    fprintf(stderr, "failed: mux quit waiting\n");
+
+    failures++;
+  }
+  else printf("passed: mux quit waiting\n");
+
+  return (failures > 0);
+}
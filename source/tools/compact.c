@@ -0,0 +1,109 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#include "../store.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Copy the complete records of a store into a new store
+ *
+ * Records that were being written when a node crashed, and records
+ * that were claimed but never written, are dropped. The new store
+ * gets room for twice the records, unless a capacity is given
+ *
+ * usage: ucistore INPUT OUTPUT [CAPACITY]
+ */
+int main(int argc, char* argv[])
+{
+  if(argc < 3)
+  {
+    fprintf(stderr, "usage: %s INPUT OUTPUT [CAPACITY]\n", argv[0]);
+
+    return 1;
+  }
+
+  if(access(argv[1], F_OK) != 0)
+  {
+    error_print("Input store does not exist (%s)", argv[1]);
+
+    return 1;
+  }
+
+  if(access(argv[2], F_OK) == 0)
+  {
+    error_print("Output store already exists (%s)", argv[2]);
+
+    return 1;
+  }
+
+  store_t input;
+
+  if(store_open(&input, argv[1], 0, true) != 0) return 2;
+
+  size_t capacity = input.header->capacity;
+
+  store_record_t* records = malloc(sizeof(store_record_t) * capacity);
+
+  if(!records)
+  {
+    error_print("Failed to allocate records");
+
+    store_close(&input);
+
+    return 2;
+  }
+
+  size_t count = 0;
+
+  for(size_t index = 0; index < capacity; index++)
+  {
+    if(store_record_read(&input.records[index], &records[count])) count++;
+  }
+
+  size_t dropped = input.header->count - count;
+
+  store_close(&input);
+
+  if(argc > 3) capacity = strtoul(argv[3], NULL, 10);
+
+  else capacity = count * 2;
+
+  if(capacity < count)
+  {
+    error_print("Capacity is smaller than %ld records", (long) count);
+
+    free(records);
+
+    return 1;
+  }
+
+  store_t output;
+
+  if(store_open(&output, argv[2], capacity, true) != 0)
+  {
+    free(records);
+
+    return 2;
+  }
+
+  size_t lost = 0;
+
+  for(size_t index = 0; index < count; index++)
+  {
+    if(store_record_insert(&output, &records[index]) != 0) lost++;
+  }
+
+  printf("kept %ld, dropped %ld, lost %ld, capacity %ld\n",
+    (long) (count - lost), (long) dropped, (long) lost, (long) output.header->capacity);
+
+  store_close(&output);
+
+  free(records);
+
+  return (lost > 0) ? 3 : 0;
+}
@@ -0,0 +1,335 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "../fifo.h"
+#include "../socket.h"
+#include "../reader.h"
+#include "../writer.h"
+#include "../timing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define BENCH_BURST 20  // Lines an engine typically writes at once
+
+/*
+ * Primitive that writes the lines of a benchmark
+ */
+typedef enum
+{
+  BENCH_BUFFER_WRITE,
+  BENCH_MESSAGE_WRITE,
+  BENCH_SOCKET_WRITE,
+  BENCH_WRITER         // Coalesced in bursts, and flushed with one vectored write
+} bench_primitive_t;
+
+static const char* bench_primitives[] = { "buffer_write", "message_write", "socket_write", "writer" };
+
+typedef struct
+{
+  bench_primitive_t primitive;
+  bool              socket;    // Loopback socket, instead of a pipe
+  size_t            lines;
+  int               fds[2];    // Read end and write end
+  reader_t          reader;
+  size_t            received;  // Lines taken by the consumer
+  size_t            writes;    // Write syscalls of the producer
+} bench_t;
+
+/*
+ * Build a line like an info line of an engine, padded with moves to length
+ */
+static void bench_line(char* line, size_t length)
+{
+  size_t index = snprintf(line, length, "info depth 24 seldepth 31 score cp 34 pv");
+
+  if(index >= length) index = length - 1;
+
+  while(index + 5 < length) index += sprintf(line + index, " e2e4");
+
+  while(index + 1 < length) line[index++] = ' ';
+
+  line[index++] = '\n';
+  line[index]   = '\0';
+}
+
+/*
+ * Take lines from the read end until every line has arrived
+ */
+static void* bench_consumer(void* arg)
+{
+  bench_t* bench = arg;
+
+  char* line;
+
+  while(bench->received < bench->lines)
+  {
+    ssize_t size = reader_fill(&bench->reader);
+
+    if(size == -1 && errno == EINTR) continue;
+
+    if(size <= 0) break;
+
+    while(reader_take(&bench->reader, &line) > 0) bench->received++;
+  }
+
+  return NULL;
+}
+
+/*
+ * Write the lines with the primitive of the benchmark
+ *
+ * The descriptors are blocking, so every write call is one complete syscall
+ */
+static int bench_producer(bench_t* bench, const char* line, size_t length)
+{
+  int fd = bench->fds[1];
+
+  if(bench->primitive == BENCH_WRITER)
+  {
+    writer_t writer;
+
+    if(writer_init(&writer, fd) != 0) return 1;
+
+    int status = 0;
+
+    for(size_t index = 0; index < bench->lines && status == 0; index++)
+    {
+      status = writer_line(&writer, line, length);
+
+      if(status == 0 && (index + 1) % BENCH_BURST == 0) status = writer_flush(&writer);
+    }
+
+    if(status == 0) status = writer_flush(&writer);
+
+    bench->writes = writer.writes;
+
+    writer_free(&writer);
+
+    return (status == 0) ? 0 : 1;
+  }
+
+  for(size_t index = 0; index < bench->lines; index++)
+  {
+    ssize_t size;
+
+    switch(bench->primitive)
+    {
+      case BENCH_MESSAGE_WRITE:
+        size = message_write(fd, line);
+        break;
+
+      case BENCH_SOCKET_WRITE:
+        size = socket_write(fd, line, length);
+        break;
+
+      default:
+        size = buffer_write(fd, line, length);
+        break;
+    }
+
+    if(size == -1) return 1;
+
+    bench->writes++;
+  }
+
+  return 0;
+}
+
+/*
+ * Connect a loopback socket pair through a listening socket
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to create sockets
+ */
+static int bench_sockets(int fds[2])
+{
+  int servfd = server_socket_create("127.0.0.1", 0, 1, false, false);
+
+  if(servfd == -1) return 1;
+
+  struct sockaddr_in address;
+
+  socklen_t length = sizeof(address);
+
+  if(getsockname(servfd, (struct sockaddr*) &address, &length) == -1)
+  {
+    socket_close(&servfd, false);
+
+    return 1;
+  }
+
+  fds[1] = socket_connect("127.0.0.1", ntohs(address.sin_port), false);
+
+  fds[0] = (fds[1] != -1) ? accept(servfd, NULL, NULL) : -1;
+
+  socket_close(&servfd, false);
+
+  if(fds[0] == -1)
+  {
+    socket_close(&fds[1], false);
+
+    return 1;
+  }
+
+  return 0;
+}
+
+/*
+ * Run one benchmark of a primitive, and print its results on a single line
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to set up the benchmark
+ * - 2 | Failed to write or to read every line
+ */
+static int bench_run(bench_primitive_t primitive, bool socket, size_t length, size_t lines)
+{
+  bench_t bench = { .primitive = primitive, .socket = socket, .lines = lines };
+
+  if((socket ? bench_sockets(bench.fds) : pipe(bench.fds)) != 0) return 1;
+
+  char* line = malloc(length + 1);
+
+  if(!line || reader_init(&bench.reader, bench.fds[0]) != 0)
+  {
+    free(line);
+
+    close(bench.fds[0]);
+    close(bench.fds[1]);
+
+    return 1;
+  }
+
+  bench_line(line, length);
+
+  pthread_t consumer;
+
+  uint64_t start = timing_now();
+
+  pthread_create(&consumer, NULL, bench_consumer, &bench);
+
+  int status = bench_producer(&bench, line, length);
+
+  // The consumer sees the end of file, if not every line was written
+  close(bench.fds[1]);
+
+  pthread_join(consumer, NULL);
+
+  uint64_t elapsed = timing_now() - start;
+
+  if(status == 0 && bench.received == lines)
+  {
+    printf("primitive=%s transport=%s length=%ld lines=%ld ns_per_line=%.1f "
+      "syscalls_per_line=%.4f writes_per_line=%.4f reads_per_line=%.4f\n",
+      bench_primitives[primitive], socket ? "socket" : "pipe", (long) length, (long) lines,
+      (double) elapsed / lines, (double) (bench.writes + bench.reader.reads) / lines,
+      (double) bench.writes / lines, (double) bench.reader.reads / lines);
+  }
+  else status = 2;
+
+  reader_free(&bench.reader);
+
+  close(bench.fds[0]);
+
+  free(line);
+
+  return status;
+}
+
+/*
+ * Benchmark format_string, formatting an info line that is about length long
+ */
+static void bench_format(size_t length, size_t lines)
+{
+  char* pv     = malloc(length + 1);
+  char* buffer = malloc(length + 256);
+
+  if(!pv || !buffer)
+  {
+    free(pv);
+    free(buffer);
+
+    return;
+  }
+
+  // The moves make up what the numbers leave of the length
+  size_t used = 0;
+
+  while(used + 5 + 80 <= length) used += sprintf(pv + used, "e2e4 ");
+
+  pv[used] = '\0';
+
+  volatile int total = 0;
+
+  uint64_t start = timing_now();
+
+  for(size_t index = 0; index < lines; index++)
+  {
+    total += format_string(buffer, "info depth %d seldepth %d score cp %d nodes %ld nps %ld pv %s",
+      24, 31, (int) (index % 200) - 100, (long) index * 1000, 1523400L, pv);
+  }
+
+  uint64_t elapsed = timing_now() - start;
+
+  printf("primitive=format_string transport=none length=%ld lines=%ld ns_per_line=%.1f "
+    "syscalls_per_line=0.0000 writes_per_line=0.0000 reads_per_line=0.0000\n",
+    (long) length, (long) lines, (double) elapsed / lines);
+
+  free(pv);
+  free(buffer);
+}
+
+/*
+ * Benchmark the write primitives over pipes and loopback sockets,
+ * read back with the line reader, and format_string, at line lengths
+ * from short info lines to long principal variations
+ *
+ * Every benchmark prints one line of key=value pairs, so that the
+ * results of two builds can be compared line by line
+ *
+ * usage: iobench [LINES] [LENGTH...]
+ */
+int main(int argc, char* argv[])
+{
+  size_t lines = (argc > 1) ? strtoul(argv[1], NULL, 10) : 200000;
+
+  size_t lengths[16] = { 40, 100, 400, 4096 };
+  size_t count = 4;
+
+  if(argc > 2)
+  {
+    for(count = 0; count < 16 && count + 2 < argc; count++)
+    {
+      lengths[count] = strtoul(argv[count + 2], NULL, 10);
+
+      if(lengths[count] < 2) return 1;
+    }
+  }
+
+  if(lines == 0) return 1;
+
+  for(size_t index = 0; index < count; index++)
+  {
+    size_t length = lengths[index];
+
+    if(bench_run(BENCH_BUFFER_WRITE,  false, length, lines) != 0) return 2;
+
+    if(bench_run(BENCH_MESSAGE_WRITE, false, length, lines) != 0) return 2;
+
+    if(bench_run(BENCH_WRITER,        false, length, lines) != 0) return 2;
+
+    if(bench_run(BENCH_SOCKET_WRITE,  true,  length, lines) != 0) return 2;
+
+    if(bench_run(BENCH_WRITER,        true,  length, lines) != 0) return 2;
+
+    bench_format(length, lines);
+  }
+
+  return 0;
+}
@@ -0,0 +1,304 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "../socket.h"
+#include "../event.h"
+#include "../reader.h"
+#include "../timing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+
+#define LOAD_COMMANDS "position startpos moves e2e4 e7e5 g1f3\ngo depth 10\n"
+
+/*
+ * Client driving position and go cycles
+ */
+typedef struct
+{
+  int      sockfd;
+  event_t  event;
+  reader_t reader;
+  size_t   cycles;   // Cycles that have been completed
+  uint64_t go_time;  // When the go of the cycle in progress was sent
+} load_client_t;
+
+static size_t cycle_count = 100;
+
+static uint64_t* latencies = NULL;
+static size_t    latency_count = 0;
+
+static size_t lines      = 0;
+static size_t open_count = 0;
+static size_t failures   = 0;
+
+/*
+ * CPU time and peak memory of a process, read from /proc
+ */
+typedef struct
+{
+  double cpu;   // User and system time in seconds
+  long   peak;  // Peak resident set size in kB
+} load_usage_t;
+
+/*
+ * Read the CPU time and the peak resident set size of a process
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to read the process
+ */
+static int load_usage(int pid, load_usage_t* usage)
+{
+  char path[64];
+
+  sprintf(path, "/proc/%d/stat", pid);
+
+  FILE* file = fopen(path, "r");
+
+  if(!file) return 1;
+
+  unsigned long user = 0, system = 0;
+
+  // The name of the command might have spaces, so fields are counted after it
+  int status = fscanf(file, "%*d (%*[^)]) %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &user, &system);
+
+  fclose(file);
+
+  if(status != 2) return 1;
+
+  usage->cpu = (double) (user + system) / sysconf(_SC_CLK_TCK);
+
+  sprintf(path, "/proc/%d/status", pid);
+
+  file = fopen(path, "r");
+
+  if(!file) return 1;
+
+  char line[256];
+
+  usage->peak = 0;
+
+  while(fgets(line, sizeof(line), file))
+  {
+    if(sscanf(line, "VmHWM: %ld", &usage->peak) == 1) break;
+  }
+
+  fclose(file);
+
+  return 0;
+}
+
+/*
+ * Compare latencies, for sorting
+ */
+static int load_latency_compare(const void* first, const void* second)
+{
+  uint64_t a = *(const uint64_t*) first;
+  uint64_t b = *(const uint64_t*) second;
+
+  return (a > b) - (a < b);
+}
+
+/*
+ * Close client
+ */
+static void load_close(load_client_t* client)
+{
+  if(client->sockfd == -1) return;
+
+  event_del(&client->event);
+
+  reader_free(&client->reader);
+
+  socket_close(&client->sockfd, false);
+
+  open_count--;
+}
+
+/*
+ * Start the next position and go cycle
+ */
+static void load_cycle(load_client_t* client)
+{
+  client->go_time = timing_now();
+
+  if(socket_write(client->sockfd, LOAD_COMMANDS, strlen(LOAD_COMMANDS)) == -1)
+  {
+    failures++;
+
+    load_close(client);
+  }
+}
+
+/*
+ * Count the lines from the node, and start the next cycle after bestmove
+ */
+static void load_readable(event_t* event, uint32_t events)
+{
+  load_client_t* client = event->data;
+
+  ssize_t size = reader_fill(&client->reader);
+
+  if(size == -1 && (errno == EAGAIN || errno == EINTR)) return;
+
+  char* line;
+
+  while(client->sockfd != -1 && reader_take(&client->reader, &line) > 0)
+  {
+    lines++;
+
+    if(strncmp(line, "bestmove", 8) != 0) continue;
+
+    latencies[latency_count++] = timing_now() - client->go_time;
+
+    if(++client->cycles < cycle_count) load_cycle(client);
+
+    else
+    {
+      socket_write(client->sockfd, "quit\n", 5);
+
+      load_close(client);
+    }
+  }
+
+  if(size <= 0 && client->sockfd != -1)
+  {
+    // The node closed the client before its cycles were done
+    failures++;
+
+    load_close(client);
+  }
+}
+
+/*
+ * Print the percentile of the sorted latencies
+ */
+static double load_percentile(double percentile)
+{
+  size_t index = (size_t) (latency_count * percentile);
+
+  if(index >= latency_count) index = latency_count - 1;
+
+  return TIMING_MICROS(latencies[index]);
+}
+
+/*
+ * Drive a node with clients running position and go cycles
+ *
+ * Every client connects at the start, and sends a position and a go
+ * as soon as the previous search has sent its bestmove. With the pid
+ * of the node, its CPU time per relayed line and its peak resident
+ * set size are reported too
+ *
+ * usage: uciload PORT [CLIENTS] [CYCLES] [PID] [ADDRESS]
+ */
+int main(int argc, char* argv[])
+{
+  if(argc < 2)
+  {
+    fprintf(stderr, "usage: %s PORT [CLIENTS] [CYCLES] [PID] [ADDRESS]\n", argv[0]);
+
+    return 1;
+  }
+
+  int    port    = atoi(argv[1]);
+  size_t count   = (argc > 2) ? strtoul(argv[2], NULL, 10) : 8;
+  int    pid     = (argc > 4) ? atoi(argv[4]) : 0;
+  char*  address = (argc > 5) ? argv[5] : "127.0.0.1";
+
+  if(argc > 3) cycle_count = strtoul(argv[3], NULL, 10);
+
+  if(count == 0 || cycle_count == 0) return 1;
+
+  signal(SIGPIPE, SIG_IGN);
+
+  load_client_t* clients = calloc(count, sizeof(load_client_t));
+
+  latencies = malloc(sizeof(uint64_t) * count * cycle_count);
+
+  if(!clients || !latencies || event_init() != 0)
+  {
+    free(clients);
+    free(latencies);
+
+    return 2;
+  }
+
+  load_usage_t before = { 0 }, after = { 0 };
+
+  if(pid > 0 && load_usage(pid, &before) != 0)
+  {
+    fprintf(stderr, "Failed to read process (%d)\n", pid);
+
+    pid = 0;
+  }
+
+  for(size_t index = 0; index < count; index++)
+  {
+    load_client_t* client = &clients[index];
+
+    client->sockfd = socket_connect(address, port, false);
+
+    if(client->sockfd == -1 || reader_init(&client->reader, client->sockfd) != 0)
+    {
+      socket_close(&client->sockfd, false);
+
+      failures++;
+
+      continue;
+    }
+
+    client->event = (event_t) { .fd = client->sockfd, .handler = load_readable, .data = client };
+
+    event_add(&client->event, EPOLLIN);
+
+    open_count++;
+  }
+
+  uint64_t start = timing_now();
+
+  for(size_t index = 0; index < count; index++)
+  {
+    if(clients[index].sockfd != -1) load_cycle(&clients[index]);
+  }
+
+  while(open_count > 0)
+  {
+    if(event_wait(-1) == -1 && errno != EINTR) break;
+  }
+
+  double duration = (double) (timing_now() - start) / 1e9;
+
+  if(pid > 0 && load_usage(pid, &after) != 0) pid = 0;
+
+  printf("clients %ld, cycles %ld, failures %ld\n", (long) count, (long) cycle_count, (long) failures);
+
+  printf("lines %ld in %.3f s, %.0f lines per second\n", (long) lines, duration, lines / duration);
+
+  if(latency_count > 0)
+  {
+    qsort(latencies, latency_count, sizeof(uint64_t), load_latency_compare);
+
+    printf("go -> bestmove: p50 %.1f us, p99 %.1f us, p999 %.1f us, max %.1f us\n",
+      load_percentile(0.5), load_percentile(0.99), load_percentile(0.999),
+      TIMING_MICROS(latencies[latency_count - 1]));
+  }
+
+  if(pid > 0 && lines > 0)
+  {
+    printf("node: %.3f us cpu per line, peak rss %ld kB\n",
+      (after.cpu - before.cpu) * 1e6 / lines, after.peak);
+  }
+
+  event_free();
+
+  free(clients);
+  free(latencies);
+
+  return (failures > 0) ? 3 : 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "../reader.h"
+#include "../timing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <poll.h>
+
+#define MOCK_LINE 4096 // Largest info line
+
+/*
+ * Search in progress, emitting info lines until its bestmove
+ */
+typedef struct
+{
+  bool     searching;
+  bool     infinite;  // Until stop, instead of a number of lines
+  size_t   emitted;
+  uint64_t next;      // When the next info line is due
+} mock_search_t;
+
+static size_t mock_lines = 20;   // Info lines per search
+static size_t mock_rate  = 0;    // Info lines per second (0 for as fast as possible)
+static size_t mock_size  = 100;  // Bytes per info line, with the newline
+
+static char   mock_info[MOCK_LINE];
+static size_t mock_info_length = 0;
+
+/*
+ * Build the info line that every search emits, padded with moves to the size
+ */
+static void mock_info_build(void)
+{
+  if(mock_size >= MOCK_LINE) mock_size = MOCK_LINE - 1;
+
+  int length = snprintf(mock_info, MOCK_LINE, "info depth 24 seldepth 31 score cp 34 nodes 18234112 nps 1523400 pv");
+
+  while(length + 5 < mock_size) length += sprintf(mock_info + length, " e2e4");
+
+  mock_info[length++] = '\n';
+
+  mock_info_length = length;
+}
+
+/*
+ * End the search with a bestmove
+ */
+static void mock_bestmove(mock_search_t* search)
+{
+  fputs("bestmove e2e4 ponder e7e5\n", stdout);
+
+  search->searching = false;
+}
+
+/*
+ * Emit the info lines that are due, and the bestmove after the last
+ */
+static void mock_emit(mock_search_t* search)
+{
+  uint64_t now = timing_now();
+
+  while(search->searching && (mock_rate == 0 || search->next <= now))
+  {
+    if(!search->infinite && search->emitted >= mock_lines)
+    {
+      mock_bestmove(search);
+
+      break;
+    }
+
+    fwrite(mock_info, 1, mock_info_length, stdout);
+
+    search->emitted++;
+
+    if(mock_rate > 0) search->next += 1000000000 / mock_rate;
+
+    // An infinite search as fast as possible still has to see stop
+    if(mock_rate == 0 && search->infinite && search->emitted % mock_lines == 0) break;
+  }
+
+  fflush(stdout);
+}
+
+/*
+ * Answer a command, like an engine would
+ *
+ * RETURN (bool quit)
+ */
+static bool mock_command(mock_search_t* search, const char* line)
+{
+  if(strncmp(line, "uci", 3) == 0 && (line[3] == '\0' || isspace((unsigned char) line[3])))
+  {
+    fputs("id name ucimock\nid author ucinode\n"
+          "option name Hash type spin default 16 min 1 max 1024\n"
+          "option name Threads type spin default 1 min 1 max 512\n"
+          "uciok\n", stdout);
+  }
+  else if(strncmp(line, "isready", 7) == 0)
+  {
+    fputs("readyok\n", stdout);
+  }
+  else if(strncmp(line, "go", 2) == 0 && (line[2] == '\0' || isspace((unsigned char) line[2])))
+  {
+    *search = (mock_search_t)
+    {
+      .searching = true,
+      .infinite  = (strstr(line, "infinite") != NULL),
+      .next      = timing_now()
+    };
+  }
+  else if(strncmp(line, "stop", 4) == 0)
+  {
+    if(search->searching) mock_bestmove(search);
+  }
+  else if(strncmp(line, "quit", 4) == 0)
+  {
+    return true;
+  }
+
+  // ucinewgame, position and setoption need no answer
+  fflush(stdout);
+
+  return false;
+}
+
+/*
+ * Mock UCI engine, for benchmarking the relay without a real engine
+ *
+ * Every search emits LINES info lines of SIZE bytes, at RATE lines
+ * per second (0 for as fast as possible), followed by a bestmove.
+ * An infinite search emits info lines until it is stopped
+ *
+ * usage: ucimock [LINES] [RATE] [SIZE]
+ */
+int main(int argc, char* argv[])
+{
+  if(argc > 1) mock_lines = strtoul(argv[1], NULL, 10);
+  if(argc > 2) mock_rate  = strtoul(argv[2], NULL, 10);
+  if(argc > 3) mock_size  = strtoul(argv[3], NULL, 10);
+
+  if(mock_lines == 0) mock_lines = 1;
+
+  mock_info_build();
+
+  reader_t reader;
+
+  if(reader_init(&reader, STDIN_FILENO) != 0) return 1;
+
+  mock_search_t search = { 0 };
+
+  bool quit = false;
+
+  while(!quit)
+  {
+    int timeout = -1;
+
+    if(search.searching)
+    {
+      uint64_t now = timing_now();
+
+      timeout = (mock_rate == 0 || search.next <= now) ? 0 : (search.next - now + 999999) / 1000000;
+    }
+
+    struct pollfd fds = { .fd = STDIN_FILENO, .events = POLLIN };
+
+    int status = poll(&fds, 1, timeout);
+
+    if(status == -1 && errno != EINTR) break;
+
+    if(status > 0)
+    {
+      ssize_t size = reader_fill(&reader);
+
+      char* line;
+
+      while(!quit && reader_take(&reader, &line) > 0)
+      {
+        quit = mock_command(&search, line);
+      }
+
+      if(size <= 0 && !(size == -1 && errno == EINTR)) break;
+    }
+
+    if(search.searching) mock_emit(&search);
+  }
+
+  reader_free(&reader);
+
+  return 0;
+}
@@ -0,0 +1,428 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "../trace.h"
+#include "../socket.h"
+#include "../event.h"
+#include "../reader.h"
+#include "../timing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <signal.h>
+
+#define REPLAY_LINGER 5000000000ULL // How long to wait for the last responses, in nanoseconds
+
+/*
+ * Client of a recorded session, replaying its commands
+ */
+typedef struct
+{
+  int      sockfd;
+  event_t  event;
+  reader_t reader;
+  bool     closing;   // The recorded session has closed, once the search is done
+  bool     quitting;  // The recorded session has quit, once the search is done
+  uint64_t go_time;   // When the search in progress was sent, 0 if none
+  bool     answered;  // The search in progress has got a line
+} replay_session_t;
+
+/*
+ * Latencies of one kind, in nanoseconds
+ */
+typedef struct
+{
+  uint64_t* values;
+  size_t    count;
+  size_t    size;
+} replay_latencies_t;
+
+static replay_session_t** sessions = NULL;
+static size_t             session_count = 0;
+static size_t             open_count = 0;
+static size_t             opened = 0;
+
+static replay_latencies_t first_latencies = { 0 };
+static replay_latencies_t bestmove_latencies = { 0 };
+
+static size_t lines_sent     = 0;
+static size_t lines_received = 0;
+static size_t lines_recorded = 0;  // Engine lines in the trace, to compare with the received lines
+static size_t failures       = 0;
+
+/*
+ * Keep a latency, growing the array when it is full
+ */
+static void replay_latency_add(replay_latencies_t* latencies, uint64_t value)
+{
+  if(latencies->count == latencies->size)
+  {
+    size_t size = (latencies->size > 0) ? latencies->size * 2 : 1024;
+
+    uint64_t* values = realloc(latencies->values, sizeof(uint64_t) * size);
+
+    if(!values) return;
+
+    latencies->values = values;
+    latencies->size   = size;
+  }
+
+  latencies->values[latencies->count++] = value;
+}
+
+/*
+ * Compare latencies, for sorting
+ */
+static int replay_latency_compare(const void* first, const void* second)
+{
+  uint64_t a = *(const uint64_t*) first;
+  uint64_t b = *(const uint64_t*) second;
+
+  return (a > b) - (a < b);
+}
+
+/*
+ * Print the percentiles of latencies
+ */
+static void replay_latencies_print(const char* title, replay_latencies_t* latencies)
+{
+  if(latencies->count == 0)
+  {
+    printf("%s: no searches\n", title);
+
+    return;
+  }
+
+  qsort(latencies->values, latencies->count, sizeof(uint64_t), replay_latency_compare);
+
+  size_t count = latencies->count;
+
+  printf("%s: %ld searches, p50 %.1f us, p99 %.1f us, max %.1f us\n", title, (long) count,
+    TIMING_MICROS(latencies->values[count / 2]),
+    TIMING_MICROS(latencies->values[count * 99 / 100]),
+    TIMING_MICROS(latencies->values[count - 1]));
+}
+
+/*
+ * Close the client of session
+ */
+static void replay_close(replay_session_t* session)
+{
+  if(session->sockfd == -1) return;
+
+  event_del(&session->event);
+
+  reader_free(&session->reader);
+
+  socket_close(&session->sockfd, false);
+
+  open_count--;
+}
+
+/*
+ * Measure the latency of the search in progress, at its first line and its bestmove
+ */
+static void replay_line(replay_session_t* session, const char* line)
+{
+  lines_received++;
+
+  if(session->go_time == 0) return;
+
+  uint64_t latency = timing_now() - session->go_time;
+
+  if(!session->answered)
+  {
+    replay_latency_add(&first_latencies, latency);
+
+    session->answered = true;
+  }
+
+  if(strncmp(line, "bestmove", 8) == 0)
+  {
+    replay_latency_add(&bestmove_latencies, latency);
+
+    session->go_time = 0;
+
+    if(session->quitting && socket_write(session->sockfd, "quit\n", 5) != -1) lines_sent++;
+
+    if(session->closing) replay_close(session);
+  }
+}
+
+/*
+ * Read the output of the node to a session
+ */
+static void replay_readable(event_t* event, uint32_t events)
+{
+  replay_session_t* session = event->data;
+
+  ssize_t size = reader_fill(&session->reader);
+
+  if(size == -1 && (errno == EAGAIN || errno == EINTR)) return;
+
+  char* line;
+
+  while(session->sockfd != -1 && reader_take(&session->reader, &line) > 0)
+  {
+    replay_line(session, line);
+  }
+
+  if(size <= 0) replay_close(session);
+}
+
+/*
+ * Get the session with id, or create it
+ *
+ * RETURN (replay_session_t* session)
+ * - NULL | Failed to allocate session
+ */
+static replay_session_t* replay_session(uint32_t id)
+{
+  if(id >= session_count)
+  {
+    size_t count = (session_count > 0) ? session_count : 64;
+
+    while(count <= id) count *= 2;
+
+    replay_session_t** resized = realloc(sessions, sizeof(replay_session_t*) * count);
+
+    if(!resized) return NULL;
+
+    memset(resized + session_count, 0, sizeof(replay_session_t*) * (count - session_count));
+
+    sessions      = resized;
+    session_count = count;
+  }
+
+  if(!sessions[id])
+  {
+    sessions[id] = malloc(sizeof(replay_session_t));
+
+    if(!sessions[id]) return NULL;
+
+    *sessions[id] = (replay_session_t) { .sockfd = -1 };
+  }
+
+  return sessions[id];
+}
+
+/*
+ * Connect a client for a session that was opened in the recording
+ */
+static void replay_open(replay_session_t* session, const char* address, int port)
+{
+  opened++;
+
+  session->sockfd = socket_connect(address, port, false);
+
+  if(session->sockfd == -1)
+  {
+    failures++;
+
+    return;
+  }
+
+  if(reader_init(&session->reader, session->sockfd) != 0)
+  {
+    socket_close(&session->sockfd, false);
+
+    failures++;
+
+    return;
+  }
+
+  session->event = (event_t) { .fd = session->sockfd, .handler = replay_readable, .data = session };
+
+  event_add(&session->event, EPOLLIN);
+
+  open_count++;
+}
+
+/*
+ * Send a recorded command, and start timing it if it is a search
+ */
+static void replay_command(replay_session_t* session, const char* line, size_t length)
+{
+  if(session->sockfd == -1) return;
+
+  // Quitting before a search that is faster in the recording is done would cut it short
+  if(strncmp(line, "quit", 4) == 0 && session->go_time != 0)
+  {
+    session->quitting = true;
+
+    return;
+  }
+
+  // Framed commands, and a last line at end of file, were recorded without newline
+  bool newline = (length > 0 && line[length - 1] == '\n');
+
+  if(socket_write(session->sockfd, line, length) == -1 ||
+     (!newline && socket_write(session->sockfd, "\n", 1) == -1))
+  {
+    failures++;
+
+    replay_close(session);
+
+    return;
+  }
+
+  lines_sent++;
+
+  if(strncmp(line, "go", 2) == 0 && (length == 2 || isspace((unsigned char) line[2])))
+  {
+    session->go_time  = timing_now();
+    session->answered = false;
+  }
+}
+
+/*
+ * Handle the output of the node, until the time has come
+ */
+static void replay_wait(uint64_t until)
+{
+  uint64_t now;
+
+  while((now = timing_now()) < until)
+  {
+    // Rounded up, so that the wait doesn't end just before the time
+    int timeout = (until - now + 999999) / 1000000;
+
+    if(event_wait(timeout) == -1 && errno != EINTR) return;
+  }
+}
+
+/*
+ * Drive a node with the clients of a recorded trace
+ *
+ * The commands are sent at their recorded times, divided by speed,
+ * or as fast as possible with a speed of 0. The latency from every
+ * go command to the first line and to bestmove is measured, to compare
+ * the relay latency of builds under the same load
+ *
+ * usage: ucireplay TRACE PORT [SPEED] [ADDRESS]
+ */
+int main(int argc, char* argv[])
+{
+  if(argc < 3)
+  {
+    fprintf(stderr, "usage: %s TRACE PORT [SPEED] [ADDRESS]\n", argv[0]);
+
+    return 1;
+  }
+
+  int    port    = atoi(argv[2]);
+  double speed   = (argc > 3) ? atof(argv[3]) : 1.0;
+  char*  address = (argc > 4) ? argv[4] : "127.0.0.1";
+
+  // A node that closes a client is noticed by the read, not by a signal
+  signal(SIGPIPE, SIG_IGN);
+
+  trace_reader_t reader;
+
+  int status = trace_reader_open(&reader, argv[1]);
+
+  if(status != 0)
+  {
+    error_print("Failed to read trace (%s): %s", argv[1], (status == 2) ? "not a trace" : strerror(errno));
+
+    return 1;
+  }
+
+  if(event_init() != 0)
+  {
+    trace_reader_close(&reader);
+
+    return 2;
+  }
+
+  uint64_t start = timing_now();
+
+  trace_record_t record;
+
+  uint64_t recorded = 0;
+
+  while((status = trace_next(&reader, &record)) == 0)
+  {
+    if(speed > 0) replay_wait(start + (uint64_t) (record.time / speed));
+
+    // Give the node the chance to answer between commands, even as fast as possible
+    else event_wait(0);
+
+    recorded = record.time;
+
+    replay_session_t* session = replay_session(record.session);
+
+    if(!session)
+    {
+      failures++;
+
+      continue;
+    }
+
+    switch(record.direction)
+    {
+      case TRACE_OPEN:
+        replay_open(session, address, port);
+        break;
+
+      case TRACE_CLIENT:
+        replay_command(session, record.line, record.length);
+        break;
+
+      case TRACE_ENGINE:
+        lines_recorded++;
+        break;
+
+      case TRACE_CLOSE:
+        // A search that is faster in the recording is waited for
+        if(session->go_time == 0) replay_close(session);
+
+        else session->closing = true;
+        break;
+    }
+  }
+
+  if(status == 2) error_print("The trace is cut short");
+
+  uint64_t linger = timing_now() + REPLAY_LINGER;
+
+  while(open_count > 0 && timing_now() < linger)
+  {
+    if(event_wait(100) == -1 && errno != EINTR) break;
+  }
+
+  uint64_t duration = timing_now() - start;
+
+  for(size_t index = 0; index < session_count; index++)
+  {
+    if(!sessions[index]) continue;
+
+    replay_close(sessions[index]);
+
+    free(sessions[index]);
+  }
+
+  printf("sessions %ld, sent %ld lines, received %ld lines (%ld engine lines recorded), failures %ld\n",
+    (long) opened, (long) lines_sent, (long) lines_received, (long) lines_recorded, (long) failures);
+
+  printf("duration %.3f s, recorded %.3f s\n", (double) duration / 1e9, (double) recorded / 1e9);
+
+  replay_latencies_print("go -> first line", &first_latencies);
+
+  replay_latencies_print("go -> bestmove", &bestmove_latencies);
+
+  free(sessions);
+
+  free(first_latencies.values);
+  free(bestmove_latencies.values);
+
+  event_free();
+
+  trace_reader_close(&reader);
+
+  return (failures > 0) ? 3 : 0;
+}
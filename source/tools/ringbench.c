@@ -0,0 +1,261 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#include "../ring.h"
+#include "../timing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define BENCH_LINE   "info depth 24 seldepth 31 multipv 1 score cp 34 nodes 18234112 nps 1523400 pv e2e4 e7e5 g1f3\n"
+#define BENCH_BURST  20    // Lines an engine typically writes at once
+#define BENCH_SLOT   128
+#define BENCH_QUEUE  1024
+
+/*
+ * Queue protected by a mutex, for comparison
+ */
+typedef struct
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t  not_empty;
+  pthread_cond_t  not_full;
+  char            slots[BENCH_QUEUE][BENCH_SLOT];
+  size_t          lengths[BENCH_QUEUE];
+  size_t          head;
+  size_t          count;
+  size_t          wakeups;
+} queue_t;
+
+typedef struct
+{
+  bool      ring;     // Use the ring, instead of the queue
+  ring_t    ring_queue;
+  queue_t   queue;
+  size_t    lines;
+  size_t    rate;     // Lines per second (0 for as fast as possible)
+  uint64_t* latencies;
+} bench_t;
+
+/*
+ * Push a line to the queue, waiting while it is full
+ */
+static void queue_push(queue_t* queue, const char* line, size_t length)
+{
+  pthread_mutex_lock(&queue->mutex);
+
+  while(queue->count == BENCH_QUEUE) pthread_cond_wait(&queue->not_full, &queue->mutex);
+
+  size_t index = (queue->head + queue->count) % BENCH_QUEUE;
+
+  memcpy(queue->slots[index], line, length);
+
+  queue->lengths[index] = length;
+
+  // Signal like the ring, only when the queue was empty
+  if(queue->count++ == 0)
+  {
+    pthread_cond_signal(&queue->not_empty);
+
+    queue->wakeups++;
+  }
+
+  pthread_mutex_unlock(&queue->mutex);
+}
+
+/*
+ * Pop a line from the queue, waiting while it is empty
+ */
+static size_t queue_pop(queue_t* queue, char* line)
+{
+  pthread_mutex_lock(&queue->mutex);
+
+  while(queue->count == 0) pthread_cond_wait(&queue->not_empty, &queue->mutex);
+
+  size_t length = queue->lengths[queue->head];
+
+  memcpy(line, queue->slots[queue->head], length);
+
+  queue->head = (queue->head + 1) % BENCH_QUEUE;
+
+  if(queue->count-- == BENCH_QUEUE) pthread_cond_signal(&queue->not_full);
+
+  pthread_mutex_unlock(&queue->mutex);
+
+  return length;
+}
+
+/*
+ * Consume lines, and record the latency from push to pop of every line
+ */
+static void* bench_consumer(void* arg)
+{
+  bench_t* bench = arg;
+
+  char line[BENCH_SLOT];
+
+  for(size_t index = 0; index < bench->lines; index++)
+  {
+    uint64_t pushed;
+
+    if(bench->ring)
+    {
+      ring_line_t taken;
+
+      while(!ring_pop(&bench->ring_queue, &taken)) ring_wait(&bench->ring_queue);
+
+      memcpy(&pushed, taken.line, sizeof(pushed));
+
+      ring_done(&bench->ring_queue, &taken);
+    }
+    else
+    {
+      queue_pop(&bench->queue, line);
+
+      memcpy(&pushed, line, sizeof(pushed));
+    }
+
+    bench->latencies[index] = timing_now() - pushed;
+  }
+
+  return NULL;
+}
+
+/*
+ * Produce lines in bursts, paced to the rate of the bench
+ */
+static void bench_producer(bench_t* bench)
+{
+  char line[BENCH_SLOT];
+
+  size_t length = strlen(BENCH_LINE);
+
+  memcpy(line, BENCH_LINE, length);
+
+  uint64_t start = timing_now();
+
+  for(size_t index = 0; index < bench->lines; index++)
+  {
+    if(bench->rate > 0 && index % BENCH_BURST == 0)
+    {
+      uint64_t due = start + index * 1000000000ULL / bench->rate;
+
+      while(timing_now() < due) sched_yield();
+    }
+
+    uint64_t now = timing_now();
+
+    // The push time replaces the start of the line
+    memcpy(line, &now, sizeof(now));
+
+    if(bench->ring)
+    {
+      while(ring_push(&bench->ring_queue, line, length) != 0) sched_yield();
+    }
+    else queue_push(&bench->queue, line, length);
+  }
+}
+
+/*
+ * Compare latencies, for sorting
+ */
+static int latency_compare(const void* first, const void* second)
+{
+  uint64_t a = *(const uint64_t*) first;
+  uint64_t b = *(const uint64_t*) second;
+
+  return (a > b) - (a < b);
+}
+
+/*
+ * Run one benchmark, and print its results on a single line
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to set up the benchmark
+ */
+static int bench_run(bool ring, size_t lines, size_t rate)
+{
+  bench_t* bench = calloc(1, sizeof(bench_t));
+
+  if(!bench) return 1;
+
+  *bench = (bench_t) { .ring = ring, .lines = lines, .rate = rate };
+
+  bench->latencies = malloc(sizeof(uint64_t) * lines);
+
+  if(!bench->latencies || ring_init(&bench->ring_queue, BENCH_QUEUE, 65536, 8) != 0)
+  {
+    free(bench->latencies);
+    free(bench);
+
+    return 1;
+  }
+
+  pthread_mutex_init(&bench->queue.mutex, NULL);
+  pthread_cond_init(&bench->queue.not_empty, NULL);
+  pthread_cond_init(&bench->queue.not_full, NULL);
+
+  pthread_t consumer;
+
+  uint64_t start = timing_now();
+
+  pthread_create(&consumer, NULL, bench_consumer, bench);
+
+  bench_producer(bench);
+
+  pthread_join(consumer, NULL);
+
+  uint64_t elapsed = timing_now() - start;
+
+  qsort(bench->latencies, lines, sizeof(uint64_t), latency_compare);
+
+  size_t wakeups = ring ? bench->ring_queue.wakeups : bench->queue.wakeups;
+
+  printf("queue=%s lines=%ld rate=%ld ns_per_line=%.1f lines_per_sec=%.0f "
+    "latency_p50_ns=%ld latency_p99_ns=%ld wakeups=%ld\n",
+    ring ? "ring" : "mutex", (long) lines, (long) rate,
+    (double) elapsed / lines, lines / ((double) elapsed / 1e9),
+    (long) bench->latencies[lines / 2], (long) bench->latencies[lines * 99 / 100], (long) wakeups);
+
+  ring_free(&bench->ring_queue);
+
+  pthread_mutex_destroy(&bench->queue.mutex);
+  pthread_cond_destroy(&bench->queue.not_empty);
+  pthread_cond_destroy(&bench->queue.not_full);
+
+  free(bench->latencies);
+  free(bench);
+
+  return 0;
+}
+
+/*
+ * Benchmark the ring against the mutex queue, both as fast as possible
+ * and at a rate of engine output, written in bursts
+ *
+ * usage: ringbench [LINES] [RATE]
+ */
+int main(int argc, char* argv[])
+{
+  size_t lines = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000000;
+  size_t rate  = (argc > 2) ? strtoul(argv[2], NULL, 10) : 100000;
+
+  if(lines == 0) return 1;
+
+  size_t rates[] = { 0, rate };
+
+  for(int index = 0; index < 2; index++)
+  {
+    if(bench_run(true,  lines, rates[index]) != 0) return 2;
+
+    if(bench_run(false, lines, rates[index]) != 0) return 2;
+  }
+
+  return 0;
+}
@@ -0,0 +1,324 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "trace.h"
+
+#define TRACE_HEADER 32 // Most bytes of the varints of a record
+
+/*
+ * Write all of data to fd, even if it takes several writes
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to write
+ */
+static int trace_write_all(int fd, const char* data, size_t length)
+{
+  while(length > 0)
+  {
+    ssize_t size = write(fd, data, length);
+
+    if(size == -1)
+    {
+      if(errno == EINTR) continue;
+
+      return -1;
+    }
+
+    data   += size;
+    length -= size;
+  }
+
+  return 0;
+}
+
+/*
+ * Write the buffered records to the file
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to write
+ */
+static int trace_flush(trace_t* trace)
+{
+  int status = trace_write_all(trace->fd, trace->buffer, trace->length);
+
+  if(status == -1 && trace->debug) error_print("Failed to write trace: %s", strerror(errno));
+
+  trace->length = 0;
+
+  return status;
+}
+
+/*
+ * Create a trace file, and start recording
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate buffer
+ * - 2 | Failed to create file
+ * - 3 | Failed to write the start of the file
+ */
+int trace_open(trace_t* trace, const char* path, bool debug)
+{
+  *trace = (trace_t) { .fd = -1, .debug = debug };
+
+  trace->buffer = malloc(TRACE_BUFFER);
+
+  if(!trace->buffer) return 1;
+
+  trace->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if(trace->fd == -1)
+  {
+    if(debug) error_print("Failed to create trace (%s): %s", path, strerror(errno));
+
+    trace_close(trace);
+
+    return 2;
+  }
+
+  if(trace_write_all(trace->fd, TRACE_MAGIC, strlen(TRACE_MAGIC)) == -1)
+  {
+    trace_close(trace);
+
+    return 3;
+  }
+
+  trace->start = timing_now();
+
+  if(debug) info_print("Recording to trace (%s)", path);
+
+  return 0;
+}
+
+/*
+ * Write the buffered records, and close the trace
+ */
+void trace_close(trace_t* trace)
+{
+  if(trace->fd != -1)
+  {
+    if(trace->length > 0) trace_flush(trace);
+
+    close(trace->fd);
+
+    if(trace->debug) info_print("trace: %ld records, %ld sessions, %ld lost",
+      (long) trace->records, (long) trace->sessions, (long) trace->failed);
+  }
+
+  free(trace->buffer);
+
+  trace->buffer = NULL;
+  trace->fd     = -1;
+}
+
+/*
+ * Hand out the id of a new session
+ */
+uint32_t trace_session(trace_t* trace)
+{
+  return ++trace->sessions;
+}
+
+/*
+ * Append a number in 7 bit groups, the last without the high bit
+ *
+ * RETURN (size_t length)
+ */
+static size_t trace_varint(char* buffer, uint64_t number)
+{
+  size_t length = 0;
+
+  while(number >= 0x80)
+  {
+    buffer[length++] = (char) (number | 0x80);
+
+    number >>= 7;
+  }
+
+  buffer[length++] = (char) number;
+
+  return length;
+}
+
+/*
+ * Record a line, or the opening or closing of a session
+ *
+ * The records are buffered, and written in blocks
+ */
+void trace_record(trace_t* trace, uint32_t session, trace_direction_t direction, const char* line, size_t length)
+{
+  if(trace->fd == -1) return;
+
+  uint64_t time = timing_now() - trace->start;
+
+  char header[TRACE_HEADER];
+
+  size_t header_length = trace_varint(header, time - trace->last);
+
+  header_length += trace_varint(header + header_length, session);
+
+  header_length += trace_varint(header + header_length, ((uint64_t) length << 2) | direction);
+
+  trace->last = time;
+
+  if(trace->length + header_length + length > TRACE_BUFFER)
+  {
+    if(trace_flush(trace) == -1) trace->failed++;
+  }
+
+  if(header_length + length > TRACE_BUFFER)
+  {
+    // Too long to be buffered, so it is written right away
+    if(trace_write_all(trace->fd, header, header_length) == -1 ||
+       trace_write_all(trace->fd, line, length) == -1)
+    {
+      trace->failed++;
+    }
+  }
+  else
+  {
+    memcpy(trace->buffer + trace->length, header, header_length);
+
+    memcpy(trace->buffer + trace->length + header_length, line, length);
+
+    trace->length += header_length + length;
+  }
+
+  trace->records++;
+}
+
+/*
+ * Map a trace into memory, to read its records
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to open or map trace
+ * - 2 | Not a trace
+ */
+int trace_reader_open(trace_reader_t* reader, const char* path)
+{
+  *reader = (trace_reader_t) { 0 };
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+  if(fd == -1) return 1;
+
+  struct stat status;
+
+  if(fstat(fd, &status) == -1)
+  {
+    close(fd);
+
+    return 1;
+  }
+
+  if(status.st_size < (off_t) strlen(TRACE_MAGIC))
+  {
+    close(fd);
+
+    return 2;
+  }
+
+  void* data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  close(fd);
+
+  if(data == MAP_FAILED) return 1;
+
+  // The records are read once, from the start to the end
+  madvise(data, status.st_size, MADV_SEQUENTIAL);
+
+  reader->data   = data;
+  reader->size   = status.st_size;
+  reader->offset = strlen(TRACE_MAGIC);
+
+  if(memcmp(data, TRACE_MAGIC, strlen(TRACE_MAGIC)) != 0)
+  {
+    trace_reader_close(reader);
+
+    return 2;
+  }
+
+  return 0;
+}
+
+/*
+ * Unmap the trace
+ */
+void trace_reader_close(trace_reader_t* reader)
+{
+  if(reader->data) munmap((void*) reader->data, reader->size);
+
+  reader->data = NULL;
+}
+
+/*
+ * Read a number in 7 bit groups
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | The number is cut short
+ */
+static int trace_reader_varint(trace_reader_t* reader, uint64_t* number)
+{
+  *number = 0;
+
+  for(int shift = 0; shift < 64; shift += 7)
+  {
+    if(reader->offset >= reader->size) return 1;
+
+    unsigned char byte = reader->data[reader->offset++];
+
+    *number |= (uint64_t) (byte & 0x7f) << shift;
+
+    if(!(byte & 0x80)) return 0;
+  }
+
+  return 1;
+}
+
+/*
+ * Read the next record of the trace
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | End of trace
+ * - 2 | The last record is cut short, the recording was interrupted
+ */
+int trace_next(trace_reader_t* reader, trace_record_t* record)
+{
+  if(reader->offset >= reader->size) return 1;
+
+  uint64_t delta, session, value;
+
+  if(trace_reader_varint(reader, &delta)   != 0 ||
+     trace_reader_varint(reader, &session) != 0 ||
+     trace_reader_varint(reader, &value)   != 0)
+  {
+    return 2;
+  }
+
+  size_t length = value >> 2;
+
+  if(length > reader->size - reader->offset) return 2;
+
+  reader->time += delta;
+
+  *record = (trace_record_t)
+  {
+    .time      = reader->time,
+    .session   = session,
+    .direction = value & 0x3,
+    .line      = (const char*) reader->data + reader->offset,
+    .length    = length
+  };
+
+  reader->offset += length;
+
+  return 0;
+}
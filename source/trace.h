@@ -0,0 +1,96 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "debug.h"
+#include "timing.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TRACE_MAGIC  "UCITRACE"
+#define TRACE_BUFFER 65536   // Records are written to the file in blocks of this size
+
+/*
+ * What a record tells about its session
+ */
+typedef enum
+{
+  TRACE_OPEN,    // The client has connected
+  TRACE_CLIENT,  // Line from client to engine
+  TRACE_ENGINE,  // Line from engine to client
+  TRACE_CLOSE    // The session has been closed
+} trace_direction_t;
+
+/*
+ * Recording of the lines relayed by a node
+ *
+ * Every record is the time since the previous record in nanoseconds,
+ * the session id, and the length and direction of the line, as varints,
+ * followed by the line. The file starts with TRACE_MAGIC
+ */
+typedef struct
+{
+  int      fd;
+  char*    buffer;
+  size_t   length;
+  uint64_t start;     // When the recording started
+  uint64_t last;      // Time of the last record, since start
+  uint32_t sessions;  // Session ids that have been handed out
+  size_t   records;
+  size_t   failed;    // Records lost because the file couldn't be written
+  bool     debug;
+} trace_t;
+
+/*
+ * Record read from a trace
+ */
+typedef struct
+{
+  uint64_t          time;    // Nanoseconds since the recording started
+  uint32_t          session;
+  trace_direction_t direction;
+  const char*       line;    // Points into the mapped trace
+  size_t            length;
+} trace_record_t;
+
+/*
+ * Trace mapped into memory for reading
+ */
+typedef struct
+{
+  const unsigned char* data;
+  size_t               size;
+  size_t               offset;
+  uint64_t             time;
+} trace_reader_t;
+
+extern int      trace_open(trace_t* trace, const char* path, bool debug);
+
+extern void     trace_close(trace_t* trace);
+
+extern uint32_t trace_session(trace_t* trace);
+
+extern void     trace_record(trace_t* trace, uint32_t session, trace_direction_t direction, const char* line, size_t length);
+
+
+extern int      trace_reader_open(trace_reader_t* reader, const char* path);
+
+extern void     trace_reader_close(trace_reader_t* reader);
+
+extern int      trace_next(trace_reader_t* reader, trace_record_t* record);
+
+#endif // TRACE_H
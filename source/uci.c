@@ -0,0 +1,304 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#include "uci.h"
+
+/*
+ * Find a whole word token in the string between start and end
+ *
+ * RETURN (const char* token)
+ * - NULL | The token was not found
+ */
+static const char* uci_token(const char* start, const char* end, const char* token)
+{
+  size_t length = strlen(token);
+
+  for(const char* word = start; word + length <= end; word++)
+  {
+    if(word > start && !isspace((unsigned char) word[-1])) continue;
+
+    if(word + length < end && !isspace((unsigned char) word[length])) continue;
+
+    if(strncmp(word, token, length) == 0) return word;
+  }
+
+  return NULL;
+}
+
+/*
+ * Get the words after a token, until the first of the stop tokens
+ *
+ * RETURN (const char* words)
+ * - NULL | The token was not found
+ */
+static const char* uci_words(const char* start, const char* end, const char* token,
+  const char* stops[], size_t* length)
+{
+  const char* words = uci_token(start, end, token);
+
+  if(!words) return NULL;
+
+  words += strlen(token);
+
+  const char* words_end = end;
+
+  for(int index = 0; stops[index]; index++)
+  {
+    const char* stop = uci_token(words, words_end, stops[index]);
+
+    if(stop) words_end = stop;
+  }
+
+  while(words < words_end && isspace((unsigned char) *words)) words++;
+
+  while(words_end > words && isspace((unsigned char) words_end[-1])) words_end--;
+
+  *length = words_end - words;
+
+  return words;
+}
+
+/*
+ * Copy length bytes to a new null terminated string
+ */
+static char* uci_strndup(const char* string, size_t length)
+{
+  char* copy = malloc(length + 1);
+
+  if(!copy) return NULL;
+
+  memcpy(copy, string, length);
+
+  copy[length] = '\0';
+
+  return copy;
+}
+
+/*
+ * Parse an option line, and add the option to the known options
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Malformed option line
+ * - 2 | Failed to allocate option
+ */
+static int uci_option_add(uci_t* uci, const char* line, size_t length)
+{
+  const char* end = line + length;
+
+  const char* name_stops[]    = { "type", NULL };
+  const char* type_stops[]    = { "default", "min", "max", "var", NULL };
+  const char* default_stops[] = { "min", "max", "var", NULL };
+
+  size_t name_length, type_length, fallback_length;
+
+  const char* name = uci_words(line, end, "name", name_stops, &name_length);
+  const char* type = uci_words(line, end, "type", type_stops, &type_length);
+
+  if(!name || !type || name_length == 0) return 1;
+
+  const char* fallback = uci_words(line, end, "default", default_stops, &fallback_length);
+
+  uci_option_t* options = realloc(uci->options, sizeof(uci_option_t) * (uci->count + 1));
+
+  if(!options) return 2;
+
+  uci->options = options;
+
+  uci_option_t* option = &uci->options[uci->count];
+
+  *option = (uci_option_t) { 0 };
+
+  if(!(option->name = uci_strndup(name, name_length))) return 2;
+
+  // Buttons only trigger an action, and have no value to compare
+  if(strncmp(type, "button", type_length) != 0)
+  {
+    if(!fallback) fallback_length = 0;
+
+    option->fallback = uci_strndup(fallback ? fallback : "", fallback_length);
+    option->value    = uci_strndup(fallback ? fallback : "", fallback_length);
+
+    if(!option->fallback || !option->value)
+    {
+      free(option->name);
+      free(option->fallback);
+      free(option->value);
+
+      return 2;
+    }
+  }
+
+  uci->count++;
+
+  return 0;
+}
+
+/*
+ * Capture a line of the uci answer of the engine
+ *
+ * The id and option lines are stored as they were sent,
+ * and the options are parsed to track their values
+ *
+ * RETURN (int status)
+ * - 0 | Success, or the line is not part of the answer
+ * - 1 | Failed to allocate memory
+ */
+int uci_capture(uci_t* uci, const char* line, size_t length)
+{
+  if(uci->known) return 0;
+
+  bool option = (strncmp(line, "option ", 7) == 0);
+
+  if(!option && strncmp(line, "id ", 3) != 0) return 0;
+
+  if(option && uci_option_add(uci, line, length) == 2) return 1;
+
+  if(uci->length + length > uci->size)
+  {
+    size_t size = (uci->size > 0) ? uci->size : 1024;
+
+    while(size < uci->length + length) size *= 2;
+
+    char* lines = realloc(uci->lines, size);
+
+    if(!lines) return 1;
+
+    uci->lines = lines;
+    uci->size  = size;
+  }
+
+  memcpy(uci->lines + uci->length, line, length);
+
+  uci->length += length;
+
+  return 0;
+}
+
+/*
+ * Free the captured answer and the options
+ */
+void uci_free(uci_t* uci)
+{
+  for(size_t index = 0; index < uci->count; index++)
+  {
+    free(uci->options[index].name);
+    free(uci->options[index].fallback);
+    free(uci->options[index].value);
+  }
+
+  free(uci->options);
+
+  free(uci->lines);
+
+  *uci = (uci_t) { 0 };
+}
+
+/*
+ * Find option by name, which is not case sensitive
+ *
+ * RETURN (uci_option_t* option)
+ * - NULL | The engine has no such option
+ */
+uci_option_t* uci_option_find(uci_t* uci, const char* name, size_t length)
+{
+  for(size_t index = 0; index < uci->count; index++)
+  {
+    uci_option_t* option = &uci->options[index];
+
+    if(strlen(option->name) == length && strncasecmp(option->name, name, length) == 0)
+    {
+      return option;
+    }
+  }
+
+  return NULL;
+}
+
+/*
+ * Check if the engine already has value for option
+ */
+bool uci_option_equal(uci_option_t* option, const char* value, size_t length)
+{
+  if(!option->value) return false;
+
+  return strlen(option->value) == length && strncmp(option->value, value, length) == 0;
+}
+
+/*
+ * Remember that the engine has been given value for option
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate value
+ */
+int uci_option_set(uci_option_t* option, const char* value, size_t length)
+{
+  if(!option->value) return 0;
+
+  char* copy = uci_strndup(value, length);
+
+  if(!copy) return 1;
+
+  free(option->value);
+
+  option->value = copy;
+
+  return 0;
+}
+
+/*
+ * Check if line is command, without any arguments
+ */
+bool uci_command(const char* line, const char* command)
+{
+  size_t length = strlen(command);
+
+  if(strncmp(line, command, length) != 0) return false;
+
+  for(line += length; *line; line++)
+  {
+    if(!isspace((unsigned char) *line)) return false;
+  }
+
+  return true;
+}
+
+/*
+ * Parse a setoption command, without modifying it
+ *
+ * The value is empty if the command has no value
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Not a setoption command, or it has no name
+ */
+int uci_setoption_parse(const char* line, size_t length,
+  const char** name, size_t* name_length,
+  const char** value, size_t* value_length)
+{
+  if(strncmp(line, "setoption ", 10) != 0) return 1;
+
+  const char* end = line + length;
+
+  const char* name_stops[]  = { "value", NULL };
+  const char* value_stops[] = { NULL };
+
+  *name = uci_words(line, end, "name", name_stops, name_length);
+
+  if(!*name || *name_length == 0) return 1;
+
+  *value = uci_words(*name + *name_length, end, "value", value_stops, value_length);
+
+  if(!*value)
+  {
+    *value = end;
+
+    *value_length = 0;
+  }
+
+  return 0;
+}
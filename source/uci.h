@@ -0,0 +1,60 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#ifndef UCI_H
+#define UCI_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+/*
+ * Engine option, from an option line of the uci answer
+ *
+ * Buttons have no value, and are always sent to the engine
+ */
+typedef struct
+{
+  char* name;
+  char* fallback; // Default value (NULL for buttons)
+  char* value;    // Value the engine currently has (NULL for buttons)
+} uci_option_t;
+
+/*
+ * The uci answer of an engine, captured once and answered from memory
+ */
+typedef struct
+{
+  char*         lines;   // The id and option lines, as the engine sent them
+  size_t        length;
+  size_t        size;
+  uci_option_t* options;
+  size_t        count;
+  bool          known;   // The engine has answered uciok
+} uci_t;
+
+extern int           uci_capture(uci_t* uci, const char* line, size_t length);
+
+extern void          uci_free(uci_t* uci);
+
+
+extern uci_option_t* uci_option_find(uci_t* uci, const char* name, size_t length);
+
+extern bool          uci_option_equal(uci_option_t* option, const char* value, size_t length);
+
+extern int           uci_option_set(uci_option_t* option, const char* value, size_t length);
+
+
+extern bool          uci_command(const char* line, const char* command);
+
+extern int           uci_setoption_parse(const char* line, size_t length,
+                       const char** name, size_t* name_length,
+                       const char** value, size_t* value_length);
+
+#endif // UCI_H
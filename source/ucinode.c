@@ -1,7 +1,7 @@
 /*
  * Written by Hampus Fridholm
  *
- * Last updated: 2024-09-08
+ * Last updated: 2026-10-17
  */
 
 #define DEFAULT_ADDRESS "127.0.0.1"
@@ -10,20 +10,28 @@
 #include "debug.h"
 #include "socket.h"
 #include "fifo.h"
-#include "thread.h"
+#include "event.h"
+#include "uring.h"
+#include "engine.h"
+#include "session.h"
+#include "process.h"
+#include "cache.h"
+#include "store.h"
+#include "proxy.h"
+#include "book.h"
+#include "metrics.h"
+#include "trace.h"
+#include "listener.h"
+#include "admission.h"
 
 #include <stdlib.h>
 #include <signal.h>
 #include <argp.h>
+#include <fcntl.h>
+#include <unistd.h>
 
-pthread_t stdin_thread;
-bool      stdin_running = false;
-
-pthread_t stdout_thread;
-bool      stdout_running = false;
-
-int sockfd = -1;
-int servfd = -1;
+// The listening sockets, accepted by the event loop or by threads of their own
+listener_t listener = { 0 };
 
 int stdin_fifo  = -1;
 int stdout_fifo = -1;
@@ -32,8 +40,50 @@ bool fifo_reverse = false;
 
 bool node_running = true;
 
+bool node_interrupted = false;
+
+// The engines serving the clients, either spawned by the node or one engine
+// behind the fifos. The array is never moved, because connections are
+// referenced by the event loop
+engine_t*  engines   = NULL;
+process_t* processes = NULL;
+
+int engine_count = 0;
+
+// Sessions waiting for an engine, in order of priority and arrival
+admission_t admission = { 0 };
+
+// Sessions that were refused by a full admission queue, and are closed after the event batch
+session_t* refused_sessions = NULL;
+
+// Clients multiplexing logical sessions, which don't wait for engines themselves
+session_t* carrier_sessions = NULL;
+
+// Sessions that have been closed, and can be freed after the event batch
+session_t* closed_sessions = NULL;
+
+// Results of searches, shared by the sessions (empty budget if disabled)
+cache_t cache = { 0 };
+
+// Results of searches on disk, shared with other nodes (closed if disabled)
+store_t store = { .fd = -1 };
+
+// Opening book, answering searches of book positions (closed if disabled)
+book_t book = { .fd = -1 };
+
+// Recording of the lines relayed to and from the clients (closed if disabled)
+trace_t trace = { .fd = -1 };
+
+// Backends the clients are routed to, when the node is a proxy (no backends otherwise)
+proxy_t proxy = { 0 };
+
+// The load that was last reported to the clients that asked for load reports
+size_t load_busy    = 0;
+size_t load_waiting = 0;
+bool   load_stale   = false; // A client has asked for reports since the last one
 
-static char doc[] = "ucinode - network server hosting UCI chess engine";
+
+static char doc[] = "ucinode - network server hosting UCI chess engines";
 
 static char args_doc[] = "";
 
@@ -43,7 +93,26 @@ static struct argp_option options[] =
   { "stdout",  'o', "FIFO",    0, "Stdout FIFO" },
   { "address", 'a', "ADDRESS", 0, "Network address" },
   { "port",    'p', "PORT",    0, "Network port" },
-  { "debug",   'd', 0,         0, "Print debug messages" },
+  { "debug",   'd', 0,         0, "Print debug messages, like --log debug" },
+  { "log",     'l', "LEVEL",   0, "Log level: off, error, info or debug, changed by SIGUSR1 and SIGUSR2 (default: no logging)" },
+  { "splice",  's', 0,         0, "Relay engine output with splice" },
+  { "backend", 'b', "BACKEND", 0, "I/O backend: epoll (default) or uring" },
+  { "engine",  'e', "COMMAND", 0, "Spawn engines from command, instead of using FIFOs" },
+  { "engines", 'n', "COUNT",   0, "Number of spawned engines (default: number of cores)" },
+  { "cache",   'c', "MB",      0, "Cache analysis results, in a memory budget" },
+  { "store",   'f', "FILE",    0, "Store analysis results in a file, shared by nodes" },
+  { "book",    'k', "FILE",    0, "Answer searches of book positions from a Polyglot book" },
+  { "weighting",'w', "WEIGHTING", 0, "Book move choice: best (default) or weighted" },
+  { "batch",   'B', "COUNT",   0, "Most positions a batch analyzes at once (default: number of engines)" },
+  { "upstream",'u', "ADDRESS:PORT", 0, "Proxy clients to the least loaded of backend nodes (repeatable)" },
+  { "metrics", 'm', "PORT",    0, "Serve Prometheus metrics on a port of its own" },
+  { "record",  'r', "FILE",    0, "Record the relayed lines to a trace file, for ucireplay" },
+  { "backlog", 'q', "COUNT",   0, "Most clients waiting to be accepted (default: 1024)" },
+  { "acceptors",'A', "COUNT",  0, "Accept clients with threads, on sockets sharing the port with SO_REUSEPORT" },
+  { "depth",   'D', "COUNT",   0, "Most sessions waiting for an engine, others are refused (default: no limit)" },
+  { "deadline",'W', "MS",      0, "Longest wait for an engine, before the session is closed (default: no limit)" },
+  { "sessions",'S', "COUNT",   0, "Most logical sessions a multiplexing client has open (default: 1024)" },
+  { "priority",'P', "ADDRESS[/BITS]=CLASS", 0, "Priority class of the clients from a network, from 0 (default) to 3 (repeatable)" },
   { 0 }
 };
 
@@ -54,6 +123,27 @@ struct args
   char*  address;
   int    port;
   bool   debug;
+  bool   splice;
+  bool   uring;
+  char*  engine;
+  int    engines;
+  size_t cache;
+  char*  store;
+  int    batch;
+  char*  book;
+  bool   weighted;
+  char** upstreams;
+  int    upstream_count;
+  int    metrics;
+  char*  record;
+  int    backlog;
+  int    acceptors;
+  int    depth;
+  int    deadline;
+  int    sessions;
+  char** priorities;
+  int    priority_count;
+  log_level_t level;
 };
 
 struct args args =
@@ -62,7 +152,17 @@ struct args args =
   .stdout_path = NULL,
   .address     = NULL,
   .port        = -1,
-  .debug       = false
+  .debug       = false, // Without -d or --log, nothing is logged, or even queued for the log
+  .level       = LOG_OFF,
+  .splice      = false,
+  .uring       = false,
+  .engine      = NULL,
+  .engines     = -1,
+  .cache       = 0,
+  .store       = NULL,
+  .backlog     = LISTENER_BACKLOG,
+  .acceptors   = 0,
+  .sessions    = MUX_SESSIONS
 };
 
 /*
@@ -98,6 +198,133 @@ static error_t opt_parse(int key, char* arg, struct argp_state* state)
 
     case 'd':
       args->debug = true;
+      args->level = LOG_DEBUG;
+      break;
+
+    case 'l':
+      args->debug = true;
+
+      if(strcmp(arg, "off") == 0)        args->level = LOG_OFF;
+
+      else if(strcmp(arg, "error") == 0) args->level = LOG_ERROR;
+
+      else if(strcmp(arg, "info") == 0)  args->level = LOG_INFO;
+
+      else if(strcmp(arg, "debug") == 0) args->level = LOG_DEBUG;
+
+      else argp_error(state, "Unknown log level: %s", arg);
+      break;
+
+    case 's':
+      args->splice = true;
+      break;
+
+    case 'b':
+      if(strcmp(arg, "uring") == 0)      args->uring = true;
+
+      else if(strcmp(arg, "epoll") == 0) args->uring = false;
+
+      else argp_error(state, "Unknown backend: %s", arg);
+      break;
+
+    case 'e':
+      args->engine = arg;
+      break;
+
+    case 'n':
+      int engines = atoi(arg);
+
+      if(engines > 0) args->engines = engines;
+      break;
+
+    case 'c':
+      long cache = atol(arg);
+
+      if(cache > 0) args->cache = (size_t) cache * 1024 * 1024;
+      break;
+
+    case 'f':
+      args->store = arg;
+      break;
+
+    case 'k':
+      args->book = arg;
+      break;
+
+    case 'w':
+      if(strcmp(arg, "weighted") == 0)  args->weighted = true;
+
+      else if(strcmp(arg, "best") == 0) args->weighted = false;
+
+      else argp_error(state, "Unknown weighting: %s", arg);
+      break;
+
+    case 'B':
+      int batch = atoi(arg);
+
+      if(batch > 0) args->batch = batch;
+      break;
+
+    case 'u':
+      char** upstreams = realloc(args->upstreams, (args->upstream_count + 1) * sizeof(char*));
+
+      if(!upstreams) argp_failure(state, 1, ENOMEM, "Failed to add upstream");
+
+      upstreams[args->upstream_count++] = arg;
+
+      args->upstreams = upstreams;
+      break;
+
+    case 'r':
+      args->record = arg;
+      break;
+
+    case 'm':
+      int metrics = atoi(arg);
+
+      if(metrics > 0) args->metrics = metrics;
+      break;
+
+    case 'q':
+      int backlog = atoi(arg);
+
+      if(backlog > 0) args->backlog = backlog;
+      break;
+
+    case 'A':
+      int acceptors = atoi(arg);
+
+      if(acceptors > LISTENER_ACCEPTORS) argp_error(state, "At most %d acceptors", LISTENER_ACCEPTORS);
+
+      if(acceptors > 0) args->acceptors = acceptors;
+      break;
+
+    case 'D':
+      int depth = atoi(arg);
+
+      if(depth > 0) args->depth = depth;
+      break;
+
+    case 'W':
+      int deadline = atoi(arg);
+
+      if(deadline > 0) args->deadline = deadline;
+      break;
+
+    case 'S':
+      int sessions = atoi(arg);
+
+      if(sessions > 0) args->sessions = sessions;
+      break;
+
+    case 'P':
+      char** priorities = realloc(args->priorities, (args->priority_count + 1) * sizeof(char*));
+
+      if(!priorities) argp_failure(state, 1, ENOMEM, "Failed to add priority");
+
+      priorities[args->priority_count++] = arg;
+
+      args->priorities = priorities;
       break;
 
     case ARGP_KEY_ARG:
@@ -114,245 +341,567 @@ static error_t opt_parse(int key, char* arg, struct argp_state* state)
 }
 
 /*
- * Communication from client to engine
+ * Keyboard interrupt - stop the event loop
+ *
+ * Nothing is logged here, since the interrupted thread might be logging
+ */
+static void sigint_handler(int signum)
+{
+  node_interrupted = true;
+
+  node_running = false;
+}
+
+/*
+ * Log more (SIGUSR1) or less (SIGUSR2), without restarting the node
+ *
+ * Only a node started with -d or --log logs, even at --log off
+ */
+static void sigusr_handler(int signum)
+{
+  log_level_t level = log_level_get();
+
+  if(signum == SIGUSR1 && level < LOG_DEBUG) log_level_set(level + 1);
+
+  if(signum == SIGUSR2 && level > LOG_OFF)   log_level_set(level - 1);
+}
+
+/*
+ * Setup handler for specified signal
+ *
+ * The signal will be handled, in comparision to using the signal() function
  */
-void* stdout_routine(void* arg)
+static void signal_handler_setup(int signum, void (*handler) (int))
 {
-  stdout_running = true;
+  struct sigaction sig_action;
+
+  sig_action.sa_handler = handler;
+  sig_action.sa_flags = 0;
+  sigemptyset(&sig_action.sa_mask);
 
-  if(args.debug) info_print("Start of stdout routine");
+  sigaction(signum, &sig_action, NULL);
+}
+
+/*
+ * Setup handlers for different signals that can be omitted
+ *
+ * Broken pipes are ignored, and are instead handled as write errors
+ * on the connection that broke, closing just that session
+ */
+static void signals_handler_setup(void)
+{
+  signal_handler_setup(SIGPIPE, SIG_IGN);
 
-  char buffer[1024];
+  signal_handler_setup(SIGINT,  sigint_handler);
 
-  int read_size  = -1, write_size = -1;
+  signal_handler_setup(SIGUSR1, sigusr_handler);
+  signal_handler_setup(SIGUSR2, sigusr_handler);
+}
 
-  while((read_size = socket_read(sockfd, buffer, sizeof(buffer) - 1)) > 0)
+/*
+ * Find an engine that is ready for a session
+ *
+ * RETURN (engine_t* engine)
+ * - NULL | Every engine is either busy, resetting or stopped
+ */
+static engine_t* node_engine_find(void)
+{
+  for(int index = 0; index < engine_count; index++)
   {
-    // IMPORTANT: Terminate string after reading bytes
-    buffer[read_size] = '\0';
+    if(engines[index].state == ENGINE_READY) return &engines[index];
+  }
 
-    if(args.debug) debug_print(stdout, "client -> engine", "%s", buffer);
+  return NULL;
+}
 
-    if(strncmp(buffer, "quit", 4) == 0) break;
+/*
+ * Give waiting sessions to the engines that are ready,
+ * the highest priority class first
+ */
+static void node_assign(void)
+{
+  engine_t* engine;
 
-    if((write_size = buffer_write(stdout_fifo, buffer, sizeof(buffer))) <= 0) break;
+  while(admission.count > 0 && (engine = node_engine_find()))
+  {
+    session_t* session = admission_pop(&admission);
+
+    histogram_record(&metrics.queue_wait, timing_now() - session->queued);
+
+    session_attach(session, engine);
   }
 
-  if(errno != 0)
+  metrics.waiting = admission.count;
+}
+
+/*
+ * An engine has been reset and is ready for the next client
+ */
+static void node_engine_ready(engine_t* engine)
+{
+  node_assign();
+}
+
+/*
+ * An engine has stopped. When every engine has stopped,
+ * the node should not be running
+ */
+static void node_engine_stop(engine_t* engine)
+{
+  int running = 0;
+
+  for(int index = 0; index < engine_count; index++)
   {
-    if(args.debug) error_print("%s", strerror(errno));
+    if(engines[index].state != ENGINE_STOPPED) running++;
   }
 
-  // This code block is not needed, but catches the stopped engine earlier
-  // If the stdout pipe is broken (32), the node should not be running
-  if(write_size == -1 && errno == 32)
+  if(running > 0)
   {
-    if(args.debug) info_print("Shutting node down");
+    if(args.debug) info_print("Engine stopped, %d engines left", running);
 
-    node_running = false;
+    return;
   }
 
-  if(stdin_running)
+  if(args.debug) info_print("Shutting node down");
+
+  node_running = false;
+}
+
+/*
+ * Remove session from a list of sessions
+ *
+ * RETURN (bool removed)
+ */
+static bool node_unlink(session_t** head, session_t* session)
+{
+  session_t** pointer = head;
+
+  while(*pointer && *pointer != session) pointer = &(*pointer)->next;
+
+  if(!*pointer) return false;
+
+  *pointer = session->next;
+
+  session->next = NULL;
+
+  return true;
+}
+
+/*
+ * Remove session from the waiting sessions, if it is waiting
+ */
+static void node_waiting_remove(session_t* session)
+{
+  if(admission_remove(&admission, session)) metrics.waiting = admission.count;
+
+  node_unlink(&refused_sessions, session);
+}
+
+/*
+ * Let session wait for an engine
+ *
+ * The workers of a batch are never refused, since their client has been let in
+ *
+ * RETURN (bool admitted)
+ * - false | The queue is full
+ */
+static bool node_enqueue(session_t* session)
+{
+  session->queued = timing_now();
+
+  if(admission_full(&admission) && !(session->carrier && session->carrier->batch))
   {
-    if(args.debug) info_print("Interrupting stdin routine");
+    METRICS_ADD(metrics.refused, 1);
+
+    if(args.debug) info_print("Refused session, %ld sessions are waiting", (long) admission.count);
 
-    pthread_kill(stdin_thread, SIGUSR1);
+    return false;
   }
 
-  stdout_running = false;
+  admission_push(&admission, session);
 
-  if(args.debug) info_print("End of stdout routine");
+  node_assign();
 
-  return NULL;
+  return true;
 }
 
 /*
- * Communication from engine to client
+ * Tell the client of session why it is let go, and close it
+ *
+ * With io_uring, the line is written before the close would cancel the write
  */
-void* stdin_routine(void* arg)
+static void node_dismiss(session_t* session, const char* line, size_t length)
 {
-  stdin_running = true;
+  session_notify(session, line, length);
+
+  conn_settle(&session->conn);
 
-  if(args.debug) info_print("Start of stdin routine");
+  session_close(session);
+}
 
-  char buffer[1024];
+/*
+ * Tell the client of a refused session why, and close it
+ */
+static void node_refuse(session_t* session)
+{
+  node_dismiss(session, "info string queue full\n", 23);
+}
 
-  int read_size  = -1, write_size = -1;
+/*
+ * A client has changed its priority class, which moves it to
+ * its place in the new class, if it is waiting
+ */
+static void node_session_prioritize(session_t* session)
+{
+  if(admission_remove(&admission, session)) admission_push(&admission, session);
+}
+
+/*
+ * Close the sessions that were refused, and those that have waited
+ * past the deadline, and send the others their new positions
+ */
+static void node_admission_update(void)
+{
+  session_t* session;
 
-  while((read_size = buffer_read(stdin_fifo, buffer, sizeof(buffer) - 1)) > 0)
+  while((session = refused_sessions))
   {
-    // IMPORTANT: Terminate string after reading bytes
-    buffer[read_size] = '\0';
+    refused_sessions = session->next;
 
-    if(args.debug) debug_print(stdout, "ENGINE => CLIENT", "%s\033[F", buffer);
+    session->next = NULL;
 
-    if((write_size = socket_write(sockfd, buffer, sizeof(buffer))) <= 0) break;
+    node_refuse(session);
   }
 
-  if(errno != 0)
+  while((session = admission_expired(&admission, timing_now())))
   {
-    if(args.debug) error_print("%s", strerror(errno));
-  }
+    METRICS_ADD(metrics.expired, 1);
 
-  // This code block is not needed, but catches the stopped engine earlier
-  // If the stdin fifo is broken (End Of File), the node should not be running
-  if(read_size == 0)
-  {
-    if(args.debug) info_print("Shutting node down");
+    if(args.debug) info_print("Session waited past the deadline");
 
-    node_running = false;
+    node_dismiss(session, "info string queue deadline passed\n", 34);
   }
 
-  if(stdout_running)
-  {
-    if(args.debug) info_print("Interrupting stdout routine");
+  metrics.waiting = admission.count;
 
-    pthread_kill(stdout_thread, SIGUSR1);
-  }
+  admission_notify(&admission);
+}
 
-  stdin_running = false;
+/*
+ * A client has started multiplexing or analyzing a batch,
+ * so it doesn't need an engine itself
+ */
+static void node_session_multiplex(session_t* session)
+{
+  node_waiting_remove(session);
 
-  if(args.debug) info_print("End of stdin routine");
+  session->next = carrier_sessions;
 
-  return NULL;
+  carrier_sessions = session;
+
+  // The client gets the current load, even if it hasn't changed
+  if(session->reports) load_stale = true;
 }
 
 /*
- * Keyboard interrupt - close the program (the threads)
+ * A logical session has been opened, and needs an engine
  */
-static void sigint_handler(int signum)
+static void node_session_open(session_t* session)
 {
-  if(args.debug) info_print("Keyboard interrupt");
-
-  node_running = false;
+  METRICS_ADD(metrics.opened, 1);
 
-  if(stdin_running)  pthread_kill(stdin_thread, SIGUSR1);
+  // The carrier is still using the session, so it is closed after the event batch
+  if(!node_enqueue(session))
+  {
+    session->next = refused_sessions;
 
-  if(stdout_running) pthread_kill(stdout_thread, SIGUSR1);
+    refused_sessions = session;
+  }
 }
 
 /*
- * Broken pipe - close the program (the threads)
+ * Remove closed session from the waiting sessions or the carriers,
+ * and free it once the current event batch has been handled
  */
-static void sigpipe_handler(int signum)
+static void node_session_close(session_t* session)
 {
-  if(args.debug) error_print("Pipe has been broken");
+  METRICS_ADD(metrics.closed, 1);
 
-  node_running = false;
+  node_waiting_remove(session);
+
+  node_unlink(&carrier_sessions, session);
 
-  if(stdin_running)  pthread_kill(stdin_thread, SIGUSR1);
+  session->next = closed_sessions;
 
-  if(stdout_running) pthread_kill(stdout_thread, SIGUSR1);
+  closed_sessions = session;
 }
 
 /*
- * SIGUSR1 is the signal used to interrupt stdin and stdout routine
+ * Report the load of the node to the clients that asked for it,
+ * like proxies routing sessions to the least loaded node
  *
- * The signal doesn't need to be processed, just interrupt
+ * The load is reported after an event batch in which it has changed
  */
-static void sigusr1_handler(int signum) { }
+static void node_load_publish(void)
+{
+  size_t busy = 0;
+
+  for(int index = 0; index < engine_count; index++)
+  {
+    if(engines[index].state == ENGINE_BUSY) busy++;
+  }
+
+  if(!load_stale && busy == load_busy && admission.count == load_waiting) return;
+
+  load_busy    = busy;
+  load_waiting = admission.count;
+  load_stale   = false;
+
+  char report[64];
+
+  sprintf(report, "load %ld %ld %d\n", (long) load_busy, (long) load_waiting, engine_count);
+
+  session_t* session = carrier_sessions;
+
+  while(session)
+  {
+    // A client that fails is closed, and unlinked from the carriers
+    session_t* next = session->next;
+
+    if(session->reports) conn_message(&session->conn, report);
+
+    session = next;
+  }
+}
 
 /*
- * Setup handler for specified signal
- *
- * The signal will be handled, in comparision to using the signal() function
+ * Print the accept to first response latency of the served clients,
+ * from the histogram of the metrics
  */
-static void signal_handler_setup(int signum, void (*handler) (int))
+static void node_responses_print(void)
 {
-  struct sigaction sig_action;
+  histogram_t* histogram = &metrics.response;
 
-  sig_action.sa_handler = handler;
-  sig_action.sa_flags = 0;
-  sigemptyset(&sig_action.sa_mask);
+  if(histogram->count == 0) return;
 
-  sigaction(signum, &sig_action, NULL);
+  info_print("accept -> first response: %ld clients, mean %f us",
+    (long) histogram->count, (double) histogram->sum / histogram->count);
 }
 
 /*
- * Setup handlers for different signals that can be omitted
+ * Print how much of the time the node has been running,
+ * every engine has spent waiting for a session
  */
-static void signals_handler_setup(void)
+static void node_engines_print(uint64_t uptime)
 {
-  signal_handler_setup(SIGPIPE, sigpipe_handler);
+  for(int index = 0; index < engine_count; index++)
+  {
+    engine_t* engine = &engines[index];
 
-  signal_handler_setup(SIGINT,  sigint_handler);
+    uint64_t idle = engine_idle(engine);
 
-  signal_handler_setup(SIGUSR1, sigusr1_handler);
+    info_print("Engine (%d): %ld sessions, idle %f ms of %f ms", index, (long) engine->served,
+      (double) idle / 1e6, (double) uptime / 1e6);
+  }
 }
 
 /*
- * Tell the chess engine to quit, by sending it a quit message
+ * Free the sessions that were closed during the last event batch
+ *
+ * Sessions that io_uring still has operations queued on are kept
  */
-static void engine_quit(void)
+static void node_sessions_free(void)
 {
-  if(args.debug) info_print("Quitting engine");
+  session_t** pointer = &closed_sessions;
+
+  while(*pointer)
+  {
+    session_t* session = *pointer;
+
+    if(conn_busy(&session->conn))
+    {
+      pointer = &session->next;
+
+      continue;
+    }
 
-  if(stdout_fifo) message_write(stdout_fifo, "quit\n");
+    *pointer = session->next;
+
+    session_free(session);
+  }
 }
 
 /*
- * Reset the chess engine for the next client, by 
- * - starting a new UCI game and
- * - setting the position to the start position 
+ * Create session for accepted client, and let it wait for the engine
+ *
+ * A proxy routes the client to a backend node instead
  */
-static int engine_reset(void)
+static void node_client(int sockfd)
 {
-  if(args.debug) info_print("Establishing engine UCI communication");
+  METRICS_ADD(metrics.accepted, 1);
 
-  message_write(stdout_fifo, "uci\n");
+  socket_nodelay(sockfd);
 
-  char buffer[1024];
+  if(proxy.count > 0)
+  {
+    proxy_client(&proxy, sockfd);
 
-  int read_size;
+    return;
+  }
+
+  session_t* session = session_create(sockfd, args.splice, args.debug);
 
-  while((read_size = buffer_read(stdin_fifo, buffer, sizeof(buffer) - 1)) > 0)
+  if(!session)
   {
-    // IMPORTANT: Terminate string after reading bytes
-    buffer[read_size] = '\0';
+    socket_close(&sockfd, args.debug);
 
-    if(strncmp(buffer, "uciok", 5) == 0) break;
+    return;
   }
 
-  if(errno != 0)
+  session->close     = node_session_close;
+  session->multiplex = node_session_multiplex;
+  session->open      = node_session_open;
+
+  session->prioritize = node_session_prioritize;
+
+  session->cache = (cache.budget > 0) ? &cache : NULL;
+  session->store = (store.fd != -1)   ? &store : NULL;
+  session->book  = (book.fd != -1)    ? &book  : NULL;
+
+  if(trace.fd != -1) session_trace(session, &trace);
+
+  session->concurrency = (args.batch > 0) ? args.batch : engine_count;
+
+  session->sessions = args.sessions;
+
+  session->priority = admission_priority(&admission, sockfd);
+
+  METRICS_ADD(metrics.opened, 1);
+
+  if(!node_enqueue(session)) node_refuse(session);
+}
+
+/*
+ * Close every session that is still open
+ */
+static void node_sessions_close(void)
+{
+  session_t* session;
+
+  // Closing a carrier closes its logical sessions
+  while(carrier_sessions) session_close(carrier_sessions);
+
+  for(int index = 0; index < engine_count; index++)
   {
-    if(args.debug) error_print("%s", strerror(errno));
+    if(engines[index].session) session_close(engines[index].session);
+  }
 
-    return 1;
+  while((session = admission_pop(&admission))) session_close(session);
+
+  while((session = refused_sessions))
+  {
+    refused_sessions = session->next;
+
+    session->next = NULL;
+
+    session_close(session);
   }
 
-  if(args.debug) info_print("Setting up new engine game");
+  for(session_t* session = closed_sessions; session; session = session->next)
+  {
+    conn_settle(&session->conn);
+  }
 
-  message_write(stdout_fifo, "ucinewgame\n");
+  node_sessions_free();
+}
 
-  message_write(stdout_fifo, "position startpos\n");
+/*
+ * Handle the next batch of events, with the backend in use
+ *
+ * The wait ends in time for the next session to wait past the deadline
+ *
+ * RETURN (same as event_wait)
+ */
+static int node_wait(void)
+{
+  int timeout = admission_timeout(&admission, timing_now());
 
-  return 0;
+  if(uring_active()) return uring_wait(timeout);
+
+  return event_wait(timeout);
 }
 
 /*
- * Run as long as the server is still running
+ * Run the event loop as long as the node is running
+ *
+ * The clients and the engines are all handled by the same thread.
+ * Clients are accepted as soon as they connect, and wait for an
+ * engine as sessions, so a burst of clients never fills the backlog
  */
 static void node_routine(void)
 {
-  while(node_running && servfd != -1)
+  if(listener_start(&listener, node_client) != 0)
   {
-    if(engine_reset() != 0) break;
+    if(args.debug) error_print("Failed to accept clients: %s", strerror(errno));
 
-    sockfd = socket_accept(servfd, args.address, args.port, args.debug);
+    return;
+  }
 
-    // If the server socket fails, stop node
-    if(sockfd == -1) break;
+  if(args.metrics > 0 && metrics_listen(args.address, args.metrics, args.debug) != 0)
+  {
+    if(args.debug) error_print("Failed to serve metrics");
+  }
 
-    stdin_stdout_thread_start(&stdin_thread, &stdin_routine, &stdout_thread, &stdout_routine, args.debug);
+  uint64_t start = timing_now();
 
-    socket_close(&sockfd, args.debug);
+  // An engine that fails to reset stops, and the node stops without engines
+  for(int index = 0; index < engine_count; index++)
+  {
+    engines[index].ready = node_engine_ready;
+    engines[index].stop  = node_engine_stop;
+
+    engine_reset(&engines[index]);
+  }
+
+  while(node_running)
+  {
+    if(node_wait() == -1 && errno != EINTR)
+    {
+      if(args.debug) error_print("Failed to wait for events: %s", strerror(errno));
+
+      break;
+    }
+
+    node_sessions_free();
+
+    node_admission_update();
+
+    node_load_publish();
+
+    proxy_collect(&proxy);
+
+    metrics_collect();
   }
 
-  engine_quit();
+  if(args.debug && node_interrupted) info_print("Keyboard interrupt");
+
+  // Engines that are ready now have been idle until the end
+  if(args.debug) node_engines_print(timing_now() - start);
+
+  node_sessions_close();
+
+  for(int index = 0; index < engine_count; index++)
+  {
+    if(engines[index].state != ENGINE_STOPPED) engine_quit(&engines[index]);
+  }
+
+  if(args.debug) node_responses_print();
+
+  metrics_close();
 }
 
 /*
- * Create server socket using address and port arguments
+ * Create the listening sockets using address and port arguments
  *
  * If either address or port is missing, use default value
  *
@@ -366,9 +915,103 @@ static int args_server_socket_create(void)
 
   if(args.port == -1) args.port    = DEFAULT_PORT;
 
-  servfd = server_socket_create(args.address, args.port, args.debug);
+  return listener_open(&listener, args.address, args.port, args.backlog, args.acceptors, args.debug);
+}
+
+/*
+ * Spawn the engine processes, and open the engines
+ *
+ * If the number of engines is missing, one engine per core is spawned
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate engines
+ * - 2 | Failed to spawn engine process
+ * - 3 | Failed to open engine
+ */
+static int engines_spawn(void)
+{
+  int count = args.engines;
+
+  if(count == -1) count = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if(count < 1) count = 1;
+
+  engines   = calloc(count, sizeof(engine_t));
+  processes = calloc(count, sizeof(process_t));
+
+  if(!engines || !processes) return 1;
+
+  for(int index = 0; index < count; index++)
+  {
+    process_t* process = &processes[index];
+
+    if(process_spawn(process, args.engine, args.debug) != 0) return 2;
+
+    if(engine_open(&engines[index], process->stdout, process->stdin, args.debug) != 0)
+    {
+      process_close(process, args.debug);
+
+      return 3;
+    }
+
+    engine_count++;
+  }
+
+  if(args.debug) info_print("Spawned %d engines", engine_count);
 
-  return (servfd == -1) ? 1 : 0;
+  return 0;
+}
+
+/*
+ * Open the engines, either by spawning them or through the fifos
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to open engines
+ */
+static int engines_open(void)
+{
+  if(args.engine) return (engines_spawn() == 0) ? 0 : 1;
+
+  if(stdin_stdout_fifo_open(&stdin_fifo, args.stdin_path, &stdout_fifo, args.stdout_path, fifo_reverse, args.debug) != 0)
+  {
+    return 1;
+  }
+
+  if(!(engines = calloc(1, sizeof(engine_t)))) return 1;
+
+  if(engine_open(&engines[0], stdin_fifo, stdout_fifo, args.debug) != 0) return 1;
+
+  engine_count = 1;
+
+  return 0;
+}
+
+/*
+ * Close the engines, and wait for the spawned processes to exit
+ */
+static void engines_close(void)
+{
+  for(int index = 0; index < engine_count; index++)
+  {
+    engine_close(&engines[index]);
+
+    if(processes) process_close(&processes[index], args.debug);
+  }
+
+  free(engines);
+
+  free(processes);
+
+  engines   = NULL;
+  processes = NULL;
+
+  engine_count = 0;
+
+  fifo_close(&stdin_fifo, args.debug);
+
+  fifo_close(&stdout_fifo, args.debug);
 }
 
 static struct argp argp = { options, opt_parse, args_doc, doc };
@@ -380,9 +1023,86 @@ int main(int argc, char* argv[])
 {
   argp_parse(&argp, argc, argv, 0, 0, &args);
 
+  log_level_set(args.level);
+
+  // Without the log thread, messages are written by the thread that logs them
+  if(log_start() != 0)
+  {
+    if(args.debug) error_print("Failed to start log thread: %s", strerror(errno));
+  }
+
   signals_handler_setup();
 
-  if(stdin_stdout_fifo_open(&stdin_fifo, args.stdin_path, &stdout_fifo, args.stdout_path, fifo_reverse, args.debug) == 0)
+  if(event_init() != 0)
+  {
+    if(args.debug) error_print("Failed to create event loop: %s", strerror(errno));
+
+    log_stop();
+
+    return 1;
+  }
+
+  // Without io_uring support, epoll is used instead
+  if(args.uring && uring_init(args.debug) != 0)
+  {
+    if(args.debug) info_print("Falling back to epoll");
+  }
+
+  if(args.cache > 0 && cache_init(&cache, args.cache) != 0)
+  {
+    if(args.debug) error_print("Failed to create analysis cache");
+  }
+
+  if(args.store && store_open(&store, args.store, STORE_CAPACITY, args.debug) != 0)
+  {
+    if(args.debug) error_print("Failed to open analysis store");
+  }
+
+  if(args.book && book_open(&book, args.book, args.weighted ? BOOK_WEIGHTED : BOOK_BEST, args.debug) != 0)
+  {
+    if(args.debug) error_print("Failed to open book");
+  }
+
+  if(args.record && trace_open(&trace, args.record, args.debug) != 0)
+  {
+    if(args.debug) error_print("Failed to start recording");
+  }
+
+  if(uring_active() && args.splice)
+  {
+    if(args.debug) info_print("Relaying lines, splice is not used with io_uring");
+
+    args.splice = false;
+  }
+
+  admission.depth    = args.depth;
+  admission.deadline = (uint64_t) args.deadline * 1000000;
+
+  for(int index = 0; index < args.priority_count; index++)
+  {
+    if(admission_rule_add(&admission, args.priorities[index]) != 0)
+    {
+      if(args.debug) error_print("Invalid priority: %s", args.priorities[index]);
+    }
+  }
+
+  if(args.upstream_count > 0)
+  {
+    if(proxy_init(&proxy, args.upstreams, args.upstream_count, args.debug) == 0)
+    {
+      if(args_server_socket_create() == 0)
+      {
+        node_routine();
+      }
+
+      if(args.debug) proxy_print(&proxy);
+
+      proxy_close(&proxy);
+    }
+
+    proxy_free(&proxy);
+  }
+  else if(engines_open() == 0)
   {
     if(args_server_socket_create() == 0)
     {
@@ -390,16 +1110,52 @@ int main(int argc, char* argv[])
     }
   }
 
-  fifo_close(&stdin_fifo, args.debug);
+  engines_close();
 
-  fifo_close(&stdout_fifo, args.debug);
+  listener_close(&listener);
+
+  uring_free();
+
+  event_free();
+
+  if(args.debug && cache.budget > 0)
+  {
+    info_print("analysis cache: %ld hits, %ld misses, %ld inserts, %ld evictions, %ld bytes",
+      cache.hits, cache.misses, cache.inserts, cache.evictions, cache.used);
+  }
 
-  socket_close(&sockfd, args.debug);
+  cache_free(&cache);
 
-  socket_close(&servfd, args.debug);
+  if(args.debug && store.fd != -1)
+  {
+    info_print("analysis store: %ld hits, %ld misses, %ld writes, %ld full",
+      store.hits, store.misses, store.writes, store.full);
+  }
+
+  store_close(&store);
+
+  if(args.debug && book.fd != -1)
+  {
+    size_t probes = book.hits + book.misses;
+
+    info_print("opening book: %ld hits, %ld misses, %f percent hit rate", (long) book.hits, (long) book.misses,
+      (probes > 0) ? 100.0 * book.hits / probes : 0.0);
+  }
+
+  book_close(&book);
+
+  trace_close(&trace);
+
+  admission_free(&admission);
+
+  free(args.upstreams);
+
+  free(args.priorities);
 
 
   if(args.debug) info_print("End of main");
 
+  log_stop();
+
   return 0;
 }
@@ -0,0 +1,1035 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#include "uring.h"
+
+/*
+ * The kind of operation a completion belongs to,
+ * stored in the low bits of the user data next to the connection
+ */
+typedef enum
+{
+  URING_NONE,
+  URING_READ,
+  URING_WRITE,
+  URING_ACCEPT,
+  URING_POLL
+} uring_op_t;
+
+#define URING_OP_MASK 7
+
+#define URING_OP_BITS 3
+
+/*
+ * Listening socket that clients are accepted on
+ */
+typedef struct
+{
+  int                    file;      // Index in the fixed file table
+  bool                   multishot;
+  bool                   deferred;  // The accept is queued once the submission queue has room
+  uring_accept_handler_t handler;
+} uring_listener_t;
+
+static int ring_fd = -1;
+
+static void*  sq_ring = MAP_FAILED;
+static size_t sq_ring_size;
+
+static void*  cq_ring = MAP_FAILED;
+static size_t cq_ring_size;
+
+static struct io_uring_sqe* sqes = MAP_FAILED;
+static size_t sqes_size;
+
+static unsigned* sq_head;
+static unsigned* sq_tail;
+static unsigned* sq_mask;
+static unsigned* sq_entries;
+static unsigned* sq_array;
+
+static unsigned* cq_head;
+static unsigned* cq_tail;
+static unsigned* cq_mask;
+
+static struct io_uring_cqe* cqes;
+
+static unsigned sq_local  = 0; // Tail including entries not yet published
+static unsigned sq_queued = 0; // Number of entries not yet submitted
+
+static bool file_used[URING_FILES];
+static bool buffer_used[URING_BUFFERS];
+
+static bool buffers_fixed = false;
+
+static bool timeouts = false; // The kernel can wait for completions with a timeout
+
+static uring_listener_t listeners[URING_LISTENERS];
+static int listener_count = 0;
+
+static conn_t* deferred = NULL; // Connections waiting for the submission queue, see uring_defer
+
+static bool uring_debug = false;
+
+// Number of io_uring_enter syscalls, for comparing against epoll
+size_t uring_enters = 0;
+
+/*
+ * Check if io_uring is used instead of epoll
+ */
+bool uring_active(void)
+{
+  return ring_fd != -1;
+}
+
+/*
+ * Call io_uring_register on the ring
+ */
+static int uring_register(unsigned opcode, void* arg, unsigned count)
+{
+  return syscall(__NR_io_uring_register, ring_fd, opcode, arg, count);
+}
+
+/*
+ * Map the submission queue, the completion queue and the submission entries
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to map memory
+ */
+static int uring_map(struct io_uring_params* params)
+{
+  sq_ring_size = params->sq_off.array + params->sq_entries * sizeof(unsigned);
+  cq_ring_size = params->cq_off.cqes  + params->cq_entries * sizeof(struct io_uring_cqe);
+
+  bool single = (params->features & IORING_FEAT_SINGLE_MMAP);
+
+  if(single)
+  {
+    if(cq_ring_size > sq_ring_size) sq_ring_size = cq_ring_size;
+
+    cq_ring_size = sq_ring_size;
+  }
+
+  sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+
+  if(sq_ring == MAP_FAILED) return 1;
+
+  if(!single)
+  {
+    cq_ring = mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+
+    if(cq_ring == MAP_FAILED) return 1;
+  }
+
+  sqes_size = params->sq_entries * sizeof(struct io_uring_sqe);
+
+  sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+
+  if(sqes == MAP_FAILED) return 1;
+
+  char* sq = sq_ring;
+  char* cq = single ? sq_ring : cq_ring;
+
+  sq_head    = (unsigned*) (sq + params->sq_off.head);
+  sq_tail    = (unsigned*) (sq + params->sq_off.tail);
+  sq_mask    = (unsigned*) (sq + params->sq_off.ring_mask);
+  sq_entries = (unsigned*) (sq + params->sq_off.ring_entries);
+  sq_array   = (unsigned*) (sq + params->sq_off.array);
+
+  cq_head = (unsigned*) (cq + params->cq_off.head);
+  cq_tail = (unsigned*) (cq + params->cq_off.tail);
+  cq_mask = (unsigned*) (cq + params->cq_off.ring_mask);
+
+  cqes = (struct io_uring_cqe*) (cq + params->cq_off.cqes);
+
+  sq_local = *sq_tail;
+
+  return 0;
+}
+
+/*
+ * Create the ring, and register sparse tables for files and buffers
+ *
+ * Registered buffers are optional, reads are done without them
+ * if the kernel does not support sparse buffer tables
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | io_uring is not available
+ * - 2 | Failed to map the ring
+ * - 3 | Failed to register file table
+ */
+int uring_init(bool debug)
+{
+  uring_debug = debug;
+
+  struct io_uring_params params;
+
+  memset(&params, 0, sizeof(params));
+
+  params.flags      = IORING_SETUP_CQSIZE;
+  params.cq_entries = URING_ENTRIES * 4;
+
+  ring_fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+
+  if(ring_fd == -1)
+  {
+    if(debug) error_print("Failed to setup io_uring: %s", strerror(errno));
+
+    return 1;
+  }
+
+  if(uring_map(&params) != 0)
+  {
+    if(debug) error_print("Failed to map io_uring: %s", strerror(errno));
+
+    uring_free();
+
+    return 2;
+  }
+
+  struct io_uring_rsrc_register files = { .nr = URING_FILES, .flags = IORING_RSRC_REGISTER_SPARSE };
+
+  if(uring_register(IORING_REGISTER_FILES2, &files, sizeof(files)) == -1)
+  {
+    if(debug) error_print("Failed to register io_uring files: %s", strerror(errno));
+
+    uring_free();
+
+    return 3;
+  }
+
+  struct io_uring_rsrc_register buffers = { .nr = URING_BUFFERS, .flags = IORING_RSRC_REGISTER_SPARSE };
+
+  buffers_fixed = (uring_register(IORING_REGISTER_BUFFERS2, &buffers, sizeof(buffers)) == 0);
+
+  if(debug && !buffers_fixed) info_print("Reading without registered buffers");
+
+  timeouts = (params.features & IORING_FEAT_EXT_ARG);
+
+  return 0;
+}
+
+/*
+ * Tear down the ring, which cancels every queued operation
+ */
+void uring_free(void)
+{
+  if(sqes    != MAP_FAILED) munmap(sqes,    sqes_size);
+
+  if(cq_ring != MAP_FAILED) munmap(cq_ring, cq_ring_size);
+
+  if(sq_ring != MAP_FAILED) munmap(sq_ring, sq_ring_size);
+
+  sqes    = MAP_FAILED;
+  cq_ring = MAP_FAILED;
+  sq_ring = MAP_FAILED;
+
+  if(ring_fd != -1) close(ring_fd);
+
+  ring_fd = -1;
+
+  deferred = NULL;
+
+  if(uring_debug) info_print("io_uring enters: %ld", uring_enters);
+}
+
+/*
+ * Publish the queued entries, submit them and optionally wait for completions
+ *
+ * PARAMS
+ * - int timeout | Milliseconds to wait, -1 to wait forever
+ *
+ * RETURN (int status)
+ * - >=0 | Number of submitted entries
+ * -  -1 | Failed to enter the ring, or the timeout passed (ETIME)
+ */
+static int uring_enter(unsigned wait, int timeout)
+{
+  __atomic_store_n(sq_tail, sq_local, __ATOMIC_RELEASE);
+
+  int status;
+
+  // Older kernels can only wait forever, and the caller checks its timeouts after the next completion
+  if(wait && timeout >= 0 && timeouts)
+  {
+    struct __kernel_timespec time = { .tv_sec = timeout / 1000, .tv_nsec = (timeout % 1000) * 1000000L };
+
+    struct io_uring_getevents_arg arg = { .ts = (uint64_t) (uintptr_t) &time };
+
+    status = syscall(__NR_io_uring_enter, ring_fd, sq_queued, wait, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+  }
+  else status = syscall(__NR_io_uring_enter, ring_fd, sq_queued, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+
+  uring_enters++;
+
+  if(status == -1) return -1;
+
+  sq_queued -= status;
+
+  return status;
+}
+
+/*
+ * Get the next free submission entry, cleared
+ *
+ * The entry is submitted with the next batch. If the queue is full,
+ * the queued entries are submitted right away to make room
+ */
+static struct io_uring_sqe* uring_sqe(void)
+{
+  if(sq_local - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) == *sq_entries)
+  {
+    uring_enter(0, -1);
+
+    if(sq_local - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) == *sq_entries) return NULL;
+  }
+
+  unsigned index = sq_local & *sq_mask;
+
+  struct io_uring_sqe* sqe = &sqes[index];
+
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+  sq_array[index] = index;
+
+  sq_local++;
+  sq_queued++;
+
+  return sqe;
+}
+
+/*
+ * Claim a free index in a table of slots
+ *
+ * RETURN (int index)
+ * - >=0 | The claimed index
+ * -  -1 | Every slot is used
+ */
+static int uring_slot(bool* used, int count)
+{
+  for(int index = 0; index < count; index++)
+  {
+    if(!used[index])
+    {
+      used[index] = true;
+
+      return index;
+    }
+  }
+
+  return -1;
+}
+
+/*
+ * Put file descriptor in the fixed file table
+ *
+ * RETURN (int index)
+ * - >=0 | Index of the fixed file
+ * -  -1 | The table is full, or failed to register file
+ */
+static int uring_file_add(int fd)
+{
+  int index = uring_slot(file_used, URING_FILES);
+
+  if(index == -1) return -1;
+
+  struct io_uring_files_update update = { .offset = index, .fds = (uintptr_t) &fd };
+
+  if(uring_register(IORING_REGISTER_FILES_UPDATE, &update, 1) != 1)
+  {
+    file_used[index] = false;
+
+    return -1;
+  }
+
+  return index;
+}
+
+/*
+ * Remove file from the fixed file table
+ *
+ * Queued operations keep their own reference to the file
+ */
+static void uring_file_remove(int index)
+{
+  if(index == -1) return;
+
+  int fd = -1;
+
+  struct io_uring_files_update update = { .offset = index, .fds = (uintptr_t) &fd };
+
+  uring_register(IORING_REGISTER_FILES_UPDATE, &update, 1);
+
+  file_used[index] = false;
+}
+
+/*
+ * Register memory at index in the buffer table, or clear it with NULL
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to register buffer
+ */
+static int uring_buffer_set(int index, void* buffer, size_t size)
+{
+  struct iovec iov = { buffer, size };
+
+  struct io_uring_rsrc_update2 update = { .offset = index, .data = (uintptr_t) &iov, .nr = 1 };
+
+  return (uring_register(IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update)) == 1) ? 0 : -1;
+}
+
+/*
+ * Let the operation of connection be queued after the next completions,
+ * when the submission queue is full even after submitting it
+ *
+ * PARAMS
+ * - bool* retry | The retry flag of the operation
+ */
+static void uring_defer(conn_t* conn, bool* retry)
+{
+  if(!conn->uring.retry_read && !conn->uring.retry_cancel)
+  {
+    conn->uring.deferred = deferred;
+
+    deferred = conn;
+  }
+
+  *retry = true;
+}
+
+/*
+ * Forget the operations of connection waiting for the submission queue
+ */
+static void uring_undefer(conn_t* conn)
+{
+  if(!conn->uring.retry_read && !conn->uring.retry_cancel) return;
+
+  conn_t** pointer = &deferred;
+
+  while(*pointer && *pointer != conn) pointer = &(*pointer)->uring.deferred;
+
+  if(*pointer) *pointer = conn->uring.deferred;
+
+  conn->uring.deferred     = NULL;
+  conn->uring.retry_read   = false;
+  conn->uring.retry_cancel = false;
+}
+
+/*
+ * Stop using the registered buffer of connection
+ */
+static void uring_buffer_remove(conn_t* conn)
+{
+  if(conn->uring.buffer == -1) return;
+
+  if(conn->uring.registered) uring_buffer_set(conn->uring.buffer, NULL, 0);
+
+  buffer_used[conn->uring.buffer] = false;
+
+  conn->uring.buffer     = -1;
+  conn->uring.registered = NULL;
+}
+
+/*
+ * Queue a read into the free space of the reader
+ *
+ * If the reader buffer is registered, the read uses it directly,
+ * without the kernel having to map the pages for every read.
+ * If the submission queue is full, the read is queued after the next completions
+ */
+static void uring_read(conn_t* conn)
+{
+  char* space;
+
+  size_t size = reader_space(&conn->reader, &space);
+
+  if(size == 0)
+  {
+    conn_fail(conn);
+
+    return;
+  }
+
+  // The reader buffer has moved since it was registered, when it grew
+  if(conn->uring.buffer != -1 && conn->uring.registered != conn->reader.buffer)
+  {
+    if(uring_buffer_set(conn->uring.buffer, conn->reader.buffer, conn->reader.size + 1) == 0)
+    {
+      conn->uring.registered = conn->reader.buffer;
+    }
+    else uring_buffer_remove(conn);
+  }
+
+  struct io_uring_sqe* sqe = uring_sqe();
+
+  if(!sqe)
+  {
+    // The free space is lent again when the read is queued
+    conn->reader.lent = false;
+
+    uring_defer(conn, &conn->uring.retry_read);
+
+    return;
+  }
+
+  if(conn->uring.buffer != -1)
+  {
+    sqe->opcode    = IORING_OP_READ_FIXED;
+    sqe->buf_index = conn->uring.buffer;
+  }
+  else sqe->opcode = IORING_OP_READ;
+
+  sqe->fd        = conn->uring.in_file;
+  sqe->flags     = IOSQE_FIXED_FILE;
+  sqe->addr      = (uintptr_t) space;
+  sqe->len       = size;
+  sqe->off       = -1;
+  sqe->user_data = (uintptr_t) conn | URING_READ;
+
+  conn->uring.reading = true;
+  conn->uring.queued++;
+}
+
+/*
+ * Queue a write of the output in flight
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | The submission queue is full
+ */
+static int uring_write(conn_t* conn)
+{
+  struct io_uring_sqe* sqe = uring_sqe();
+
+  if(!sqe) return 1;
+
+  if(conn->writer.socket)
+  {
+    sqe->opcode    = IORING_OP_SEND;
+    sqe->msg_flags = MSG_NOSIGNAL;
+  }
+  else
+  {
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->off    = -1;
+  }
+
+  sqe->fd        = conn->uring.out_file;
+  sqe->flags     = IOSQE_FIXED_FILE;
+  sqe->addr      = (uintptr_t) (conn->uring.flight + conn->uring.flight_offset);
+  sqe->len       = conn->uring.flight_length - conn->uring.flight_offset;
+  sqe->user_data = (uintptr_t) conn | URING_WRITE;
+
+  conn->writer.writes++;
+
+  conn->uring.writing = true;
+  conn->uring.queued++;
+
+  return 0;
+}
+
+/*
+ * Queue a cancelation of the queued operation of connection
+ *
+ * Until the operation completes, the connection can't be freed,
+ * so a cancelation that doesn't fit is queued after the next completions
+ */
+static void uring_cancel(conn_t* conn, uring_op_t op)
+{
+  struct io_uring_sqe* sqe = uring_sqe();
+
+  if(!sqe)
+  {
+    uring_defer(conn, &conn->uring.retry_cancel);
+
+    return;
+  }
+
+  sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+  sqe->addr      = (uintptr_t) conn | op;
+  sqe->user_data = URING_NONE;
+}
+
+/*
+ * Queue a read, if the connection waits for input and none is queued
+ */
+void uring_conn_update(conn_t* conn)
+{
+  if(conn->closed || conn->uring.reading || conn->uring.retry_read || !conn->reading) return;
+
+  uring_read(conn);
+}
+
+/*
+ * Put the files of connection in the fixed file table, and start reading
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to register files
+ */
+int uring_conn_open(conn_t* conn)
+{
+  conn->uring = (conn_uring_t) { .in_file = -1, .out_file = -1, .buffer = -1 };
+
+  if((conn->uring.in_file = uring_file_add(conn->in)) == -1) return 1;
+
+  if(conn->out == conn->in)
+  {
+    conn->uring.out_file = conn->uring.in_file;
+  }
+  else if((conn->uring.out_file = uring_file_add(conn->out)) == -1) return 1;
+
+  // The buffer itself is registered right before the first read
+  if(buffers_fixed) conn->uring.buffer = uring_slot(buffer_used, URING_BUFFERS);
+
+  uring_conn_update(conn);
+
+  return 0;
+}
+
+/*
+ * Cancel the queued operations of connection, and remove its files
+ *
+ * The buffers have to stay allocated until the operations complete
+ */
+void uring_conn_close(conn_t* conn)
+{
+  // A read that never fit in the submission queue is not queued anymore
+  if(!conn->uring.retry_cancel) uring_undefer(conn);
+
+  conn->uring.retry_read = false;
+
+  if(conn->uring.reading) uring_cancel(conn, URING_READ);
+
+  if(conn->uring.writing) uring_cancel(conn, URING_WRITE);
+
+  if(conn->uring.out_file != conn->uring.in_file)
+  {
+    uring_file_remove(conn->uring.out_file);
+  }
+
+  uring_file_remove(conn->uring.in_file);
+
+  conn->uring.in_file  = -1;
+  conn->uring.out_file = -1;
+
+  uring_buffer_remove(conn);
+}
+
+/*
+ * Write the pending output of connection asynchronously
+ *
+ * The pending output is moved to the flight buffer, so the writer
+ * can keep queueing lines while the write is in progress.
+ * If a write is already in progress, the pending lines are copied,
+ * because the memory they reference might be overwritten by the next read
+ *
+ * RETURN (int status)
+ * -  0 | The output is being written
+ * -  1 | The output waits for an earlier write
+ * - -1 | Failed to write, the connection has been closed
+ */
+int uring_conn_flush(conn_t* conn)
+{
+  if(conn->uring.writing)
+  {
+    if(writer_stabilize(&conn->writer) != 0)
+    {
+      conn_fail(conn);
+
+      return -1;
+    }
+
+    conn->writing = true;
+
+    return 1;
+  }
+
+  ssize_t length = writer_gather(&conn->writer, &conn->uring.flight, &conn->uring.flight_size);
+
+  if(length == -1)
+  {
+    conn_fail(conn);
+
+    return -1;
+  }
+
+  conn->uring.flight_length = length;
+  conn->uring.flight_offset = 0;
+
+  if(uring_write(conn) != 0)
+  {
+    conn_fail(conn);
+
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * Account for a completed operation, freeing the buffers
+ * of a closed connection once nothing uses them anymore
+ *
+ * RETURN (bool closed)
+ */
+static bool uring_conn_done(conn_t* conn)
+{
+  conn->uring.queued--;
+
+  if(!conn->closed) return false;
+
+  if(conn->uring.queued == 0)
+  {
+    // Nothing is left to cancel
+    uring_undefer(conn);
+
+    conn_release(conn);
+  }
+
+  return true;
+}
+
+/*
+ * Hand read bytes to the input handler, and queue the next read
+ */
+static void uring_read_done(conn_t* conn, int result)
+{
+  conn->uring.reading = false;
+
+  if(uring_conn_done(conn)) return;
+
+  if(result == -ECANCELED || result == -EINTR || result == -EAGAIN)
+  {
+    uring_conn_update(conn);
+
+    return;
+  }
+
+  reader_commit(&conn->reader, result);
+
+  // At end of file, the last line might be missing a newline
+  if(result > 0 || conn->reader.length > 0)
+  {
+    if(conn->input) conn->input(conn);
+  }
+
+  if(result <= 0) conn_fail(conn);
+
+  else uring_conn_update(conn);
+}
+
+/*
+ * Continue a partial write, start writing the output that was queued
+ * in the meantime, or tell the drain handler that everything is written
+ */
+static void uring_write_done(conn_t* conn, int result)
+{
+  conn->uring.writing = false;
+
+  if(uring_conn_done(conn)) return;
+
+  if(result == -EINTR || result == -EAGAIN) result = 0;
+
+  if(result < 0)
+  {
+    conn_fail(conn);
+
+    return;
+  }
+
+  conn->writer.bytes        += result;
+  conn->uring.flight_offset += result;
+
+  if(conn->uring.flight_offset < conn->uring.flight_length)
+  {
+    if(uring_write(conn) != 0) conn_fail(conn);
+
+    return;
+  }
+
+  if(writer_pending(&conn->writer))
+  {
+    uring_conn_flush(conn);
+
+    return;
+  }
+
+  if(conn->writing)
+  {
+    conn->writing = false;
+
+    if(conn->drain) conn->drain(conn);
+  }
+}
+
+/*
+ * Queue an accept on a listening socket
+ *
+ * A multishot accept keeps producing completions, one for every client.
+ * The listener is identified by its index, above the operation bits
+ */
+static void uring_accept_queue(int index)
+{
+  uring_listener_t* listener = &listeners[index];
+
+  struct io_uring_sqe* sqe = uring_sqe();
+
+  if(!sqe)
+  {
+    listener->deferred = true;
+
+    return;
+  }
+
+  listener->deferred = false;
+
+  sqe->opcode    = IORING_OP_ACCEPT;
+  sqe->fd        = listener->file;
+  sqe->flags     = IOSQE_FIXED_FILE;
+  sqe->ioprio    = listener->multishot ? IORING_ACCEPT_MULTISHOT : 0;
+  sqe->user_data = ((uint64_t) index << URING_OP_BITS) | URING_ACCEPT;
+}
+
+/*
+ * Hand accepted client to the accept handler of its listener
+ */
+static void uring_accept_done(struct io_uring_cqe* cqe)
+{
+  int index = cqe->user_data >> URING_OP_BITS;
+
+  uring_listener_t* listener = &listeners[index];
+
+  if(cqe->res >= 0)
+  {
+    if(uring_debug) info_print("Accepted socket (%d)", cqe->res);
+
+    if(listener->handler) listener->handler(cqe->res);
+  }
+  else if(cqe->res == -EINVAL && listener->multishot)
+  {
+    // Older kernels only accept one client at a time
+    listener->multishot = false;
+  }
+  else if(uring_debug && cqe->res != -ECANCELED)
+  {
+    error_print("Failed to accept client: %s", strerror(-cqe->res));
+  }
+
+  if(!(cqe->flags & IORING_CQE_F_MORE) && cqe->res != -ECANCELED)
+  {
+    uring_accept_queue(index);
+  }
+}
+
+/*
+ * Start accepting clients on listening socket
+ *
+ * Every listening socket has a handler of its own
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Too many listening sockets, or failed to register socket
+ */
+int uring_accept(int servfd, uring_accept_handler_t handler)
+{
+  if(listener_count >= URING_LISTENERS) return 1;
+
+  int file = uring_file_add(servfd);
+
+  if(file == -1) return 1;
+
+  int index = listener_count++;
+
+  listeners[index] = (uring_listener_t) { .file = file, .multishot = true, .handler = handler };
+
+  uring_accept_queue(index);
+
+  return 0;
+}
+
+/*
+ * Wait once for events on the file descriptor of event,
+ * and call its handler with the events that happened
+ *
+ * The events are epoll events, which have the values of poll events
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | The submission queue is full
+ */
+int uring_poll(event_t* event, uint32_t events)
+{
+  struct io_uring_sqe* sqe = uring_sqe();
+
+  if(!sqe) return 1;
+
+  sqe->opcode        = IORING_OP_POLL_ADD;
+  sqe->fd            = event->fd;
+  sqe->poll32_events = events;
+  sqe->user_data     = (uintptr_t) event | URING_POLL;
+
+  event->events = events;
+  event->added  = true;
+
+  return 0;
+}
+
+/*
+ * Stop waiting for the events of event
+ *
+ * The handler is not called after this, even if the poll
+ * completes before the kernel has removed it
+ */
+void uring_poll_cancel(event_t* event)
+{
+  if(!event->added) return;
+
+  event->added = false;
+
+  struct io_uring_sqe* sqe = uring_sqe();
+
+  // The poll is left to complete, which is ignored
+  if(!sqe) return;
+
+  sqe->opcode    = IORING_OP_POLL_REMOVE;
+  sqe->addr      = (uintptr_t) event | URING_POLL;
+  sqe->user_data = URING_NONE;
+}
+
+/*
+ * Call the handler of a polled event, unless the poll was canceled
+ */
+static void uring_poll_done(struct io_uring_cqe* cqe)
+{
+  event_t* event = (event_t*) (uintptr_t) (cqe->user_data & ~((uint64_t) URING_OP_MASK));
+
+  if(!event->added || cqe->res == -ECANCELED) return;
+
+  event->added = false;
+
+  event->handler(event, (cqe->res < 0) ? EPOLLERR : (uint32_t) cqe->res);
+}
+
+/*
+ * Dispatch completion to the operation it belongs to
+ */
+static void uring_complete(struct io_uring_cqe* cqe)
+{
+  uring_op_t op = cqe->user_data & URING_OP_MASK;
+
+  conn_t* conn = (conn_t*) (uintptr_t) (cqe->user_data & ~((uint64_t) URING_OP_MASK));
+
+  switch(op)
+  {
+    case URING_READ:
+      uring_read_done(conn, cqe->res);
+      break;
+
+    case URING_WRITE:
+      uring_write_done(conn, cqe->res);
+      break;
+
+    case URING_ACCEPT:
+      uring_accept_done(cqe);
+      break;
+
+    case URING_POLL:
+      uring_poll_done(cqe);
+      break;
+
+    default:
+      break;
+  }
+}
+
+/*
+ * Queue the operations that found the submission queue full,
+ * now that it has been submitted and the completions handled
+ *
+ * No handler runs meanwhile, so the taken list can't change under it
+ */
+static void uring_retry(void)
+{
+  conn_t* conn = deferred;
+
+  deferred = NULL;
+
+  while(conn)
+  {
+    conn_t* next = conn->uring.deferred;
+
+    bool read   = conn->uring.retry_read;
+    bool cancel = conn->uring.retry_cancel;
+
+    conn->uring.deferred     = NULL;
+    conn->uring.retry_read   = false;
+    conn->uring.retry_cancel = false;
+
+    if(cancel)
+    {
+      if(conn->uring.reading) uring_cancel(conn, URING_READ);
+
+      if(conn->uring.writing) uring_cancel(conn, URING_WRITE);
+    }
+
+    if(read) uring_conn_update(conn);
+
+    conn = next;
+  }
+
+  for(int index = 0; index < listener_count; index++)
+  {
+    if(listeners[index].deferred) uring_accept_queue(index);
+  }
+}
+
+/*
+ * Submit the operations queued since last time, wait for completions
+ * and handle them
+ *
+ * Every operation queued by the handlers is submitted with the
+ * next call, so a whole batch costs a single syscall
+ *
+ * PARAMS
+ * - int timeout | Milliseconds to wait, -1 to wait forever
+ *
+ * RETURN (int count)
+ * - >=0 | Number of handled completions
+ * -  -1 | Failed to enter the ring
+ */
+int uring_wait(int timeout)
+{
+  unsigned head = *cq_head;
+
+  // Completions that are already waiting should not block
+  unsigned wait = (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) ? 1 : 0;
+
+  if(uring_enter(wait, timeout) == -1 && errno != EBUSY && errno != ETIME) return -1;
+
+  unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+
+  int count = 0;
+
+  while(head != tail)
+  {
+    struct io_uring_cqe cqe = cqes[head & *cq_mask];
+
+    // The entry is released first, because the handler might enter the ring
+    __atomic_store_n(cq_head, ++head, __ATOMIC_RELEASE);
+
+    uring_complete(&cqe);
+
+    count++;
+  }
+
+  uring_retry();
+
+  return count;
+}
@@ -0,0 +1,57 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef URING_H
+#define URING_H
+
+#include "debug.h"
+#include "conn.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <linux/io_uring.h>
+
+#define URING_ENTRIES 256
+#define URING_FILES   1024
+#define URING_BUFFERS 1024
+#define URING_LISTENERS 16
+
+typedef void (*uring_accept_handler_t)(int sockfd);
+
+extern size_t uring_enters;
+
+extern int  uring_init(bool debug);
+
+extern void uring_free(void);
+
+extern bool uring_active(void);
+
+
+extern int  uring_wait(int timeout);
+
+extern int  uring_accept(int servfd, uring_accept_handler_t handler);
+
+extern int  uring_poll(event_t* event, uint32_t events);
+
+extern void uring_poll_cancel(event_t* event);
+
+
+extern int  uring_conn_open(conn_t* conn);
+
+extern void uring_conn_close(conn_t* conn);
+
+extern void uring_conn_update(conn_t* conn);
+
+extern int  uring_conn_flush(conn_t* conn);
+
+#endif // URING_H
@@ -0,0 +1,342 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#include "writer.h"
+
+/*
+ * Initialize writer for file descriptor, allocating the copy buffer
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate buffer
+ */
+int writer_init(writer_t* writer, int fd)
+{
+  memset(writer, 0, sizeof(writer_t));
+
+  if(!(writer->buffer = malloc(WRITER_SIZE))) return 1;
+
+  writer->size = WRITER_SIZE;
+
+  writer_reset(writer, fd);
+
+  return 0;
+}
+
+/*
+ * Discard everything pending and start writing to another file descriptor
+ *
+ * The allocated buffer and the counters are kept
+ */
+void writer_reset(writer_t* writer, int fd)
+{
+  struct stat status;
+
+  writer->socket = (fd != -1 && fstat(fd, &status) == 0 && S_ISSOCK(status.st_mode));
+
+  writer->fd     = fd;
+  writer->count  = 0;
+  writer->length = 0;
+  writer->used   = 0;
+}
+
+/*
+ * Free the buffer of writer
+ */
+void writer_free(writer_t* writer)
+{
+  free(writer->buffer);
+
+  memset(writer, 0, sizeof(writer_t));
+
+  writer->fd = -1;
+}
+
+/*
+ * Make room for more bytes in the copy buffer
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate buffer
+ */
+static int writer_reserve(writer_t* writer, size_t length)
+{
+  if(writer->used + length <= writer->size) return 0;
+
+  size_t size = writer->size;
+
+  while(size < writer->used + length) size *= 2;
+
+  char* buffer = realloc(writer->buffer, size);
+
+  if(!buffer) return 1;
+
+  writer->buffer = buffer;
+  writer->size   = size;
+
+  return 0;
+}
+
+/*
+ * Copy every pending segment into a single segment in the copy buffer
+ *
+ * This is done when the file descriptor would block,
+ * because referenced memory is only valid until the next read
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate buffer
+ */
+int writer_stabilize(writer_t* writer)
+{
+  // Nothing is referenced, if everything already is in a single copied segment
+  if(writer->count == 0 || (writer->count == 1 && !writer->segments[0].base)) return 0;
+
+  size_t size = WRITER_SIZE;
+
+  while(size < writer->length) size *= 2;
+
+  char* buffer = malloc(size);
+
+  if(!buffer) return 1;
+
+  size_t offset = 0;
+
+  for(int index = 0; index < writer->count; index++)
+  {
+    segment_t* segment = &writer->segments[index];
+
+    const char* base = segment->base ? segment->base : writer->buffer + segment->offset;
+
+    memcpy(buffer + offset, base, segment->length);
+
+    offset += segment->length;
+  }
+
+  free(writer->buffer);
+
+  writer->buffer = buffer;
+  writer->size   = size;
+  writer->used   = offset;
+
+  writer->segments[0] = (segment_t) { NULL, 0, offset };
+
+  writer->count = (offset > 0) ? 1 : 0;
+
+  return 0;
+}
+
+/*
+ * Drop the first written bytes from the pending segments
+ */
+static void writer_consume(writer_t* writer, size_t size)
+{
+  int index = 0;
+
+  while(index < writer->count && size >= writer->segments[index].length)
+  {
+    size -= writer->segments[index++].length;
+  }
+
+  if(index < writer->count)
+  {
+    segment_t* segment = &writer->segments[index];
+
+    if(segment->base) segment->base   += size;
+    else              segment->offset += size;
+
+    segment->length -= size;
+  }
+
+  writer->count -= index;
+
+  memmove(writer->segments, writer->segments + index, writer->count * sizeof(segment_t));
+
+  if(writer->count == 0) writer->used = 0;
+}
+
+/*
+ * Write the pending segments with as few vectored syscalls as possible
+ *
+ * RETURN (int status)
+ * -  0 | Everything has been written
+ * -  1 | The file descriptor would block, the rest is still pending
+ * - -1 | Failed to write
+ */
+int writer_flush(writer_t* writer)
+{
+  while(writer->count > 0)
+  {
+    struct iovec iov[WRITER_IOV_MAX];
+
+    for(int index = 0; index < writer->count; index++)
+    {
+      segment_t* segment = &writer->segments[index];
+
+      iov[index].iov_base = (void*) (segment->base ? segment->base : writer->buffer + segment->offset);
+      iov[index].iov_len  = segment->length;
+    }
+
+    ssize_t size;
+
+    if(writer->socket)
+    {
+      struct msghdr message = { .msg_iov = iov, .msg_iovlen = writer->count };
+
+      // A disconnected client should not raise SIGPIPE
+      size = sendmsg(writer->fd, &message, MSG_NOSIGNAL);
+    }
+    else size = writev(writer->fd, iov, writer->count);
+
+    writer->writes++;
+
+    if(size == -1)
+    {
+      if(errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        return (writer_stabilize(writer) == 0) ? 1 : -1;
+      }
+
+      return -1;
+    }
+
+    writer->bytes  += size;
+    writer->length -= size;
+
+    writer_consume(writer, size);
+  }
+
+  return 0;
+}
+
+/*
+ * Queue a line without copying it
+ *
+ * The line has to stay valid until the writer is flushed.
+ * If all segments are in use, the writer is flushed first
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to flush writer
+ */
+int writer_line(writer_t* writer, const char* line, size_t length)
+{
+  if(length == 0) return 0;
+
+  if(writer->count == WRITER_IOV_MAX)
+  {
+    if(writer_flush(writer) == -1) return -1;
+  }
+
+  writer->segments[writer->count++] = (segment_t) { line, 0, length };
+
+  writer->length += length;
+
+  writer->lines++;
+
+  return 0;
+}
+
+/*
+ * Queue data by copying it into the buffer of the writer
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to allocate buffer, or to flush writer
+ */
+int writer_copy(writer_t* writer, const char* data, size_t length)
+{
+  if(length == 0) return 0;
+
+  if(writer_reserve(writer, length) != 0) return -1;
+
+  memcpy(writer->buffer + writer->used, data, length);
+
+  segment_t* last = (writer->count > 0) ? &writer->segments[writer->count - 1] : NULL;
+
+  // Extend the last segment, if it ends where the data was copied
+  if(last && !last->base && last->offset + last->length == writer->used)
+  {
+    last->length += length;
+  }
+  else
+  {
+    if(writer->count == WRITER_IOV_MAX)
+    {
+      // Flushing might reset the buffer, so the copy is done again
+      if(writer_flush(writer) == -1) return -1;
+
+      return writer_copy(writer, data, length);
+    }
+
+    writer->segments[writer->count++] = (segment_t) { NULL, writer->used, length };
+  }
+
+  writer->used   += length;
+  writer->length += length;
+
+  if(data[length - 1] == '\n') writer->lines++;
+
+  return 0;
+}
+
+/*
+ * Move every pending byte into a separate buffer, leaving the writer empty
+ *
+ * This is used when the bytes are written asynchronously,
+ * so that the writer can keep queueing while they are in flight
+ *
+ * PARAMS
+ * - char** buffer | Buffer to copy into, grown if needed
+ * - size_t* size  | Size of buffer
+ *
+ * RETURN (ssize_t length)
+ * - >=0 | Number of moved bytes
+ * -  -1 | Failed to grow buffer
+ */
+ssize_t writer_gather(writer_t* writer, char** buffer, size_t* size)
+{
+  if(writer->length > *size)
+  {
+    size_t new_size = (*size > 0) ? *size : WRITER_SIZE;
+
+    while(new_size < writer->length) new_size *= 2;
+
+    char* new_buffer = realloc(*buffer, new_size);
+
+    if(!new_buffer) return -1;
+
+    *buffer = new_buffer;
+    *size   = new_size;
+  }
+
+  size_t offset = 0;
+
+  for(int index = 0; index < writer->count; index++)
+  {
+    segment_t* segment = &writer->segments[index];
+
+    const char* base = segment->base ? segment->base : writer->buffer + segment->offset;
+
+    memcpy(*buffer + offset, base, segment->length);
+
+    offset += segment->length;
+  }
+
+  writer->count  = 0;
+  writer->length = 0;
+  writer->used   = 0;
+
+  return offset;
+}
+
+/*
+ * Check if writer has pending bytes
+ */
+bool writer_pending(writer_t* writer)
+{
+  return writer->count > 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-16
+ */
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+#define WRITER_IOV_MAX 64
+#define WRITER_SIZE    4096
+
+/*
+ * A pending piece of output, either referencing memory
+ * owned by the caller or stored in the buffer of the writer
+ */
+typedef struct
+{
+  const char* base;   // Referenced memory (NULL if owned)
+  size_t      offset; // Offset in the buffer of the writer (if owned)
+  size_t      length;
+} segment_t;
+
+/*
+ * Coalescing writer for a single file descriptor
+ *
+ * Complete lines are gathered and written with a single vectored syscall
+ */
+typedef struct
+{
+  int       fd;
+  bool      socket;   // Use sendmsg instead of writev
+  segment_t segments[WRITER_IOV_MAX];
+  int       count;    // Number of pending segments
+  size_t    length;   // Number of pending bytes
+  char*     buffer;   // Storage for copied segments
+  size_t    size;
+  size_t    used;
+  size_t    writes;   // Number of write syscalls
+  size_t    lines;    // Number of queued lines
+  size_t    bytes;    // Number of written bytes
+} writer_t;
+
+extern int     writer_init(writer_t* writer, int fd);
+
+extern void    writer_reset(writer_t* writer, int fd);
+
+extern void    writer_free(writer_t* writer);
+
+
+extern int     writer_line(writer_t* writer, const char* line, size_t length);
+
+extern int     writer_copy(writer_t* writer, const char* data, size_t length);
+
+extern int     writer_flush(writer_t* writer);
+
+extern int     writer_stabilize(writer_t* writer);
+
+extern ssize_t writer_gather(writer_t* writer, char** buffer, size_t* size);
+
+extern bool    writer_pending(writer_t* writer);
+
+#endif // WRITER_H
@@ -0,0 +1,21 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-17
+ */
+
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <stdint.h>
+
+#define ZOBRIST_PIECE     0   // 64 * piece + 8 * row + file
+#define ZOBRIST_CASTLE    768 // White short, white long, black short, black long
+#define ZOBRIST_ENPASSANT 772 // File of the en passant square
+#define ZOBRIST_TURN      780 // White to move
+
+#define ZOBRIST_COUNT     781
+
+extern const uint64_t zobrist_random[ZOBRIST_COUNT];
+
+#endif // ZOBRIST_H